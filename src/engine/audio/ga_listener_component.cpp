@@ -29,24 +29,47 @@ ga_listener_component::ga_listener_component(ga_entity* ent, SoLoud::Soloud* aud
 
 
 	// Nodes
-	std::vector<ga_vec3f> corners = world->get_mesh_corners();
-	std::vector<ga_vec3f> apart_corners = world->get_mesh_corners(0.05f);
-	std::unordered_map<ga_vec3f, ga_vec3f> corner_to_apart_corner;
-	std::unordered_map<ga_vec3f, int> corner_count;
-	
+	// Each mesh corner is classified by how many of the eight octants around it are
+	// solid: one for an outer corner, three for a concave corner. Counting octants
+	// rather than coincident box corners gives the same nodes however the geometry
+	// is split into boxes, e.g. after static colliders are merged. Spheres and
+	// capsules count as solid too, so a corner buried in one doesn't become a node.
+	const float k_octant_probe_dist = 0.01f;
+	const float k_apart_dist = 0.05f;
+	std::shared_ptr<const ga_mesh_export> mesh = world->get_static_mesh_export();
+	const std::vector<ga_mesh_corner>& corners = mesh->_corners;
+	std::unordered_set<ga_vec3f> visited_corners;
+
 	for (int i = 0; i < corners.size(); ++i)
 	{
-		corner_count[corners[i]]++;
-		corner_to_apart_corner[corners[i]] = apart_corners[i];
-	}
-	std::unordered_map<ga_vec3f, int>::iterator itr;
-	for (itr = corner_count.begin(); itr != corner_count.end(); ++itr)
-	{
-		// Create nodes for outer mesh corners (only one vertex at that location)
-		if (itr->second == 1 || itr->second == 3)
+		const ga_vec3f& corner = corners[i]._position;
+		if (!visited_corners.insert(corner).second) continue;
+
+		// Probe along the axes of the box the corner belongs to.
+		const ga_vec3f* axes = corners[i]._axes;
+
+		int solid_octants = 0;
+		ga_vec3f solid_dir = ga_vec3f::zero_vector();
+		for (int octant = 0; octant < 8; ++octant)
+		{
+			ga_vec3f dir = ga_vec3f::zero_vector();
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				dir += axes[axis].scale_result((octant & (4 >> axis)) ? 1.0f : -1.0f);
+			}
+			if (world->point_in_any_solid(corner + dir.scale_result(k_octant_probe_dist)))
+			{
+				++solid_octants;
+				solid_dir = dir;
+			}
+		}
+
+		// Create nodes for outer mesh corners and concave corners
+		if (solid_octants == 1 || solid_octants == 3)
 		{
-			ga_vec3f node_pos = corner_to_apart_corner[itr->first];
-			if (itr->second == 3) node_pos = itr->first; // use original corner position for concave corners
+			// Outer corners are nudged away from the mesh, concave corners keep their position
+			ga_vec3f node_pos = corner;
+			if (solid_octants == 1) node_pos += solid_dir.normal().scale_result(-k_apart_dist);
 			if (node_pos.y < 0) node_pos += { 0, 0.1f, 0 }; // prevent edges between ground layer nodes
 			_sound_nodes.push_back(sound_node(_sound_nodes.size(), node_pos));
 		}
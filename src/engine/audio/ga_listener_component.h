@@ -18,6 +18,7 @@
 #include <map>
 #include <queue>
 #include <unordered_map>
+#include <unordered_set>
 
 #define MAX_AUDIO_DIST 20.0f
 #define MAX_LOWPASS_CUTOFF 10000
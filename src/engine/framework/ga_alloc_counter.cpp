@@ -0,0 +1,101 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_alloc_counter.h"
+
+#if defined(GA_TRACK_ALLOCATIONS)
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> g_allocation_count(0);
+
+static void* _ga_tracked_alloc(std::size_t size)
+{
+	g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+	void* ptr = malloc(size ? size : 1);
+	if (!ptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new(std::size_t size)
+{
+	return _ga_tracked_alloc(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return _ga_tracked_alloc(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size ? size : 1);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	free(ptr);
+}
+
+/*
+** Sized forms, which C++14 calls when it knows the size, and the forms a throwing
+** constructor after a nothrow new calls. Replaced alongside the others, or
+** -Wsized-deallocation warns.
+*/
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	free(ptr);
+}
+
+uint64_t ga_get_allocation_count()
+{
+	return g_allocation_count.load(std::memory_order_relaxed);
+}
+
+#else
+
+uint64_t ga_get_allocation_count()
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include <cstdint>
+
+/*
+** Returns the number of heap allocations made through global operator new
+** since startup, across all threads.
+**
+** Counting is only compiled in when GA_TRACK_ALLOCATIONS is defined (debug
+** builds). Otherwise the count is always zero.
+*/
+uint64_t ga_get_allocation_count();
@@ -14,6 +14,15 @@
 #define GA_MSVC
 #elif defined(__MINGW32__)
 #define GA_MINGW
+#elif defined(__GNUC__)
+#define GA_GCC
+#endif
+
+// Platforms.
+#if defined(_WIN32)
+#define GA_WINDOWS
+#elif defined(__linux__)
+#define GA_LINUX
 #endif
 
 // Architecture.
@@ -28,3 +37,22 @@
 #if defined(__MINGW32__)
 #define GA_32_BIT
 #endif
+
+#if defined(GA_GCC)
+#if defined(__LP64__)
+#define GA_64_BIT
+#else
+#define GA_32_BIT
+#endif
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define GA_X86_64
+#elif defined(__aarch64__)
+#define GA_ARM64
+#endif
+
+// SIMD.
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define GA_SSE
+#endif
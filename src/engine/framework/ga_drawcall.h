@@ -16,8 +16,19 @@
 #include <string>
 #include <vector>
 
+#if defined(GA_HEADLESS)
+/*
+** Headless tools link no OpenGL. Draw calls keep their layout, but nothing fills
+** in or submits them.
+*/
+#include <cstdint>
+typedef unsigned int GLenum;
+typedef unsigned int GLuint;
+typedef int GLsizei;
+#else
 #define GLEW_STATIC
 #include <GL/glew.h>
+#endif
 
 /*
 ** A draw emitted from the simulation phase and rendered in the output phase.
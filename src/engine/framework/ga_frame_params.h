@@ -82,6 +82,10 @@ struct ga_frame_params
 	std::vector<ga_dynamic_drawcall> _gui_drawcalls;
 	std::atomic_flag _gui_drawcall_lock = ATOMIC_FLAG_INIT;
 
+	// Data emitted by physics stage:
+	// Fraction of a fixed physics step elapsed since the last one, for interpolation.
+	float _physics_interpolation = 1.0f;
+
 	ga_mat4f _view;
 
 	// Somewhat of a hack to make collision stable when stepping with a paused simulation.
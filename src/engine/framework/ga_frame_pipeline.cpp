@@ -0,0 +1,78 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_frame_pipeline.h"
+#include "ga_input.h"
+#include "ga_output.h"
+
+#include "jobs/ga_task_graph.h"
+
+#include <new>
+
+ga_frame_pipeline::ga_frame_pipeline(ga_input* input, ga_output* output, ga_task_graph* sim_graph,
+	ga_frame_params** sim_params, bool pipelined) :
+	_input(input),
+	_output(output),
+	_sim_graph(sim_graph),
+	_sim_params(sim_params),
+	_pipelined(pipelined),
+	_next_buffer(0),
+	_pending(nullptr)
+{
+}
+
+ga_frame_pipeline::~ga_frame_pipeline()
+{
+	if (_sim_graph->is_running())
+	{
+		_sim_graph->wait();
+	}
+}
+
+bool ga_frame_pipeline::update()
+{
+	// Frames are simulated in order, so the last one must finish before the next
+	// starts. In serial mode it already has.
+	if (_sim_graph->is_running())
+	{
+		_sim_graph->wait();
+	}
+
+	// A buffer is only reused once the frame in it has been drawn. Params hold
+	// locks, which can't be assigned, so each frame starts from a fresh one.
+	ga_frame_params* params = &_params[_next_buffer];
+	_next_buffer = (_next_buffer + 1) % k_buffer_count;
+	params->~ga_frame_params();
+	new (params) ga_frame_params();
+
+	// Gather user input and current time.
+	if (!_input->update(params))
+	{
+		return false;
+	}
+
+	*_sim_params = params;
+	_sim_graph->start();
+
+	if (_pipelined)
+	{
+		// Draw the previous frame while this one simulates on the workers.
+		if (_pending)
+		{
+			_output->update(_pending);
+		}
+		_pending = params;
+	}
+	else
+	{
+		_sim_graph->wait();
+		_output->update(params);
+	}
+	return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_frame_params.h"
+
+class ga_input;
+class ga_output;
+class ga_task_graph;
+
+/*
+** Runs frames through input, a simulation task graph, and output.
+**
+** When pipelined, the next frame's simulation runs on the job workers while the
+** main thread draws the frame before it, with each frame's params in its own
+** buffer. The screen then shows at most one frame behind the latest input.
+** Serial mode finishes each frame before taking input for the next, as before.
+**
+** Input and output always run on the calling thread.
+*/
+class ga_frame_pipeline
+{
+public:
+	/*
+	** The sim graph's tasks read the frame being simulated through *sim_params,
+	** which is set before each run of the graph.
+	*/
+	ga_frame_pipeline(ga_input* input, ga_output* output, ga_task_graph* sim_graph, ga_frame_params** sim_params,
+		bool pipelined);
+
+	/*
+	** Waits for any frame still simulating. Its output is dropped.
+	*/
+	~ga_frame_pipeline();
+
+	/*
+	** Take input for a new frame, start simulating it, and draw the oldest finished
+	** frame. Returns false once input asks to quit.
+	*/
+	bool update();
+
+private:
+	static const int k_buffer_count = 2;
+
+	ga_input* _input;
+	ga_output* _output;
+	ga_task_graph* _sim_graph;
+	ga_frame_params** _sim_params;
+	bool _pipelined;
+
+	ga_frame_params _params[k_buffer_count];
+	int _next_buffer;
+
+	/* Simulated, or simulating, but not yet drawn. */
+	ga_frame_params* _pending;
+};
@@ -31,5 +31,9 @@ void ga_condvar::wait_for(int ms)
 
 void ga_condvar::wake_all()
 {
+	/* Taking the lock orders this after any waiter's check of its condition. */
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+	}
 	_condvar.notify_all();
 }
@@ -25,6 +25,17 @@ public:
 	void wait_for(int ms);
 	void wake_all();
 
+	/*
+	** Block until done() returns true. It's checked under the condvar's lock, so a
+	** wake_all after the condition becomes true can't be missed.
+	*/
+	template<typename F>
+	void wait(F done)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_condvar.wait(lock, done);
+	}
+
 private:
 	std::condition_variable _condvar;
 	std::mutex _mutex;
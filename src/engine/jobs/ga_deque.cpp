@@ -0,0 +1,125 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_deque.h"
+
+#include <atomic>
+#include <cstdint>
+
+struct ga_deque_impl_t
+{
+	/* Top and bottom sit on their own cache lines; thieves write one, the owner the other. */
+	alignas(64) std::atomic<int64_t> _top;
+	alignas(64) std::atomic<int64_t> _bottom;
+
+	alignas(64) std::atomic<void*>* _items;
+	int64_t _mask;
+};
+
+ga_deque::ga_deque(int capacity)
+{
+	auto impl = new ga_deque_impl_t;
+
+	/* Round up to a power of two so indices wrap with a mask. */
+	int64_t size = 1;
+	while (size < capacity)
+	{
+		size <<= 1;
+	}
+
+	impl->_top = 0;
+	impl->_bottom = 0;
+	impl->_items = new std::atomic<void*>[size];
+	impl->_mask = size - 1;
+
+	_impl = impl;
+}
+
+ga_deque::~ga_deque()
+{
+	ga_deque_impl_t* impl = static_cast<ga_deque_impl_t*>(_impl);
+	delete[] impl->_items;
+	delete impl;
+}
+
+bool ga_deque::push(void* data)
+{
+	ga_deque_impl_t* impl = static_cast<ga_deque_impl_t*>(_impl);
+
+	int64_t bottom = impl->_bottom.load(std::memory_order_relaxed);
+	int64_t top = impl->_top.load(std::memory_order_acquire);
+	if (bottom - top > impl->_mask)
+	{
+		return false;
+	}
+
+	impl->_items[bottom & impl->_mask].store(data, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	impl->_bottom.store(bottom + 1, std::memory_order_relaxed);
+	return true;
+}
+
+bool ga_deque::pop(void** data)
+{
+	ga_deque_impl_t* impl = static_cast<ga_deque_impl_t*>(_impl);
+
+	/* Claim the bottom item before looking at top, so a thief can't take it too. */
+	int64_t bottom = impl->_bottom.load(std::memory_order_relaxed) - 1;
+	impl->_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = impl->_top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		/* Empty. */
+		impl->_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	*data = impl->_items[bottom & impl->_mask].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		/* Last item. Race the thieves for it. */
+		bool won = impl->_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		impl->_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return won;
+	}
+	return true;
+}
+
+bool ga_deque::steal(void** data)
+{
+	ga_deque_impl_t* impl = static_cast<ga_deque_impl_t*>(_impl);
+
+	int64_t top = impl->_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t bottom = impl->_bottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+	{
+		return false;
+	}
+
+	/* Read before claiming; once top moves the owner may overwrite the slot. */
+	void* item = impl->_items[top & impl->_mask].load(std::memory_order_relaxed);
+	if (!impl->_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		return false;
+	}
+
+	*data = item;
+	return true;
+}
+
+int ga_deque::get_count() const
+{
+	ga_deque_impl_t* impl = static_cast<ga_deque_impl_t*>(_impl);
+	int64_t count = impl->_bottom.load(std::memory_order_relaxed) - impl->_top.load(std::memory_order_relaxed);
+	return count > 0 ? int(count) : 0;
+}
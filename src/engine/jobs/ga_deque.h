@@ -0,0 +1,35 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+/*
+** Lock-free work-stealing deque with a fixed capacity.
+** The owning thread pushes and pops at the bottom; any thread may steal from the
+** top. The owner only contends with thieves when one item is left.
+** https://www.di.ens.fr/~zappa/readings/ppopp13.pdf
+*/
+class ga_deque
+{
+public:
+	ga_deque(int capacity);
+	~ga_deque();
+
+	/* Owner only. Fails if the deque is full. */
+	bool push(void* data);
+	bool pop(void** data);
+
+	/* Any thread. Fails if the deque is empty or another thread won the item. */
+	bool steal(void** data);
+
+	int get_count() const;
+
+private:
+	void* _impl;
+};
@@ -9,34 +9,40 @@
 
 #include "ga_fiber.h"
 
+#if defined(GA_WINDOWS)
+
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #undef WIN32_LEAN_AND_MEAN
 
 ga_fiber::ga_fiber(function_t func, void* func_data, size_t stack_size)
 {
-	const size_t k_stack_align = 64 * 1024;
-	stack_size = stack_size > k_stack_align ? stack_size : k_stack_align;
-	stack_size = (stack_size + k_stack_align - 1) & ~(k_stack_align - 1);
-
-	_impl = CreateFiber(stack_size, (LPFIBER_START_ROUTINE)func, func_data);
+	/* CreateFiber's size is only what's committed up front; the reserve is what bounds the stack. */
+	_impl = CreateFiberEx(0, get_stack_size(stack_size), 0, (LPFIBER_START_ROUTINE)func, func_data);
 }
 
 ga_fiber::~ga_fiber()
 {
 	if (_impl)
 	{
-		DeleteFiber(_impl);
+		/* Deleting the running fiber would exit the thread. */
+		if (_impl == GetCurrentFiber())
+		{
+			ConvertFiberToThread();
+		}
+		else
+		{
+			DeleteFiber(_impl);
+		}
 	}
 }
 
 ga_fiber& ga_fiber::operator=(ga_fiber&& other)
 {
-	if (&other != this)
-	{
-		_impl = other._impl;
-		other._impl = 0;
-	}
+	/* Our old fiber goes to other, to be deleted along with it. */
+	void* impl = _impl;
+	_impl = other._impl;
+	other._impl = impl;
 	return *this;
 }
 
@@ -56,3 +62,385 @@ void* ga_fiber::get_data()
 {
 	return GetFiberData();
 }
+
+void ga_fiber::paint_stack()
+{
+}
+
+size_t ga_fiber::get_stack_used()
+{
+	return 0;
+}
+
+size_t ga_fiber::get_stack_size(size_t stack_size)
+{
+	const size_t k_stack_align = 64 * 1024;
+	stack_size = stack_size > k_stack_align ? stack_size : k_stack_align;
+	return (stack_size + k_stack_align - 1) & ~(k_stack_align - 1);
+}
+
+size_t ga_fiber::get_reserved_size(size_t stack_size)
+{
+	/* The guard page comes out of the reserve. */
+	return get_stack_size(stack_size);
+}
+
+#elif defined(GA_LINUX)
+
+#include <assert.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if !defined(GA_X86_64) && !defined(GA_ARM64) && !defined(GA_FIBER_UCONTEXT)
+#define GA_FIBER_UCONTEXT
+#endif
+
+#if defined(GA_FIBER_UCONTEXT)
+#include <ucontext.h>
+#endif
+
+/*
+** Saved state of a fiber that isn't running.
+**
+** Fibers made by convert_thread run on their thread's own stack, and have no stack
+** of their own to free. Otherwise the mapping starts with the guard page.
+*/
+struct ga_fiber_context_t
+{
+#if defined(GA_FIBER_UCONTEXT)
+	ucontext_t _context;
+#else
+	void* _stack_pointer;
+#endif
+
+	void* _stack;
+	size_t _stack_size;
+	size_t _guard_size;
+
+	ga_fiber::function_t _func;
+	void* _data;
+};
+
+/* The fiber running on this thread. Fibers can resume on a different thread. */
+static thread_local ga_fiber_context_t* _current_fiber = 0;
+
+#if !defined(GA_FIBER_UCONTEXT)
+
+/*
+** Save the callee-saved registers on the current stack, store the stack pointer in
+** *from_stack_pointer, then restore the registers saved on to_stack_pointer and
+** return into that fiber. Caller-saved registers are left to the compiler, since
+** this is an ordinary function call as far as it's concerned.
+*/
+extern "C" void ga_fiber_switch_context(void** from_stack_pointer, void* to_stack_pointer);
+
+/*
+** First code run by a new fiber. The initial stack switches into it with the entry
+** function in a callee-saved register and its argument in another.
+*/
+extern "C" void ga_fiber_start();
+
+#if defined(GA_X86_64)
+
+/* System V: rbx, rbp and r12-r15 are callee-saved, as are the MXCSR and x87 control words. */
+asm(
+	".text\n"
+	".globl ga_fiber_switch_context\n"
+	".type ga_fiber_switch_context,@function\n"
+	".p2align 4\n"
+	"ga_fiber_switch_context:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	subq $8, %rsp\n"
+	"	stmxcsr (%rsp)\n"
+	"	fnstcw 4(%rsp)\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	ldmxcsr (%rsp)\n"
+	"	fldcw 4(%rsp)\n"
+	"	addq $8, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	".size ga_fiber_switch_context,.-ga_fiber_switch_context\n"
+
+	".globl ga_fiber_start\n"
+	".type ga_fiber_start,@function\n"
+	".p2align 4\n"
+	"ga_fiber_start:\n"
+	"	movq %r12, %rdi\n"
+	"	callq *%r13\n"
+	"	ud2\n"
+	".size ga_fiber_start,.-ga_fiber_start\n"
+);
+
+/* Saved control words, r15, r14, r13, r12, rbx, rbp and the return address. */
+static const int k_saved_word_count = 8;
+
+static void init_stack(void** words, void* arg, void(*entry)(void*))
+{
+	words[0] = reinterpret_cast<void*>(uintptr_t(0x037f) << 32 | 0x1f80);
+	words[1] = 0;
+	words[2] = 0;
+	words[3] = reinterpret_cast<void*>(entry);
+	words[4] = arg;
+	words[5] = 0;
+	words[6] = 0;
+	words[7] = reinterpret_cast<void*>(ga_fiber_start);
+}
+
+#elif defined(GA_ARM64)
+
+/* AAPCS64: x19-x29, the link register and d8-d15 are callee-saved, as is the FPCR. */
+asm(
+	".text\n"
+	".globl ga_fiber_switch_context\n"
+	".type ga_fiber_switch_context,%function\n"
+	".p2align 4\n"
+	"ga_fiber_switch_context:\n"
+	"	sub sp, sp, #176\n"
+	"	stp x19, x20, [sp, #0]\n"
+	"	stp x21, x22, [sp, #16]\n"
+	"	stp x23, x24, [sp, #32]\n"
+	"	stp x25, x26, [sp, #48]\n"
+	"	stp x27, x28, [sp, #64]\n"
+	"	stp x29, x30, [sp, #80]\n"
+	"	stp d8, d9, [sp, #96]\n"
+	"	stp d10, d11, [sp, #112]\n"
+	"	stp d12, d13, [sp, #128]\n"
+	"	stp d14, d15, [sp, #144]\n"
+	"	mrs x9, fpcr\n"
+	"	str x9, [sp, #160]\n"
+	"	mov x9, sp\n"
+	"	str x9, [x0]\n"
+	"	mov sp, x1\n"
+	"	ldp x19, x20, [sp, #0]\n"
+	"	ldp x21, x22, [sp, #16]\n"
+	"	ldp x23, x24, [sp, #32]\n"
+	"	ldp x25, x26, [sp, #48]\n"
+	"	ldp x27, x28, [sp, #64]\n"
+	"	ldp x29, x30, [sp, #80]\n"
+	"	ldp d8, d9, [sp, #96]\n"
+	"	ldp d10, d11, [sp, #112]\n"
+	"	ldp d12, d13, [sp, #128]\n"
+	"	ldp d14, d15, [sp, #144]\n"
+	"	ldr x9, [sp, #160]\n"
+	"	msr fpcr, x9\n"
+	"	add sp, sp, #176\n"
+	"	ret\n"
+	".size ga_fiber_switch_context,.-ga_fiber_switch_context\n"
+
+	".globl ga_fiber_start\n"
+	".type ga_fiber_start,%function\n"
+	".p2align 4\n"
+	"ga_fiber_start:\n"
+	"	mov x0, x19\n"
+	"	blr x20\n"
+	"	brk #0\n"
+	".size ga_fiber_start,.-ga_fiber_start\n"
+);
+
+/* x19-x30, d8-d15, the FPCR and a word of padding to keep sp 16 byte aligned. */
+static const int k_saved_word_count = 22;
+
+static void init_stack(void** words, void* arg, void(*entry)(void*))
+{
+	for (int i = 0; i < k_saved_word_count; ++i)
+	{
+		words[i] = 0;
+	}
+	words[0] = arg;
+	words[1] = reinterpret_cast<void*>(entry);
+	words[11] = reinterpret_cast<void*>(ga_fiber_start);
+}
+
+#endif
+
+#endif
+
+static void ga_fiber_entry(void* data)
+{
+	ga_fiber_context_t* context = static_cast<ga_fiber_context_t*>(data);
+	context->_func(context->_data);
+
+	/* Fibers must switch away rather than return; there's nothing to return to. */
+	assert(false);
+}
+
+#if defined(GA_FIBER_UCONTEXT)
+static void ga_fiber_ucontext_entry()
+{
+	ga_fiber_entry(_current_fiber);
+}
+#endif
+
+/* Value painted over unused stack, as whole words. */
+static const uintptr_t k_stack_paint = uintptr_t(0xcdcdcdcdcdcdcdcdull);
+
+ga_fiber::ga_fiber(function_t func, void* func_data, size_t stack_size)
+{
+	const size_t k_page_size = size_t(sysconf(_SC_PAGESIZE));
+	stack_size = get_stack_size(stack_size);
+
+	ga_fiber_context_t* context = new ga_fiber_context_t();
+	context->_func = func;
+	context->_data = func_data;
+	context->_stack_size = stack_size + k_page_size;
+	context->_guard_size = k_page_size;
+
+	/* Reserve address space only; pages are committed as the fiber touches them. */
+	context->_stack = mmap(0, context->_stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+	if (context->_stack == MAP_FAILED)
+	{
+		printf("Failed to map a %zu byte fiber stack. %s. Exiting.\n", context->_stack_size, strerror(errno));
+		exit(1);
+	}
+
+	/* Without the guard page an overflow would silently corrupt the next mapping. */
+	if (mprotect(context->_stack, k_page_size, PROT_NONE) != 0)
+	{
+		printf("Failed to protect a fiber stack guard page. %s. Exiting.\n", strerror(errno));
+		exit(1);
+	}
+
+	char* stack = static_cast<char*>(context->_stack) + k_page_size;
+
+#if defined(GA_FIBER_UCONTEXT)
+	getcontext(&context->_context);
+	context->_context.uc_stack.ss_sp = stack;
+	context->_context.uc_stack.ss_size = stack_size;
+	context->_context.uc_link = 0;
+	makecontext(&context->_context, ga_fiber_ucontext_entry, 0);
+#else
+	void** words = reinterpret_cast<void**>(stack + stack_size) - k_saved_word_count;
+	init_stack(words, context, ga_fiber_entry);
+	context->_stack_pointer = words;
+#endif
+
+	_impl = context;
+}
+
+ga_fiber::~ga_fiber()
+{
+	ga_fiber_context_t* context = static_cast<ga_fiber_context_t*>(_impl);
+	if (context)
+	{
+		if (_current_fiber == context)
+		{
+			_current_fiber = 0;
+		}
+		if (context->_stack)
+		{
+			munmap(context->_stack, context->_stack_size);
+		}
+		delete context;
+	}
+}
+
+ga_fiber& ga_fiber::operator=(ga_fiber&& other)
+{
+	/* Our old fiber goes to other, to be deleted along with it. */
+	void* impl = _impl;
+	_impl = other._impl;
+	other._impl = impl;
+	return *this;
+}
+
+ga_fiber ga_fiber::convert_thread(void* data)
+{
+	assert(_current_fiber == 0);
+
+	ga_fiber_context_t* context = new ga_fiber_context_t();
+	context->_stack = 0;
+	context->_stack_size = 0;
+	context->_guard_size = 0;
+	context->_func = 0;
+	context->_data = data;
+	_current_fiber = context;
+
+	ga_fiber fiber;
+	fiber._impl = context;
+	return fiber;
+}
+
+void ga_fiber::switch_to(const ga_fiber& fiber)
+{
+	ga_fiber_context_t* from = _current_fiber;
+	ga_fiber_context_t* to = static_cast<ga_fiber_context_t*>(fiber._impl);
+	assert(from && from != to);
+
+	_current_fiber = to;
+#if defined(GA_FIBER_UCONTEXT)
+	swapcontext(&from->_context, &to->_context);
+#else
+	ga_fiber_switch_context(&from->_stack_pointer, to->_stack_pointer);
+#endif
+}
+
+void* ga_fiber::get_data()
+{
+	return _current_fiber->_data;
+}
+
+void ga_fiber::paint_stack()
+{
+	ga_fiber_context_t* context = _current_fiber;
+	if (!context || !context->_stack)
+	{
+		return;
+	}
+
+	/* Leave room below our frame, in case the loop becomes a call to memset. */
+	const size_t k_call_room = 1024;
+	uintptr_t* bottom = reinterpret_cast<uintptr_t*>(static_cast<char*>(context->_stack) + context->_guard_size);
+	uintptr_t* top = reinterpret_cast<uintptr_t*>((uintptr_t(&context) - k_call_room) & ~uintptr_t(sizeof(uintptr_t) - 1));
+
+	for (uintptr_t* word = bottom; word < top; ++word)
+	{
+		*word = k_stack_paint;
+	}
+}
+
+size_t ga_fiber::get_stack_used()
+{
+	ga_fiber_context_t* context = _current_fiber;
+	if (!context || !context->_stack)
+	{
+		return 0;
+	}
+
+	char* end = static_cast<char*>(context->_stack) + context->_stack_size;
+	const uintptr_t* word = reinterpret_cast<const uintptr_t*>(static_cast<char*>(context->_stack) + context->_guard_size);
+	while (reinterpret_cast<const char*>(word) < end && *word == k_stack_paint)
+	{
+		++word;
+	}
+	return size_t(end - reinterpret_cast<const char*>(word));
+}
+
+size_t ga_fiber::get_stack_size(size_t stack_size)
+{
+	const size_t k_page_size = size_t(sysconf(_SC_PAGESIZE));
+	stack_size = stack_size > k_page_size ? stack_size : k_page_size;
+	return (stack_size + k_page_size - 1) & ~(k_page_size - 1);
+}
+
+size_t ga_fiber::get_reserved_size(size_t stack_size)
+{
+	return get_stack_size(stack_size) + size_t(sysconf(_SC_PAGESIZE));
+}
+
+#endif
@@ -15,9 +15,18 @@
 #include <sys/types.h>
 #endif
 
+#include <cstddef>
+
 /*
 ** A fiber object.
 ** This the execution context for a thread including the registers and stack.
+**
+** Windows uses native fibers. Linux switches with hand-written assembly on x86-64
+** and AArch64, or ucontext elsewhere and when GA_FIBER_UCONTEXT is defined. Linux
+** stacks are mmapped, rounded up to whole pages, with an inaccessible guard page
+** below so an overflow faults instead of corrupting memory. Windows fiber stacks
+** come with a guard page already. A fiber may be resumed on a different thread
+** than the one that last switched away from it.
 */
 class ga_fiber
 {
@@ -35,6 +44,23 @@ public:
 	static void switch_to(const ga_fiber& fiber);
 	static void* get_data();
 
+	/*
+	** Fill the running fiber's stack below the caller with a known pattern, then
+	** measure how deep the stack has reached since, in bytes from its top. Only
+	** fibers with their own stacks are measured; elsewhere, and on Windows, painting
+	** does nothing and the depth reads zero.
+	*/
+	static void paint_stack();
+	static size_t get_stack_used();
+
+	/*
+	** The stack a fiber asked for stack_size bytes really gets, and the address
+	** space it reserves including its guard page. Windows reserves stacks in whole
+	** 64 KB blocks, so nothing there is smaller.
+	*/
+	static size_t get_stack_size(size_t stack_size);
+	static size_t get_reserved_size(size_t stack_size);
+
 private:
 	void* _impl;
 };
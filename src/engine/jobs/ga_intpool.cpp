@@ -78,20 +78,23 @@ int ga_intpool::alloc()
 
 	for (;;)
 	{
-		ga_intpool_pointer_t free_list = impl->_free_list;
+		ga_intpool_pointer_t free_list;
+		free_list._entire = impl->_free_list._atomic.load();
 
-		if (free_list._part._index != k_ga_intpool_invalid_index)
+		if (free_list._part._index == k_ga_intpool_invalid_index)
 		{
-			index = free_list._part._index;
-			ga_intpool_pointer_t next = impl->_nodes[index]._next;
-
-			ga_intpool_pointer_t link;
-			link._part._index = next._part._index;
-			link._part._count = free_list._part._count + 1;
-			if (impl->_free_list._atomic.compare_exchange_strong(free_list._entire, link._entire))
-			{
-				break;
-			}
+			return -1;
+		}
+
+		index = free_list._part._index;
+		ga_intpool_pointer_t next = impl->_nodes[index]._next;
+
+		ga_intpool_pointer_t link;
+		link._part._index = next._part._index;
+		link._part._count = free_list._part._count + 1;
+		if (impl->_free_list._atomic.compare_exchange_strong(free_list._entire, link._entire))
+		{
+			break;
 		}
 	}
 
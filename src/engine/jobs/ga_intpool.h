@@ -18,6 +18,9 @@ public:
 	ga_intpool(int index_count);
 	~ga_intpool();
 
+	/*
+	** Take a free index, or -1 if every index is taken.
+	*/
 	int alloc();
 	void free(int index);
 
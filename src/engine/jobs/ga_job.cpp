@@ -10,60 +10,207 @@
 #include "ga_job.h"
 
 #include "ga_condvar.h"
+#include "ga_deque.h"
 #include "ga_fiber.h"
 #include "ga_intpool.h"
+#include "ga_job_profiler.h"
 #include "ga_queue.h"
 
 #include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
 #include <thread>
 #include <vector>
 
 void* ga_job::_impl = 0;
 
+struct ga_job_system_impl_t;
+
 struct ga_job_instance_t
 {
 	ga_job_instance_t() {}
 
+	ga_job_system_impl_t* _system;
 	ga_job_decl_t* _decl;
 
-	int32_t* _waiting_count;
+	/* Set while the job is switching out to wait; the scheduler then parks it. */
+	ga_job_counter_t* _waiting_counter;
+	ga_job_instance_t* _next_waiter;
 
+	/* Index in its stack class's pool. */
 	int _pool_index;
 
 	ga_fiber _fiber;
 	ga_fiber* _parent_fiber;
 };
 
-struct ga_job_system_impl_t
+/*
+** Stack bytes each class asks for, and its share in eighths of the address space
+** reserved for stacks. That's fiber_count medium stacks, as when every fiber had
+** one.
+*/
+static const size_t k_job_stack_sizes[k_job_stack_count] = { 16 * 1024, 64 * 1024, 256 * 1024 };
+static const int k_job_stack_budget_eighths[k_job_stack_count] = { 1, 6, 1 };
+
+static int _ga_job_get_stack_fiber_count(int fiber_count, int stack)
 {
-	ga_job_system_impl_t(int queue_size, int fiber_count) :
-		_main_thread(std::this_thread::get_id()),
+	size_t budget = size_t(fiber_count) * k_job_stack_sizes[k_job_stack_medium] / 8 * k_job_stack_budget_eighths[stack];
+	int count = int(budget / ga_fiber::get_reserved_size(k_job_stack_sizes[stack]));
+	return count > 1 ? count : 1;
+}
+
+static int _ga_job_get_total_fiber_count(int fiber_count)
+{
+	int total = 0;
+	for (int i = 0; i < k_job_stack_count; ++i)
+	{
+		total += _ga_job_get_stack_fiber_count(fiber_count, i);
+	}
+	return total;
+}
+
+/*
+** The fibers of one stack class, and which are free.
+*/
+struct ga_job_stack_pool_t
+{
+	ga_job_stack_pool_t(int fiber_count, size_t stack_size) :
+		_free_instances(fiber_count),
+		_instances(new ga_job_instance_t[fiber_count]),
+		_stack_size(stack_size),
+		_stack_bytes(ga_fiber::get_stack_size(stack_size)),
+		_parked_count(0),
+		_parked_first(0),
+		_parked_last(0)
+	{
+		_lock.clear();
+	}
+	~ga_job_stack_pool_t() { delete[] _instances; }
+
+	ga_intpool _free_instances;
+	ga_job_instance_t* _instances;
+
+	/* What the class asks for, and what its fibers really got. */
+	size_t _stack_size;
+	size_t _stack_bytes;
+
+	/*
+	** Decls taken from the queues while every fiber was in use, oldest first. Each
+	** fiber freed goes to the first. The count is read without the lock, so freeing
+	** a fiber only takes the lock when something is parked.
+	*/
+	std::atomic_int _parked_count;
+	std::atomic_flag _lock;
+	ga_job_decl_t* _parked_first;
+	ga_job_decl_t* _parked_last;
+};
+
+struct ga_job_name_less_t
+{
+	bool operator()(const char* a, const char* b) const { return strcmp(a, b) < 0; }
+};
+
+/*
+** The queues holding jobs of one priority.
+*/
+struct ga_job_lane_t
+{
+	ga_job_lane_t(int queue_size, int fiber_count) :
 		_job_queue(queue_size),
-		_job_instance_pool(fiber_count),
-		_wait_queue(queue_size)
+		_ready_queue(fiber_count + 1)
 	{}
 
-	std::thread::id _main_thread;
-
+	/* Jobs run from outside the workers, and overflow from full worker deques. */
 	ga_queue _job_queue;
 
-	ga_intpool _job_instance_pool;
-	ga_job_instance_t* _job_instance_data;
+	/* Each worker runs jobs from its own deque first, and steals when it's empty. */
+	std::vector<ga_deque*> _worker_deques;
 
-	ga_queue _wait_queue;
+	/* Jobs whose counter drained while they waited on it, and parked decls given a fiber. */
+	ga_queue _ready_queue;
+};
 
-	std::vector<std::thread*> _worker_threads;
+struct ga_job_system_impl_t
+{
+	ga_job_system_impl_t(int queue_size, int fiber_count) :
+		_workers_started(0),
+		_main_thread_queue(queue_size),
+		_main_thread_ready_queue(_ga_job_get_total_fiber_count(fiber_count) + 1),
+		_background_running(0),
+		_paint_stacks(false),
+		_work_epoch(0),
+		_terminate(false)
+	{
+		for (int i = 0; i < k_job_priority_count; ++i)
+		{
+			_lanes[i] = new ga_job_lane_t(queue_size, _ga_job_get_total_fiber_count(fiber_count));
+		}
+		for (int i = 0; i < k_job_stack_count; ++i)
+		{
+			_stack_pools[i] = new ga_job_stack_pool_t(_ga_job_get_stack_fiber_count(fiber_count, i), k_job_stack_sizes[i]);
+		}
+	}
 
+	ga_job_lane_t* _lanes[k_job_priority_count];
+	ga_job_stack_pool_t* _stack_pools[k_job_stack_count];
+
+	std::vector<std::thread*> _worker_threads;
+	std::atomic_int _workers_started;
+
+	/*
+	** The thread that called startup. It runs jobs while it waits, using the deques
+	** after the workers'. Jobs marked _main_thread_only are queued only for it.
+	*/
+	int _main_thread_index;
+	ga_fiber _main_thread_fiber;
+	ga_queue _main_thread_queue;
+	ga_queue _main_thread_ready_queue;
+
+	/* Background jobs on workers right now, and the most allowed at once. */
+	std::atomic_int _background_running;
+	int _background_limit;
+
+	/* Set by set_stack_painting. Peak usage is kept per job name. */
+	std::atomic<bool> _paint_stacks;
+	std::mutex _stack_usage_mutex;
+	std::map<const char*, ga_job_stack_usage_t, ga_job_name_less_t> _stack_usage;
+
+	/*
+	** Bumped whenever jobs become runnable, so idle workers know to look again.
+	** Threads waiting on a counter sleep on the same condvar.
+	*/
+	std::atomic<uint32_t> _work_epoch;
 	ga_condvar _work_added;
-	ga_condvar _work_exhausted;
 
-	bool _terminate;
+	std::atomic<bool> _terminate;
 };
 
-static int _ga_job_instance_thread_worker(void* data);
+/* Index of the worker running on this thread, the main thread's index, or -1 for other threads. */
+static thread_local int _worker_index = -1;
+
+/* Normal jobs this worker has picked since it last picked a background job. */
+static thread_local int _picks_since_background = 0;
+
+static int _ga_job_instance_thread_worker(ga_job_system_impl_t* impl, int worker_index);
 static bool _ga_job_schedule(ga_job_system_impl_t* impl, ga_fiber* parent_fiber);
-static void _ga_job_run(ga_job_system_impl_t* impl, ga_fiber* parent_fiber, ga_job_instance_t* job);
+static bool _ga_job_schedule_main_thread(ga_job_system_impl_t* impl);
+static ga_queue* _ga_job_get_ready_queue(ga_job_system_impl_t* impl, ga_job_instance_t* job);
+static bool _ga_job_schedule_lane(ga_job_system_impl_t* impl, ga_fiber* parent_fiber, ga_job_priority_t priority);
+static ga_job_decl_t* _ga_job_steal(ga_job_lane_t* lane);
+static void _ga_job_park(ga_job_system_impl_t* impl, ga_job_instance_t* job);
+static void _ga_job_counter_lock(ga_job_counter_t* counter);
+static void _ga_job_counter_unlock(ga_job_counter_t* counter);
+static void _ga_job_stack_pool_lock(ga_job_stack_pool_t* pool);
+static void _ga_job_stack_pool_unlock(ga_job_stack_pool_t* pool);
+static void _ga_job_counter_decrement(ga_job_system_impl_t* impl, ga_job_counter_t* counter);
+static void _ga_job_add_work(ga_job_system_impl_t* impl);
+static ga_job_instance_t* _ga_job_alloc_instance(ga_job_system_impl_t* impl, ga_job_decl_t* decl);
+static void _ga_job_free_instance(ga_job_system_impl_t* impl, ga_job_instance_t* job);
+static void _ga_job_unpark_decls(ga_job_system_impl_t* impl, ga_job_stack_pool_t* pool);
+static void _ga_job_run(ga_job_system_impl_t* impl, ga_fiber* parent_fiber, ga_job_instance_t* job, bool stolen);
 static void _ga_job_fiber_worker(void* data);
+static void _ga_job_range_worker(void* data);
 
 void ga_job::startup(
 	uint32_t hardware_thread_mask,
@@ -72,24 +219,54 @@ void ga_job::startup(
 {
 	ga_job_system_impl_t* impl = new ga_job_system_impl_t(queue_size, fiber_count);
 
-	impl->_terminate = false;
-
-	impl->_job_instance_data = new ga_job_instance_t[fiber_count];
-	for (int i = 0; i < fiber_count; ++i)
+	for (int s = 0; s < k_job_stack_count; ++s)
 	{
-		ga_job_instance_t* instance = &impl->_job_instance_data[i];
-		instance->_fiber = ga_fiber(_ga_job_fiber_worker, instance, 64 * 1024);
-		instance->_pool_index = i;
+		ga_job_stack_pool_t* pool = impl->_stack_pools[s];
+		for (int i = 0; i < pool->_free_instances.get_index_count(); ++i)
+		{
+			ga_job_instance_t* instance = &pool->_instances[i];
+			instance->_system = impl;
+			instance->_fiber = ga_fiber(_ga_job_fiber_worker, instance, pool->_stack_size);
+			instance->_pool_index = i;
+		}
 	}
 
+	int worker_count = 0;
 	int hardware_thread_count = std::thread::hardware_concurrency();
 	for (int i = 0; i < hardware_thread_count; ++i)
 	{
 		if ((hardware_thread_mask & (1 << i)) != 0)
 		{
-			impl->_worker_threads.push_back(new std::thread(_ga_job_instance_thread_worker, impl));
+			++worker_count;
+		}
+	}
+
+	/* Leave a worker free for frame work, unless there's only one. */
+	impl->_background_limit = worker_count > 1 ? worker_count - 1 : 1;
+
+	_worker_index = impl->_main_thread_index = worker_count;
+	impl->_main_thread_fiber = ga_fiber::convert_thread(0);
+
+	ga_job_profiler::startup(worker_count);
+
+	/* Every deque exists before any worker starts looking for one to steal from. */
+	for (int p = 0; p < k_job_priority_count; ++p)
+	{
+		for (int i = 0; i <= worker_count; ++i)
+		{
+			impl->_lanes[p]->_worker_deques.push_back(new ga_deque(queue_size));
 		}
 	}
+	for (int i = 0; i < worker_count; ++i)
+	{
+		impl->_worker_threads.push_back(new std::thread(_ga_job_instance_thread_worker, impl, i));
+	}
+
+	/* Workers allocate as they start. Don't let that land in the caller's first frame. */
+	while (impl->_workers_started < worker_count)
+	{
+		std::this_thread::yield();
+	}
 
 	_impl = impl;
 }
@@ -105,129 +282,601 @@ void ga_job::shutdown()
 		t->join();
 		delete t;
 	}
+	for (int p = 0; p < k_job_priority_count; ++p)
+	{
+		for (auto& d : impl->_lanes[p]->_worker_deques)
+		{
+			delete d;
+		}
+		delete impl->_lanes[p];
+	}
+
+	for (int s = 0; s < k_job_stack_count; ++s)
+	{
+		delete impl->_stack_pools[s];
+	}
+
+	ga_job_profiler::shutdown();
 
-	delete[] impl->_job_instance_data;
+	impl->_main_thread_fiber = ga_fiber();
+	_worker_index = -1;
 }
 
-void ga_job::run(ga_job_decl_t* decls, int decl_count, int32_t* counter)
+void ga_job::run(ga_job_decl_t* decls, int decl_count, ga_job_counter_t* counter)
 {
-	*counter = decl_count;
+	/* The last decrement of the counter's previous use may still hold the lock. */
+	_ga_job_counter_lock(counter);
+	counter->_value = decl_count;
+	_ga_job_counter_unlock(counter);
 
 	ga_job_system_impl_t* impl = static_cast<ga_job_system_impl_t*>(_impl);
 	for (int i = 0; i < decl_count; ++i)
 	{
 		decls[i]._pending_count = counter;
-		impl->_job_queue.push(decls + i);
+
+		if (decls[i]._main_thread_only)
+		{
+			impl->_main_thread_queue.push(decls + i);
+			continue;
+		}
+
+		ga_job_lane_t* lane = impl->_lanes[decls[i]._priority];
+		if (_worker_index < 0 || !lane->_worker_deques[_worker_index]->push(decls + i))
+		{
+			lane->_job_queue.push(decls + i);
+		}
 	}
 
-	impl->_work_added.wake_all();
+	_ga_job_add_work(impl);
 }
 
-void ga_job::wait(int32_t* counter)
+void ga_job::wait(ga_job_counter_t* counter)
 {
-	if (*counter > 0)
+	if (counter->_value > 0)
 	{
+		ga_job_system_impl_t* impl = static_cast<ga_job_system_impl_t*>(_impl);
+		ga_job_instance_t* job = _worker_index >= 0 ? static_cast<ga_job_instance_t*>(ga_fiber::get_data()) : 0;
+
 		/*
-		** If we're not the main thread, assume we're waiting from within a job.
-		** In this case, push the current job onto the wait list, and reschedule.
+		** Within a job, switch back to the scheduler, which parks the job on the
+		** counter. Parking it here would let another worker resume this fiber before
+		** we've switched off it.
 		*/
-		ga_job_system_impl_t* impl = static_cast<ga_job_system_impl_t*>(_impl);
-		if (std::this_thread::get_id() != impl->_main_thread)
+		ga_job_profiler::record(_worker_index, k_job_event_wait, job ? job->_decl->_name : 0);
+
+		if (job)
 		{
-			ga_job_instance_t* job = static_cast<ga_job_instance_t*>(ga_fiber::get_data());
-			job->_waiting_count = counter;
-			impl->_wait_queue.push(job);
+			job->_waiting_counter = counter;
 
 			ga_fiber::switch_to(*job->_parent_fiber);
 		}
 		/*
-		** Otherwise, in the main thread, block until jobs are complete.
+		** On the main thread, run jobs until the counter drains, sleeping only when
+		** there are none it can take.
 		*/
-		else
+		else if (_worker_index == impl->_main_thread_index)
 		{
-			while (*counter > 0)
+			_ga_job_counter_lock(counter);
+			counter->_thread_waiting = true;
+			_ga_job_counter_unlock(counter);
+
+			while (counter->_value > 0)
 			{
-				impl->_work_exhausted.wait();
+				uint32_t epoch = impl->_work_epoch;
+				if (!_ga_job_schedule_main_thread(impl))
+				{
+					ga_job_profiler::record(_worker_index, k_job_event_idle_begin);
+					impl->_work_added.wait([impl, counter, epoch]() { return counter->_value == 0 || impl->_work_epoch != epoch; });
+					ga_job_profiler::record(_worker_index, k_job_event_idle_end);
+				}
 			}
+			ga_job_profiler::record(_worker_index, k_job_event_wait_end);
+		}
+		/*
+		** Otherwise, block the thread until the final decrement wakes it.
+		*/
+		else
+		{
+			_ga_job_counter_lock(counter);
+			counter->_thread_waiting = true;
+			_ga_job_counter_unlock(counter);
+
+			impl->_work_added.wait([counter]() { return counter->_value == 0; });
+		}
+	}
+
+	/* The decrement that drained the counter may still hold its lock. Let it finish before the counter can go away. */
+	_ga_job_counter_lock(counter);
+	_ga_job_counter_unlock(counter);
+}
+
+/*
+** A piece of a parallel_for range, run as one job.
+*/
+struct ga_job_range_t
+{
+	ga_job_system_impl_t* _impl;
+	ga_job_range_function_t _func;
+	void* _data;
+	int _begin;
+	int _end;
+	int _grain;
+	ga_job_priority_t _priority;
+};
+
+void ga_job::parallel_for(int begin, int end, int grain, ga_job_range_function_t func, void* data,
+	ga_job_priority_t priority)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	ga_job_range_t range;
+	range._impl = static_cast<ga_job_system_impl_t*>(_impl);
+	range._func = func;
+	range._data = data;
+	range._begin = begin;
+	range._end = end;
+	range._grain = grain > 0 ? grain : 1;
+	range._priority = priority;
+
+	ga_job_decl_t decl;
+	decl._entry = _ga_job_range_worker;
+	decl._data = &range;
+	decl._name = "parallel_for";
+	decl._priority = priority;
+
+	ga_job_counter_t counter;
+	run(&decl, 1, &counter);
+	wait(&counter);
+}
+
+void ga_job::set_stack_painting(bool enabled)
+{
+	ga_job_system_impl_t* impl = static_cast<ga_job_system_impl_t*>(_impl);
+	if (enabled)
+	{
+		std::lock_guard<std::mutex> lock(impl->_stack_usage_mutex);
+		impl->_stack_usage.clear();
+	}
+	impl->_paint_stacks = enabled;
+}
+
+void ga_job::get_stack_usage(std::vector<ga_job_stack_usage_t>* usage)
+{
+	ga_job_system_impl_t* impl = static_cast<ga_job_system_impl_t*>(_impl);
+
+	std::lock_guard<std::mutex> lock(impl->_stack_usage_mutex);
+	usage->clear();
+	for (auto& u : impl->_stack_usage)
+	{
+		usage->push_back(u.second);
+	}
+}
+
+static void _ga_job_range_worker(void* data)
+{
+	ga_job_range_t* range = static_cast<ga_job_range_t*>(data);
+	ga_job_system_impl_t* impl = range->_impl;
+
+	/*
+	** Halving leaves at most one split per bit of the range, so the pieces split off
+	** fit on this job's stack. They're waited on before returning.
+	*/
+	const int k_max_splits = 32;
+	ga_job_range_t splits[k_max_splits];
+	ga_job_decl_t split_decls[k_max_splits];
+	ga_job_counter_t split_counters[k_max_splits];
+	int split_count = 0;
+
+	int begin = range->_begin;
+	int end = range->_end;
+	bool can_split = impl->_worker_threads.size() > 0;
+	while (begin < end)
+	{
+		int chunk_end = end - begin > range->_grain ? begin + range->_grain : end;
+		range->_func(begin, chunk_end, range->_data);
+		begin = chunk_end;
+
+		/* An empty deque means nobody's left work queued here; feed the idle workers. */
+		ga_deque* deque = impl->_lanes[range->_priority]->_worker_deques[_worker_index];
+		if (can_split && end - begin > range->_grain && split_count < k_max_splits && deque->get_count() == 0)
+		{
+			int middle = begin + (end - begin) / 2;
+
+			ga_job_range_t* split = &splits[split_count];
+			*split = *range;
+			split->_begin = middle;
+			split->_end = end;
+			end = middle;
+
+			split_decls[split_count]._entry = _ga_job_range_worker;
+			split_decls[split_count]._name = "parallel_for";
+			split_decls[split_count]._data = split;
+			split_decls[split_count]._priority = range->_priority;
+			ga_job::run(&split_decls[split_count], 1, &split_counters[split_count]);
+			++split_count;
 		}
 	}
+
+	for (int i = split_count - 1; i >= 0; --i)
+	{
+		ga_job::wait(&split_counters[i]);
+	}
 }
 
-static int _ga_job_instance_thread_worker(void* data)
+static int _ga_job_instance_thread_worker(ga_job_system_impl_t* impl, int worker_index)
 {
-	ga_job_system_impl_t* impl = static_cast<ga_job_system_impl_t*>(data);
+	_worker_index = worker_index;
 
 	ga_fiber parent_fiber = ga_fiber::convert_thread(0);
+	impl->_workers_started++;
 
 	while (!impl->_terminate)
 	{
+		uint32_t epoch = impl->_work_epoch;
 		if (!_ga_job_schedule(impl, &parent_fiber))
 		{
-			impl->_work_exhausted.wake_all();
-			impl->_work_added.wait_for(1000);
+			ga_job_profiler::record(_worker_index, k_job_event_idle_begin);
+			impl->_work_added.wait([impl, epoch]() { return impl->_work_epoch != epoch || impl->_terminate; });
+			ga_job_profiler::record(_worker_index, k_job_event_idle_end);
 		}
 	}
 
 	return 0;
 }
 
-static bool _ga_job_schedule(ga_job_system_impl_t* impl, ga_fiber* parent_fiber)
+/*
+** The main thread takes its own jobs first, then critical and normal work. It
+** never starts background jobs, which could hold it for frames.
+*/
+static bool _ga_job_schedule_main_thread(ga_job_system_impl_t* impl)
 {
-	/* Check for waiting jobs that are ready to run. */
+	ga_fiber* parent_fiber = &impl->_main_thread_fiber;
+
 	ga_job_instance_t* job;
-	int retry_wait_count = impl->_wait_queue.get_count();
-	while (retry_wait_count-- > 0 && impl->_wait_queue.pop((void**)&job))
+	ga_job_decl_t* decl;
+	if (impl->_main_thread_ready_queue.pop((void**)&job))
 	{
-		if (job->_waiting_count == 0 || job->_waiting_count[0] == 0)
+		_ga_job_run(impl, parent_fiber, job, false);
+		return true;
+	}
+	if (impl->_main_thread_queue.pop((void**)&decl))
+	{
+		job = _ga_job_alloc_instance(impl, decl);
+		if (job)
 		{
-			_ga_job_run(impl, parent_fiber, job);
-			return true;
+			_ga_job_run(impl, parent_fiber, job, false);
 		}
-		else
+		return true;
+	}
+
+	return
+		_ga_job_schedule_lane(impl, parent_fiber, k_job_priority_critical) ||
+		_ga_job_schedule_lane(impl, parent_fiber, k_job_priority_normal);
+}
+
+static bool _ga_job_schedule(ga_job_system_impl_t* impl, ga_fiber* parent_fiber)
+{
+	if (_ga_job_schedule_lane(impl, parent_fiber, k_job_priority_critical))
+	{
+		return true;
+	}
+
+	/* Normal jobs go first, except every k_job_background_interval picks, so background work can't starve. */
+	bool background_due = _picks_since_background >= k_job_background_interval - 1;
+	ga_job_priority_t first = background_due ? k_job_priority_background : k_job_priority_normal;
+	ga_job_priority_t second = background_due ? k_job_priority_normal : k_job_priority_background;
+	return
+		_ga_job_schedule_lane(impl, parent_fiber, first) ||
+		_ga_job_schedule_lane(impl, parent_fiber, second);
+}
+
+static bool _ga_job_schedule_lane(ga_job_system_impl_t* impl, ga_fiber* parent_fiber, ga_job_priority_t priority)
+{
+	if (priority == k_job_priority_background)
+	{
+		/* Claim a background slot before looking, so workers can't all take one at once. */
+		if (++impl->_background_running > impl->_background_limit)
 		{
-			impl->_wait_queue.push(job);
+			impl->_background_running--;
+			return false;
 		}
 	}
 
-	/* Look for queued jobs. */
-	ga_job_decl_t* decl;
-	if (impl->_job_queue.pop((void**)&decl))
+	bool found = false;
+	ga_job_lane_t* lane = impl->_lanes[priority];
+
+	/* Resume waiting jobs first; their counters have drained. */
+	ga_job_instance_t* job = 0;
+	ga_job_decl_t* decl = 0;
+	bool stolen = false;
+	if (lane->_ready_queue.pop((void**)&job))
+	{
+		found = true;
+	}
+	/*
+	** Look for queued jobs: newest first from our own deque, then oldest first from
+	** the shared queue and other workers' deques.
+	*/
+	else if (lane->_worker_deques[_worker_index]->pop((void**)&decl) ||
+		lane->_job_queue.pop((void**)&decl) ||
+		(stolen = (decl = _ga_job_steal(lane)) != 0))
+	{
+		job = _ga_job_alloc_instance(impl, decl);
+		found = true;
+	}
+
+	/* A decl parked for want of a fiber still counts as found, so the lane is looked at again. */
+	if (job)
+	{
+		_picks_since_background = priority == k_job_priority_background ? 0 : _picks_since_background + 1;
+		_ga_job_run(impl, parent_fiber, job, stolen);
+	}
+
+	if (priority == k_job_priority_background)
+	{
+		impl->_background_running--;
+	}
+	return found;
+}
+
+static ga_job_decl_t* _ga_job_steal(ga_job_lane_t* lane)
+{
+	/* Start at a random victim so thieves spread out instead of all hitting worker 0. */
+	static thread_local uint32_t random = 0x9e3779b9u * uint32_t(_worker_index + 1);
+	random ^= random << 13;
+	random ^= random >> 17;
+	random ^= random << 5;
+
+	int worker_count = int(lane->_worker_deques.size());
+	int first = int(random % uint32_t(worker_count));
+	for (int i = 0; i < worker_count; ++i)
 	{
-		int ga_job_index = impl->_job_instance_pool.alloc();
+		int victim = (first + i) % worker_count;
+		ga_job_decl_t* decl;
+		if (victim != _worker_index && lane->_worker_deques[victim]->steal((void**)&decl))
+		{
+			return decl;
+		}
+	}
+	return 0;
+}
+
+/*
+** Returns 0 if every fiber of the decl's class is in use. The decl is then parked
+** on the pool, and handed the next fiber freed through its ready queue.
+*/
+static ga_job_instance_t* _ga_job_alloc_instance(ga_job_system_impl_t* impl, ga_job_decl_t* decl)
+{
+	ga_job_stack_pool_t* pool = impl->_stack_pools[decl->_stack];
 
-		job = &impl->_job_instance_data[ga_job_index];
+	int index = pool->_free_instances.alloc();
+	if (index >= 0)
+	{
+		ga_job_instance_t* job = &pool->_instances[index];
 		job->_decl = decl;
-		job->_pool_index = ga_job_index;
+		return job;
+	}
 
-		_ga_job_run(impl, parent_fiber, job);
+	_ga_job_stack_pool_lock(pool);
+	decl->_next_parked = 0;
+	if (pool->_parked_last)
+	{
+		pool->_parked_last->_next_parked = decl;
+	}
+	else
+	{
+		pool->_parked_first = decl;
+	}
+	pool->_parked_last = decl;
+	pool->_parked_count++;
+	_ga_job_stack_pool_unlock(pool);
 
-		return true;
+	/* A fiber freed before the count went up wasn't handed on. Look again. */
+	_ga_job_unpark_decls(impl, pool);
+	return 0;
+}
+
+static void _ga_job_free_instance(ga_job_system_impl_t* impl, ga_job_instance_t* job)
+{
+	ga_job_stack_pool_t* pool = impl->_stack_pools[job->_decl->_stack];
+
+	/*
+	** Both sides are sequentially consistent: either this sees the parked count go
+	** up, or the parking thread's retry sees the fiber.
+	*/
+	pool->_free_instances.free(job->_pool_index);
+	if (pool->_parked_count > 0)
+	{
+		_ga_job_unpark_decls(impl, pool);
 	}
+}
+
+/*
+** Give free fibers to parked decls, and queue them to run as jobs that were
+** already waiting.
+*/
+static void _ga_job_unpark_decls(ga_job_system_impl_t* impl, ga_job_stack_pool_t* pool)
+{
+	bool unparked = false;
+
+	_ga_job_stack_pool_lock(pool);
+	while (pool->_parked_first)
+	{
+		int index = pool->_free_instances.alloc();
+		if (index < 0)
+		{
+			break;
+		}
 
-	return impl->_wait_queue.get_count() != 0;
+		ga_job_decl_t* decl = pool->_parked_first;
+		pool->_parked_first = decl->_next_parked;
+		if (!pool->_parked_first)
+		{
+			pool->_parked_last = 0;
+		}
+		pool->_parked_count--;
+
+		ga_job_instance_t* job = &pool->_instances[index];
+		job->_decl = decl;
+		_ga_job_get_ready_queue(impl, job)->push(job);
+		unparked = true;
+	}
+	_ga_job_stack_pool_unlock(pool);
+
+	if (unparked)
+	{
+		_ga_job_add_work(impl);
+	}
+}
+
+static void _ga_job_stack_pool_lock(ga_job_stack_pool_t* pool)
+{
+	while (pool->_lock.test_and_set(std::memory_order_acquire))
+	{
+		std::this_thread::yield();
+	}
+}
+
+static void _ga_job_stack_pool_unlock(ga_job_stack_pool_t* pool)
+{
+	pool->_lock.clear(std::memory_order_release);
 }
 
-static void _ga_job_run(ga_job_system_impl_t* impl, ga_fiber* parent_fiber, ga_job_instance_t* job)
+static void _ga_job_run(ga_job_system_impl_t* impl, ga_fiber* parent_fiber, ga_job_instance_t* job, bool stolen)
 {
 	job->_parent_fiber = parent_fiber;
-	job->_waiting_count = 0;
+	job->_waiting_counter = 0;
 
+	ga_job_profiler::record_run_begin(_worker_index, job->_decl->_name, stolen);
 	ga_fiber::switch_to(job->_fiber);
 
-	if (job->_waiting_count == 0 || job->_waiting_count[0] == 0)
+	/* A job that returned here while waiting hasn't finished, even if its counter has since drained. */
+	if (job->_waiting_counter == 0)
+	{
+		/* Once freed, the instance may be reused by another worker. */
+		ga_job_counter_t* counter = job->_decl->_pending_count;
+		_ga_job_free_instance(impl, job);
+
+		_ga_job_counter_decrement(impl, counter);
+	}
+	else
+	{
+		_ga_job_park(impl, job);
+	}
+}
+
+static void _ga_job_park(ga_job_system_impl_t* impl, ga_job_instance_t* job)
+{
+	ga_job_counter_t* counter = job->_waiting_counter;
+
+	_ga_job_counter_lock(counter);
+	if (counter->_value == 0)
 	{
-		impl->_job_instance_pool.free(job->_pool_index);
+		/* Drained between the job's check and now. */
+		_ga_job_counter_unlock(counter);
+		_ga_job_get_ready_queue(impl, job)->push(job);
+		return;
+	}
 
-		(*reinterpret_cast<std::atomic_int*>(job->_decl->_pending_count))--;
+	job->_next_waiter = counter->_waiters;
+	counter->_waiters = job;
+	_ga_job_counter_unlock(counter);
+}
+
+static void _ga_job_counter_lock(ga_job_counter_t* counter)
+{
+	while (counter->_lock.test_and_set(std::memory_order_acquire))
+	{
+		std::this_thread::yield();
 	}
 }
 
+static void _ga_job_counter_unlock(ga_job_counter_t* counter)
+{
+	counter->_lock.clear(std::memory_order_release);
+}
+
+static void _ga_job_counter_decrement(ga_job_system_impl_t* impl, ga_job_counter_t* counter)
+{
+	ga_job_instance_t* waiters = 0;
+	bool thread_waiting = false;
+
+	_ga_job_counter_lock(counter);
+	if (--counter->_value == 0)
+	{
+		waiters = counter->_waiters;
+		thread_waiting = counter->_thread_waiting;
+		counter->_waiters = 0;
+		counter->_thread_waiting = false;
+	}
+	_ga_job_counter_unlock(counter);
+
+	/* The counter's owner may free it once unlocked, so only what we took from it is used below. */
+	if (waiters)
+	{
+		while (waiters)
+		{
+			ga_job_instance_t* next = waiters->_next_waiter;
+			_ga_job_get_ready_queue(impl, waiters)->push(waiters);
+			waiters = next;
+		}
+		_ga_job_add_work(impl);
+	}
+	else if (thread_waiting)
+	{
+		impl->_work_added.wake_all();
+	}
+}
+
+static ga_queue* _ga_job_get_ready_queue(ga_job_system_impl_t* impl, ga_job_instance_t* job)
+{
+	return job->_decl->_main_thread_only ? &impl->_main_thread_ready_queue : &impl->_lanes[job->_decl->_priority]->_ready_queue;
+}
+
+static void _ga_job_add_work(ga_job_system_impl_t* impl)
+{
+	impl->_work_epoch++;
+	impl->_work_added.wake_all();
+}
+
+static void _ga_job_record_stack_usage(ga_job_system_impl_t* impl, ga_job_decl_t* decl, size_t used)
+{
+	const char* name = decl->_name ? decl->_name : "unnamed";
+	size_t stack_bytes = impl->_stack_pools[decl->_stack]->_stack_bytes;
+
+	std::lock_guard<std::mutex> lock(impl->_stack_usage_mutex);
+	auto it = impl->_stack_usage.find(name);
+	if (it == impl->_stack_usage.end())
+	{
+		ga_job_stack_usage_t usage = { name, 0, 0 };
+		it = impl->_stack_usage.insert(std::make_pair(name, usage)).first;
+	}
+	it->second._peak_bytes = used > it->second._peak_bytes ? used : it->second._peak_bytes;
+	it->second._stack_bytes = stack_bytes > it->second._stack_bytes ? stack_bytes : it->second._stack_bytes;
+}
+
 static void _ga_job_fiber_worker(void* data)
 {
+	/* Each fiber belongs to one instance for life, and runs every job given to it. */
+	ga_job_instance_t* job = static_cast<ga_job_instance_t*>(data);
 	for (;;)
 	{
-		ga_job_instance_t* job = static_cast<ga_job_instance_t*>(ga_fiber::get_data());
+		/* Decided once per job, so a stack is never measured without being painted first. */
+		bool paint = job->_system->_paint_stacks;
+		if (paint)
+		{
+			ga_fiber::paint_stack();
+		}
+
 		job->_decl->_entry(job->_decl->_data);
+
+		if (paint)
+		{
+			_ga_job_record_stack_usage(job->_system, job->_decl, ga_fiber::get_stack_used());
+		}
 		ga_fiber::switch_to(*job->_parent_fiber);
 	}
 }
@@ -11,22 +11,115 @@
 ** Based on: "Parallelizing the Naughty Dog Engine Using Fibers", Christian Gyrling
 */
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 
 /*
 ** Job entry point.
 */
 typedef void(*ga_job_function_t)(void* data);
 
+/*
+** Range entry point for parallel_for. Called on consecutive pieces of the range.
+*/
+typedef void(*ga_job_range_function_t)(int begin, int end, void* data);
+
+struct ga_job_instance_t;
+
+/*
+** Counts the jobs in a batch that haven't finished.
+** Jobs that wait on a counter are parked on it, costing nothing until the decrement
+** that takes it to zero moves them to the ready queue. A counter must outlive the
+** wait on it, and can be reused once the wait returns.
+*/
+struct ga_job_counter_t
+{
+	ga_job_counter_t() : _value(0), _waiters(0), _thread_waiting(false) { _lock.clear(); }
+
+	std::atomic<int32_t> _value;
+
+	/*
+	** Guards the waiters, and every change of _value once a decl counting on it may
+	** be queued. Before that, nothing else touches _value and it may be stored
+	** without the lock.
+	*/
+	std::atomic_flag _lock;
+	ga_job_instance_t* _waiters;
+	bool _thread_waiting;
+};
+
+/*
+** Scheduling priority of a job.
+** Critical jobs always run first, so keep them short. Background jobs get at least
+** one pick in k_job_background_interval while other work is queued, and never hold
+** every worker at once, so long tasks can run across frames without holding up
+** frame work.
+*/
+enum ga_job_priority_t
+{
+	k_job_priority_critical,
+	k_job_priority_normal,
+	k_job_priority_background,
+	k_job_priority_count,
+};
+
+static const int k_job_background_interval = 8;
+
+/*
+** Stack size class of the fiber a job runs on: 16, 64 or 256 KB, or on Windows
+** at least 64 KB. Each class has its own fibers. A job taken from a queue while
+** every fiber of its class is in use is set aside until one is freed, and the
+** worker moves on.
+*/
+enum ga_job_stack_t
+{
+	k_job_stack_small,
+	k_job_stack_medium,
+	k_job_stack_large,
+	k_job_stack_count,
+};
+
+/*
+** Deepest stack seen across runs of jobs with one name, while stacks were painted.
+*/
+struct ga_job_stack_usage_t
+{
+	const char* _name;
+	size_t _peak_bytes;
+	size_t _stack_bytes;
+};
+
 /*
 ** Defines a job.
 */
 struct ga_job_decl_t
 {
+	ga_job_decl_t() :
+		_entry(0), _data(0), _name(0), _priority(k_job_priority_normal), _stack(k_job_stack_medium), _main_thread_only(false), _pending_count(0),
+		_next_parked(0)
+	{}
+
 	ga_job_function_t _entry;
 	void* _data;
 
-	int32_t* _pending_count;
+	/* Shown by ga_job_profiler. Must outlive the profiler's dump, like a literal. */
+	const char* _name;
+
+	ga_job_priority_t _priority;
+	ga_job_stack_t _stack;
+
+	/*
+	** Run only on the thread that called startup, for work that must stay on it
+	** such as GL calls. Such jobs run when that thread waits on a counter.
+	*/
+	bool _main_thread_only;
+
+	ga_job_counter_t* _pending_count;
+
+	/* Links decls waiting for a fiber of their stack class. */
+	ga_job_decl_t* _next_parked;
 };
 
 /*
@@ -35,6 +128,11 @@ struct ga_job_decl_t
 class ga_job
 {
 public:
+	/*
+	** Fiber stacks reserve as much address space as fiber_count medium stacks: an
+	** eighth for small stacks, an eighth for large and the rest for medium. Each
+	** class gets at least one fiber.
+	*/
 	static void startup(
 		uint32_t hardware_thread_mask,
 		int queue_size,
@@ -42,9 +140,39 @@ public:
 
 	static void shutdown();
 
-	static void run(ga_job_decl_t* decls, int decl_count, int32_t* counter);
+	static void run(ga_job_decl_t* decls, int decl_count, ga_job_counter_t* counter);
+
+	/*
+	** Wait for the counter to reach zero. Jobs are parked and their worker moves on.
+	** The thread that called startup runs critical, normal and its own jobs until
+	** the counter drains. Other threads block.
+	*/
+	static void wait(ga_job_counter_t* counter);
+
+	/*
+	** Call func over [begin, end) in parallel, and wait for it to finish.
+	** Each job works through its range grain items at a time. It only splits off the
+	** back half of what's left when its deque is empty, meaning the last half it split
+	** off was stolen by an idle worker. Job count therefore follows how many workers
+	** are hungry, not how long the range is.
+	*/
+	static void parallel_for(int begin, int end, int grain, ga_job_range_function_t func, void* data,
+		ga_job_priority_t priority = k_job_priority_normal);
+
+	/*
+	** Paint each fiber's stack before it runs a job and measure it afterward, or
+	** stop. Turning it on clears earlier measurements. Painting costs a pass over
+	** the stack per job and commits every page of it, so it's for finding how big
+	** stacks need to be, not for shipping.
+	*/
+	static void set_stack_painting(bool enabled);
 
-	static void wait(int32_t* counter);
+	/*
+	** Peak stack usage measured so far, one entry per job name, sorted by name.
+	** Unnamed jobs share one entry. Stack bytes are the largest class they ran
+	** in, at the size its fibers really got.
+	*/
+	static void get_stack_usage(std::vector<ga_job_stack_usage_t>* usage);
 
 private:
 	static void* _impl;
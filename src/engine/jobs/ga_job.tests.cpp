@@ -0,0 +1,602 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_job.tests.h"
+#include "ga_job.h"
+
+#include "ga_deque.h"
+#include "ga_fiber.h"
+#include "ga_job_profiler.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct fiber_ping_pong_t
+{
+	ga_fiber* _thread_fiber;
+	int _round_trips;
+	double _accumulator;
+};
+
+static void fiber_ping_pong(void* data)
+{
+	fiber_ping_pong_t* ping_pong = static_cast<fiber_ping_pong_t*>(data);
+
+	// Floating point state lives in callee-saved registers across the switches.
+	double accumulator = 0.0;
+	for (;;)
+	{
+		assert(ga_fiber::get_data() == ping_pong);
+		accumulator += 0.5;
+		ping_pong->_accumulator = accumulator;
+		++ping_pong->_round_trips;
+		ga_fiber::switch_to(*ping_pong->_thread_fiber);
+	}
+}
+
+struct job_tree_t
+{
+	std::atomic_int* _leaf_count;
+	int _depth;
+};
+
+static void job_tree(void* data)
+{
+	job_tree_t* node = static_cast<job_tree_t*>(data);
+	if (node->_depth == 0)
+	{
+		(*node->_leaf_count)++;
+		return;
+	}
+
+	const int k_child_count = 4;
+	job_tree_t children[k_child_count];
+	ga_job_decl_t decls[k_child_count];
+	for (int i = 0; i < k_child_count; ++i)
+	{
+		children[i]._leaf_count = node->_leaf_count;
+		children[i]._depth = node->_depth - 1;
+		decls[i]._entry = job_tree;
+		decls[i]._data = &children[i];
+	}
+
+	// Waiting suspends this job's fiber, which may resume on another worker.
+	ga_job_counter_t counter;
+	ga_job::run(decls, k_child_count, &counter);
+	ga_job::wait(&counter);
+	assert(counter._value == 0);
+}
+
+struct gated_waiter_t
+{
+	ga_job_counter_t* _gate;
+	std::atomic_int* _resumed_count;
+};
+
+static void gated_waiter(void* data)
+{
+	gated_waiter_t* waiter = static_cast<gated_waiter_t*>(data);
+	ga_job::wait(waiter->_gate);
+	assert(waiter->_gate->_value == 0);
+	(*waiter->_resumed_count)++;
+}
+
+struct gate_t
+{
+	ga_job_decl_t* _waiter_decls;
+	int _waiter_count;
+	ga_job_counter_t _waiter_counter;
+	std::atomic_int _open;
+};
+
+static void gate_job(void* data)
+{
+	gate_t* gate = static_cast<gate_t*>(data);
+
+	// The delay is queued before the waiters, so a worker popping its own deque
+	// starts the waiters first and they park on the gate while it's still closed.
+	ga_job_decl_t delay_decl;
+	delay_decl._entry = [](void*) { std::this_thread::sleep_for(std::chrono::milliseconds(10)); };
+	delay_decl._data = 0;
+	ga_job_counter_t delay_counter;
+	ga_job::run(&delay_decl, 1, &delay_counter);
+
+	ga_job::run(gate->_waiter_decls, gate->_waiter_count, &gate->_waiter_counter);
+
+	ga_job::wait(&delay_counter);
+	gate->_open = 1;
+}
+
+struct sequenced_job_t
+{
+	std::atomic_int* _sequence;
+	std::atomic_bool* _queued;
+	int _position;
+};
+
+static void sequenced_job(void* data)
+{
+	sequenced_job_t* job = static_cast<sequenced_job_t*>(data);
+
+	// Workers that stole a job while the rest were still being queued hold it until
+	// everything is queued, so the order below is the scheduler's choice.
+	while (!*job->_queued)
+	{
+		std::this_thread::yield();
+	}
+	job->_position = (*job->_sequence)++;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	while (std::chrono::high_resolution_clock::now() - start < std::chrono::microseconds(20)) {}
+}
+
+struct priority_spawner_t
+{
+	static const int k_normal_count = 200;
+
+	sequenced_job_t _normal_jobs[k_normal_count];
+	ga_job_decl_t _normal_decls[k_normal_count];
+	ga_job_counter_t _normal_counter;
+
+	sequenced_job_t _critical_job;
+	ga_job_decl_t _critical_decl;
+	ga_job_counter_t _critical_counter;
+
+	sequenced_job_t _background_job;
+	ga_job_decl_t _background_decl;
+	ga_job_counter_t _background_counter;
+
+	std::atomic_bool _queued;
+};
+
+static void priority_spawner(void* data)
+{
+	// Queue everything from one worker so it's all waiting before the scheduler picks.
+	priority_spawner_t* spawner = static_cast<priority_spawner_t*>(data);
+	ga_job::run(spawner->_normal_decls, priority_spawner_t::k_normal_count, &spawner->_normal_counter);
+	ga_job::run(&spawner->_critical_decl, 1, &spawner->_critical_counter);
+	ga_job::run(&spawner->_background_decl, 1, &spawner->_background_counter);
+	spawner->_queued = true;
+}
+
+struct range_visits_t
+{
+	std::atomic_int* _visits;
+	std::atomic_int _call_count;
+};
+
+static void count_range_visits(int begin, int end, void* data)
+{
+	range_visits_t* visits = static_cast<range_visits_t*>(data);
+	assert(begin < end);
+	for (int i = begin; i < end; ++i)
+	{
+		visits->_visits[i]++;
+	}
+	visits->_call_count++;
+}
+
+static void nested_parallel_for(void* data)
+{
+	range_visits_t* visits = static_cast<range_visits_t*>(data);
+	ga_job::parallel_for(0, 1000, 16, count_range_visits, visits);
+}
+
+struct main_thread_job_t
+{
+	ga_job_decl_t _decl;
+	ga_job_counter_t _counter;
+	std::thread::id _ran_on;
+};
+
+static void main_thread_spawner(void* data)
+{
+	main_thread_job_t* job = static_cast<main_thread_job_t*>(data);
+	ga_job::run(&job->_decl, 1, &job->_counter);
+	ga_job::wait(&job->_counter);
+}
+
+static void deep_stack_job(void* data)
+{
+	volatile char buffer[8 * 1024];
+	for (int i = 0; i < int(sizeof(buffer)); ++i)
+	{
+		buffer[i] = char(i);
+	}
+	(*static_cast<std::atomic_int*>(data))++;
+}
+
+void ga_job_unit_tests()
+{
+	// Test switching between a thread and a fiber. Runs on its own thread so the
+	// caller's thread isn't converted.
+	{
+		std::thread thread([]()
+		{
+			int thread_data = 7;
+			ga_fiber thread_fiber = ga_fiber::convert_thread(&thread_data);
+
+			fiber_ping_pong_t ping_pong;
+			ping_pong._thread_fiber = &thread_fiber;
+			ping_pong._round_trips = 0;
+			ping_pong._accumulator = 0.0;
+			ga_fiber fiber(fiber_ping_pong, &ping_pong, 64 * 1024);
+
+			double sum = 0.25;
+			for (int i = 0; i < 1000; ++i)
+			{
+				ga_fiber::switch_to(fiber);
+				sum += 1.0;
+				assert(ga_fiber::get_data() == &thread_data);
+			}
+			assert(ping_pong._round_trips == 1000);
+			assert(ping_pong._accumulator == 500.0);
+			assert(sum == 1000.25);
+		});
+		thread.join();
+	}
+
+	// Test that every item pushed onto a deque is taken exactly once, whether the
+	// owner pops it or a thief steals it.
+	{
+		const int k_item_count = 100000;
+		const int k_thief_count = 3;
+		std::vector<std::atomic_int> taken(k_item_count);
+		for (auto& t : taken)
+		{
+			t = 0;
+		}
+		std::vector<int> items(k_item_count);
+
+		ga_deque deque(64);
+		std::atomic_bool done(false);
+		std::vector<std::thread> thieves;
+		for (int i = 0; i < k_thief_count; ++i)
+		{
+			thieves.emplace_back([&]()
+			{
+				void* data;
+				while (!done)
+				{
+					if (deque.steal(&data))
+					{
+						taken[static_cast<int*>(data) - items.data()]++;
+					}
+				}
+			});
+		}
+
+		void* data;
+		for (int i = 0; i < k_item_count; ++i)
+		{
+			while (!deque.push(&items[i]))
+			{
+				if (deque.pop(&data))
+				{
+					taken[static_cast<int*>(data) - items.data()]++;
+				}
+			}
+			if (i % 3 == 0 && deque.pop(&data))
+			{
+				taken[static_cast<int*>(data) - items.data()]++;
+			}
+		}
+		while (deque.pop(&data))
+		{
+			taken[static_cast<int*>(data) - items.data()]++;
+		}
+
+		done = true;
+		for (auto& t : thieves)
+		{
+			t.join();
+		}
+		assert(deque.get_count() == 0);
+		for (int i = 0; i < k_item_count; ++i)
+		{
+			assert(taken[i] == 1);
+		}
+	}
+
+	// Test a flat batch of jobs.
+	{
+		const int k_job_count = 100;
+		std::atomic_int run_count(0);
+		ga_job_decl_t decls[k_job_count];
+		for (int i = 0; i < k_job_count; ++i)
+		{
+			decls[i]._entry = [](void* data) { (*static_cast<std::atomic_int*>(data))++; };
+			decls[i]._data = &run_count;
+		}
+
+		ga_job_counter_t counter;
+		ga_job::run(decls, k_job_count, &counter);
+		ga_job::wait(&counter);
+		assert(counter._value == 0);
+		assert(run_count == k_job_count);
+	}
+
+	// Test jobs that wait on jobs of their own.
+	{
+		std::atomic_int leaf_count(0);
+		job_tree_t root;
+		root._leaf_count = &leaf_count;
+		root._depth = 3;
+
+		ga_job_decl_t decl;
+		decl._entry = job_tree;
+		decl._data = &root;
+
+		ga_job_counter_t counter;
+		ga_job::run(&decl, 1, &counter);
+		ga_job::wait(&counter);
+		assert(leaf_count == 4 * 4 * 4);
+	}
+
+	// Test jobs and a thread all waiting on one counter, released by its final decrement.
+	{
+		const int k_waiter_count = 8;
+		std::atomic_int resumed_count(0);
+
+		ga_job_counter_t gate;
+		gated_waiter_t waiters[k_waiter_count];
+		ga_job_decl_t waiter_decls[k_waiter_count];
+		for (int i = 0; i < k_waiter_count; ++i)
+		{
+			waiters[i]._gate = &gate;
+			waiters[i]._resumed_count = &resumed_count;
+			waiter_decls[i]._entry = gated_waiter;
+			waiter_decls[i]._data = &waiters[i];
+		}
+
+		gate_t gate_data;
+		gate_data._waiter_decls = waiter_decls;
+		gate_data._waiter_count = k_waiter_count;
+		gate_data._open = 0;
+
+		ga_job_decl_t gate_decl;
+		gate_decl._entry = gate_job;
+		gate_decl._data = &gate_data;
+		ga_job::run(&gate_decl, 1, &gate);
+
+		ga_job::wait(&gate);
+		assert(gate_data._open == 1);
+		ga_job::wait(&gate_data._waiter_counter);
+		assert(resumed_count == k_waiter_count);
+		assert(gate._waiters == 0);
+	}
+
+	// Test that a critical job overtakes queued normal jobs, and that a background
+	// job isn't starved by them.
+	{
+		std::atomic_int sequence(0);
+		priority_spawner_t spawner;
+		spawner._queued = false;
+		for (int i = 0; i < priority_spawner_t::k_normal_count; ++i)
+		{
+			spawner._normal_jobs[i]._sequence = &sequence;
+			spawner._normal_jobs[i]._queued = &spawner._queued;
+			spawner._normal_decls[i]._entry = sequenced_job;
+			spawner._normal_decls[i]._data = &spawner._normal_jobs[i];
+		}
+
+		spawner._critical_job._sequence = &sequence;
+		spawner._critical_job._queued = &spawner._queued;
+		spawner._critical_decl._entry = sequenced_job;
+		spawner._critical_decl._data = &spawner._critical_job;
+		spawner._critical_decl._priority = k_job_priority_critical;
+
+		spawner._background_job._sequence = &sequence;
+		spawner._background_job._queued = &spawner._queued;
+		spawner._background_decl._entry = sequenced_job;
+		spawner._background_decl._data = &spawner._background_job;
+		spawner._background_decl._priority = k_job_priority_background;
+
+		ga_job_decl_t spawner_decl;
+		spawner_decl._entry = priority_spawner;
+		spawner_decl._data = &spawner;
+		ga_job_counter_t spawner_counter;
+		ga_job::run(&spawner_decl, 1, &spawner_counter);
+		ga_job::wait(&spawner_counter);
+
+		ga_job::wait(&spawner._critical_counter);
+		ga_job::wait(&spawner._background_counter);
+		ga_job::wait(&spawner._normal_counter);
+
+		// In FIFO order both would run after every normal job.
+		assert(spawner._critical_job._position < priority_spawner_t::k_normal_count);
+		assert(spawner._background_job._position < priority_spawner_t::k_normal_count);
+	}
+
+	// Test parallel_for visits every index once, in pieces of at most grain, from the
+	// main thread and nested inside a job.
+	{
+		const int k_count = 10000;
+		std::vector<std::atomic_int> visits(k_count);
+		for (auto& v : visits)
+		{
+			v = 0;
+		}
+
+		range_visits_t range_visits;
+		range_visits._visits = visits.data();
+		range_visits._call_count = 0;
+		ga_job::parallel_for(0, k_count, 64, count_range_visits, &range_visits);
+		for (int i = 0; i < k_count; ++i)
+		{
+			assert(visits[i] == 1);
+		}
+		assert(range_visits._call_count >= (k_count + 63) / 64);
+
+		ga_job_decl_t nested_decl;
+		nested_decl._entry = nested_parallel_for;
+		nested_decl._data = &range_visits;
+		ga_job_counter_t nested_counter;
+		ga_job::run(&nested_decl, 1, &nested_counter);
+		ga_job::wait(&nested_counter);
+		for (int i = 0; i < k_count; ++i)
+		{
+			assert(visits[i] == (i < 1000 ? 2 : 1));
+		}
+
+		range_visits._call_count = 0;
+		ga_job::parallel_for(5, 5, 1, count_range_visits, &range_visits);
+		assert(range_visits._call_count == 0);
+	}
+
+	// Test that a main thread job queued from another job runs on the main thread,
+	// while it waits on the job that queued it.
+	{
+		main_thread_job_t job;
+		job._decl._entry = [](void* data) { static_cast<main_thread_job_t*>(data)->_ran_on = std::this_thread::get_id(); };
+		job._decl._data = &job;
+		job._decl._main_thread_only = true;
+
+		ga_job_decl_t spawner_decl;
+		spawner_decl._entry = main_thread_spawner;
+		spawner_decl._data = &job;
+		ga_job_counter_t spawner_counter;
+		ga_job::run(&spawner_decl, 1, &spawner_counter);
+		ga_job::wait(&spawner_counter);
+		assert(job._ran_on == std::this_thread::get_id());
+	}
+
+	// Test that recorded jobs show up by name in the dumped trace.
+	{
+		ga_job_profiler::set_enabled(true);
+
+		const int k_job_count = 16;
+		ga_job_decl_t decls[k_job_count];
+		for (int i = 0; i < k_job_count; ++i)
+		{
+			decls[i]._entry = [](void*) {};
+			decls[i]._name = "profiled \"job\"";
+		}
+		ga_job_counter_t counter;
+		ga_job::run(decls, k_job_count, &counter);
+		ga_job::wait(&counter);
+
+		FILE* file = tmpfile();
+		assert(file);
+		ga_job_profiler::dump(file);
+		assert(!ga_job_profiler::is_enabled());
+
+		std::string trace;
+		rewind(file);
+		char buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			trace.append(buffer, read);
+		}
+		fclose(file);
+
+		assert(trace.compare(0, 1, "{") == 0);
+		assert(trace.find("\"traceEvents\"") != std::string::npos);
+		assert(trace.find("\"args\":{\"name\":\"main\"}") != std::string::npos);
+
+		// Every job gets its own event.
+		int job_count = 0;
+		for (size_t at = trace.find("\"name\":\"profiled \\\"job\\\"\""); at != std::string::npos;
+			at = trace.find("\"name\":\"profiled \\\"job\\\"\"", at + 1))
+		{
+			++job_count;
+		}
+		assert(job_count == k_job_count);
+	}
+
+	// Test jobs on small and medium stacks, and that painting measures how much of
+	// them each used.
+	{
+		ga_job::set_stack_painting(true);
+
+		std::atomic_int run_count(0);
+		ga_job_decl_t decls[2];
+		decls[0]._entry = [](void* data) { (*static_cast<std::atomic_int*>(data))++; };
+		decls[0]._data = &run_count;
+		decls[0]._name = "shallow stack";
+		decls[0]._stack = k_job_stack_small;
+		decls[1]._entry = deep_stack_job;
+		decls[1]._data = &run_count;
+		decls[1]._name = "deep stack";
+
+		ga_job_counter_t counter;
+		ga_job::run(decls, 2, &counter);
+		ga_job::wait(&counter);
+		ga_job::set_stack_painting(false);
+		assert(run_count == 2);
+
+		std::vector<ga_job_stack_usage_t> usage;
+		ga_job::get_stack_usage(&usage);
+		assert(usage.size() == 2);
+		assert(strcmp(usage[0]._name, "deep stack") == 0);
+		assert(usage[0]._stack_bytes == ga_fiber::get_stack_size(64 * 1024));
+		assert(strcmp(usage[1]._name, "shallow stack") == 0);
+		assert(usage[1]._stack_bytes == ga_fiber::get_stack_size(16 * 1024));
+#if !defined(GA_WINDOWS)
+		assert(usage[0]._peak_bytes >= 8 * 1024 && usage[0]._peak_bytes < 64 * 1024);
+		assert(usage[1]._peak_bytes > 0 && usage[1]._peak_bytes < usage[0]._peak_bytes);
+#endif
+	}
+
+	// Test that running out of fibers of one stack class holds up only that class.
+	// Large jobs park on a closed gate until every large fiber is taken, and the
+	// rest are set aside while small and medium jobs run past them.
+	{
+		const int k_large_count = 32;
+		const int k_other_count = 64;
+
+		// Nothing counting on the gate is queued yet, so it's set without the lock.
+		ga_job_counter_t gate;
+		gate._value = 1;
+
+		std::atomic_int resumed_count(0);
+		gated_waiter_t waiter = { &gate, &resumed_count };
+
+		ga_job_decl_t large_decls[k_large_count];
+		for (int i = 0; i < k_large_count; ++i)
+		{
+			large_decls[i]._entry = gated_waiter;
+			large_decls[i]._data = &waiter;
+			large_decls[i]._name = "large waiter";
+			large_decls[i]._stack = k_job_stack_large;
+		}
+		ga_job_counter_t large_counter;
+		ga_job::run(large_decls, k_large_count, &large_counter);
+
+		std::atomic_int other_count(0);
+		ga_job_decl_t other_decls[k_other_count];
+		for (int i = 0; i < k_other_count; ++i)
+		{
+			other_decls[i]._entry = [](void* data) { (*static_cast<std::atomic_int*>(data))++; };
+			other_decls[i]._data = &other_count;
+			other_decls[i]._stack = i % 2 ? k_job_stack_small : k_job_stack_medium;
+		}
+		ga_job_counter_t other_counter;
+		ga_job::run(other_decls, k_other_count, &other_counter);
+		ga_job::wait(&other_counter);
+		assert(other_count == k_other_count);
+		assert(resumed_count == 0);
+
+		// Each large job that finishes hands its fiber to one set aside.
+		ga_job_decl_t open_decl;
+		open_decl._entry = [](void*) {};
+		open_decl._main_thread_only = true;
+		ga_job::run(&open_decl, 1, &gate);
+		ga_job::wait(&large_counter);
+		assert(resumed_count == k_large_count);
+	}
+}
@@ -0,0 +1,263 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_job_profiler.h"
+
+#include "framework/ga_compiler_defines.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#if defined(GA_X86_64) && defined(GA_MSVC)
+#include <intrin.h>
+#elif defined(GA_X86_64)
+#include <x86intrin.h>
+#endif
+
+std::atomic<ga_job_profile_thread_t* const*> ga_job_profiler::_recording(0);
+
+static std::vector<ga_job_profile_thread_t*> _profile_threads;
+
+/* Time stamps and wall clock when recording started, to convert between them. */
+static uint64_t _start_time;
+static std::chrono::steady_clock::time_point _start_clock;
+
+static uint64_t _ga_job_profile_time()
+{
+#if defined(GA_X86_64)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static void _ga_job_profile_write_stamped(ga_job_profile_thread_t* thread, uint32_t written, ga_job_event_t type, const char* name)
+{
+	/* Stored relative to the start of recording, which leaves the low byte free. */
+	uint64_t time = _ga_job_profile_time() - _start_time;
+	thread->_events[written % ga_job_profile_thread_t::k_event_count] = (time << 8) | ga_job_profile_thread_t::k_time_stamp;
+	thread->_events[(written + 1) % ga_job_profile_thread_t::k_event_count] = (uint64_t(uintptr_t(name)) << 8) | uint64_t(type);
+	thread->_written.store(written + 2, std::memory_order_release);
+}
+
+void ga_job_profiler::record_event(int thread_index, ga_job_event_t type, const char* name)
+{
+	ga_job_profile_thread_t* thread = _profile_threads[thread_index];
+	_ga_job_profile_write_stamped(thread, thread->_written.load(std::memory_order_relaxed), type, name);
+}
+
+void ga_job_profiler::startup(int thread_count)
+{
+	/* Left uninitialized, so the buffers' pages aren't touched until recording. */
+	_profile_threads.resize(thread_count + 1);
+	for (auto& t : _profile_threads)
+	{
+		t = new ga_job_profile_thread_t;
+		t->_written.store(0, std::memory_order_relaxed);
+	}
+}
+
+void ga_job_profiler::shutdown()
+{
+	_recording = 0;
+	for (auto& t : _profile_threads)
+	{
+		delete t;
+	}
+	_profile_threads.clear();
+}
+
+void ga_job_profiler::set_enabled(bool enabled)
+{
+	/* Only a new recording discards events; turning recording on twice keeps them. */
+	if (enabled && !is_enabled())
+	{
+		for (auto& t : _profile_threads)
+		{
+			t->_written.store(0, std::memory_order_relaxed);
+		}
+		_start_time = _ga_job_profile_time();
+		_start_clock = std::chrono::steady_clock::now();
+	}
+	_recording.store(enabled ? _profile_threads.data() : 0, std::memory_order_release);
+}
+
+bool ga_job_profiler::dump(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+	{
+		return false;
+	}
+	dump(file);
+	return fclose(file) == 0;
+}
+
+static void _ga_job_profile_write_name(FILE* file, const char* name)
+{
+	fputc('"', file);
+	for (const char* c = name; *c; ++c)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			fputc('\\', file);
+		}
+		fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+void ga_job_profiler::dump(FILE* file)
+{
+	set_enabled(false);
+
+	/* Time stamp ticks per microsecond, measured over the recording. */
+	uint64_t end_time = _ga_job_profile_time() - _start_time;
+	double elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _start_clock).count();
+	double ticks_per_us = elapsed_us > 0.0 ? double(end_time) / elapsed_us : 1.0;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	struct dump_event_t
+	{
+		uint64_t _word;
+		uint64_t _time;
+		bool _stamped;
+	};
+	std::vector<dump_event_t> events;
+
+	int thread_count = int(_profile_threads.size());
+	for (int t = 0; t < thread_count; ++t)
+	{
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":", t == 0 ? "" : ",\n", t);
+		if (t == thread_count - 1)
+		{
+			fprintf(file, "\"main\"}}");
+		}
+		else
+		{
+			fprintf(file, "\"worker %d\"}}", t);
+		}
+
+		/*
+		** A thread that saw recording on just before it stopped may still be writing
+		** an event, over the oldest slots. Leave those out.
+		*/
+		const ga_job_profile_thread_t* thread = _profile_threads[t];
+		uint32_t written = thread->_written.load(std::memory_order_acquire);
+		uint32_t begin = written > ga_job_profile_thread_t::k_event_count - 2 ? written - (ga_job_profile_thread_t::k_event_count - 2) : 0;
+
+		/* Attach time stamps to their events. Events before the first have nothing to be placed after. */
+		events.clear();
+		bool stamp_pending = false;
+		uint64_t stamp = 0;
+		for (uint32_t i = begin; i != written; ++i)
+		{
+			uint64_t word = thread->_events[i % ga_job_profile_thread_t::k_event_count];
+			if ((word & 0xff) == ga_job_profile_thread_t::k_time_stamp)
+			{
+				stamp = word >> 8;
+				stamp_pending = true;
+			}
+			else if (stamp_pending || !events.empty())
+			{
+				events.push_back({ word, stamp, stamp_pending });
+				stamp_pending = false;
+			}
+		}
+
+		/*
+		** Spread unstamped events evenly between the stamped events either side, or
+		** the end of recording after the last.
+		*/
+		size_t stamped = 0;
+		for (size_t i = 1; i <= events.size(); ++i)
+		{
+			if (i < events.size() && !events[i]._stamped)
+			{
+				continue;
+			}
+
+			uint64_t next_time = i < events.size() ? events[i]._time : end_time;
+			for (size_t j = stamped + 1; j < i; ++j)
+			{
+				events[j]._time = events[stamped]._time + uint64_t(double(next_time - events[stamped]._time) * double(j - stamped) / double(i - stamped));
+			}
+			stamped = i;
+		}
+
+		/*
+		** A job or sleep lasts until the thread's next event. Jobs still running when
+		** recording stopped end there.
+		*/
+		int open = -1;
+		bool open_stolen = false;
+		for (size_t i = 0; i <= events.size(); ++i)
+		{
+			uint64_t time = i < events.size() ? events[i]._time : end_time;
+			double ts = double(time) / ticks_per_us;
+
+			if (open >= 0)
+			{
+				const dump_event_t& begin_event = events[open];
+				bool idle = ga_job_event_t(begin_event._word & 0xff) == k_job_event_idle_begin;
+				const char* begin_name = reinterpret_cast<const char*>(uintptr_t(begin_event._word >> 8));
+				double begin_ts = double(begin_event._time) / ticks_per_us;
+
+				fprintf(file, ",\n{\"name\":");
+				_ga_job_profile_write_name(file, idle ? "idle" : (begin_name ? begin_name : "job"));
+				fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+					idle ? "idle" : "job", t, begin_ts, ts - begin_ts);
+				if (open_stolen)
+				{
+					fprintf(file, ",\"args\":{\"stolen\":true}");
+				}
+				fprintf(file, "}");
+				open = -1;
+			}
+
+			if (i == events.size())
+			{
+				break;
+			}
+
+			const char* name = reinterpret_cast<const char*>(uintptr_t(events[i]._word >> 8));
+			switch (ga_job_event_t(events[i]._word & 0xff))
+			{
+			case k_job_event_run_begin:
+			case k_job_event_steal:
+				open = int(i);
+				open_stolen = ga_job_event_t(events[i]._word & 0xff) == k_job_event_steal;
+				break;
+
+			case k_job_event_idle_begin:
+				open = int(i);
+				open_stolen = false;
+				break;
+
+			case k_job_event_wait:
+				fprintf(file, ",\n{\"name\":\"wait\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%d,\"ts\":%.3f", t, ts);
+				if (name)
+				{
+					fprintf(file, ",\"args\":{\"job\":");
+					_ga_job_profile_write_name(file, name);
+					fprintf(file, "}");
+				}
+				fprintf(file, "}");
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+/*
+** Things the job system records about its threads.
+*/
+enum ga_job_event_t
+{
+	/* A job's fiber switched in, to start or to resume after a wait. */
+	k_job_event_run_begin,
+	/* The job's fiber switched back out, because it finished or is waiting. */
+	k_job_event_run_end,
+	/* The running job, or the main thread, started waiting on a counter. */
+	k_job_event_wait,
+	/* The main thread stopped waiting. */
+	k_job_event_wait_end,
+	/* A job taken from another thread's deque started. Stands in for its run_begin. */
+	k_job_event_steal,
+	/* The thread found no work and went to sleep, and later woke. */
+	k_job_event_idle_begin,
+	k_job_event_idle_end,
+};
+
+/*
+** One thread's ring buffer of events. Only its thread writes events, publishing
+** each by bumping the count.
+**
+** Each event is one word: the name pointer shifted up, with the event type in the
+** low byte. Names are only read when the trace is dumped. A time stamp is a word
+** of its own, with k_time_stamp in the low byte, and times the event after it.
+*/
+struct ga_job_profile_thread_t
+{
+	static const uint32_t k_event_count = 65536;
+	static const uint64_t k_time_stamp = 0xff;
+
+	std::atomic<uint32_t> _written;
+
+	uint64_t _events[k_event_count];
+};
+
+/*
+** Records what each job system thread is doing, for viewing in chrome://tracing
+** or Perfetto.
+**
+** Each thread writes to its own ring buffer, keeping the most recent events, with
+** the time stamp counter where there is one. Threads name their buffer by their
+** job system index, which they already have to hand, rather than through thread
+** local storage. While recording is off, each event costs a load and a branch.
+**
+** Every job gets its own begin event, and ends at its thread's next event, so
+** waits, sleeps and steals split up jobs as they happen. Reading the time costs
+** as much as a short job though, so only waits, sleeps and about every
+** k_stamp_interval-th job event read the clock. The dump spreads the events in
+** between evenly over the time between their stamped neighbours, so a lone long
+** job among short ones is shown stretched over its neighbours.
+*/
+class ga_job_profiler
+{
+public:
+	static const uint32_t k_stamp_interval = 1024;
+
+	/*
+	** Make room for one worker per index below thread_count, plus the main thread
+	** at thread_count. Buffers are allocated here, but their pages aren't touched
+	** until recording.
+	*/
+	static void startup(int thread_count);
+	static void shutdown();
+
+	/*
+	** Start recording, discarding earlier events, or stop.
+	*/
+	static void set_enabled(bool enabled);
+	static bool is_enabled() { return _recording.load(std::memory_order_relaxed) != 0; }
+
+	/*
+	** Stop recording and write what's been recorded as Chrome trace event JSON.
+	** Name pointers are kept rather than copied, so names must outlive the dump.
+	*/
+	static bool dump(const char* path);
+	static void dump(FILE* file);
+
+	/*
+	** Record a wait or sleep on the given thread, or nothing if the index is
+	** negative. These always read the clock.
+	*/
+	static void record(int thread_index, ga_job_event_t type, const char* name = 0)
+	{
+		if (thread_index >= 0 && _recording.load(std::memory_order_relaxed))
+		{
+			record_event(thread_index, type, name);
+		}
+	}
+
+	/*
+	** A job's fiber switched in, having just been stolen or not. Most cost a compare
+	** and two stores; see k_stamp_interval.
+	*/
+	static void record_run_begin(int thread_index, const char* name, bool stolen)
+	{
+		ga_job_profile_thread_t* const* threads = _recording.load(std::memory_order_relaxed);
+		if (threads)
+		{
+			ga_job_profile_thread_t* thread = threads[thread_index];
+			uint64_t type = stolen ? k_job_event_steal : k_job_event_run_begin;
+			uint32_t written = thread->_written.load(std::memory_order_relaxed);
+			if (written % k_stamp_interval != 0)
+			{
+				thread->_events[written % ga_job_profile_thread_t::k_event_count] = (uint64_t(uintptr_t(name)) << 8) | type;
+				thread->_written.store(written + 1, std::memory_order_release);
+			}
+			else
+			{
+				record_event(thread_index, ga_job_event_t(type), name);
+			}
+		}
+	}
+
+private:
+	/* Each thread's buffer by index while recording, otherwise null. */
+	static std::atomic<ga_job_profile_thread_t* const*> _recording;
+
+	static void record_event(int thread_index, ga_job_event_t type, const char* name);
+};
@@ -0,0 +1,258 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_task_graph.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+
+struct ga_task_t
+{
+	int _index;
+
+	/* What the user asked to run, and the decl queued to run it. */
+	ga_job_decl_t _user_decl;
+	ga_job_decl_t _decl;
+	ga_job_counter_t _counter;
+
+	std::vector<ga_task_t*> _successors;
+	int _predecessor_count;
+
+	/* Tasks it depends on that haven't finished in the current run. */
+	std::atomic_int _pending;
+
+	std::chrono::high_resolution_clock::duration _duration;
+};
+
+static void _ga_task_graph_run_task(void* data);
+
+ga_task_graph::ga_task_graph() : _built(false), _running(false)
+{
+}
+
+ga_task_graph::~ga_task_graph()
+{
+	assert(!_running);
+	for (auto& t : _tasks)
+	{
+		delete t;
+	}
+}
+
+int ga_task_graph::add_task(const ga_job_decl_t& decl)
+{
+	ga_task_t* task = new ga_task_t();
+	task->_index = int(_tasks.size());
+	task->_user_decl = decl;
+	task->_decl = decl;
+	task->_decl._entry = _ga_task_graph_run_task;
+	task->_decl._data = task;
+	task->_predecessor_count = 0;
+	task->_duration = std::chrono::high_resolution_clock::duration::zero();
+
+	_tasks.push_back(task);
+	_built = false;
+	return task->_index;
+}
+
+void ga_task_graph::add_dependency(int before, int after)
+{
+	assert(before != after);
+	_tasks[before]->_successors.push_back(_tasks[after]);
+	_tasks[after]->_predecessor_count++;
+	_built = false;
+}
+
+bool ga_task_graph::build()
+{
+	_order.clear();
+	_roots.clear();
+
+	std::vector<int> remaining(_tasks.size());
+	for (auto& t : _tasks)
+	{
+		remaining[t->_index] = t->_predecessor_count;
+		if (t->_predecessor_count == 0)
+		{
+			_roots.push_back(t);
+			_order.push_back(t);
+		}
+	}
+
+	/* Tasks join the order once everything they depend on has. */
+	for (int i = 0; i < int(_order.size()); ++i)
+	{
+		for (auto& s : _order[i]->_successors)
+		{
+			if (--remaining[s->_index] == 0)
+			{
+				_order.push_back(s);
+			}
+		}
+	}
+
+	_built = _order.size() == _tasks.size();
+	return _built;
+}
+
+void ga_task_graph::run()
+{
+	start();
+	wait();
+}
+
+void ga_task_graph::start()
+{
+	assert(_built && !_running);
+	_running = true;
+
+	/*
+	** Every counter is set before anything is queued, so wait can't finish early on
+	** a task that hasn't been queued yet. Nothing is queued on them yet, so the
+	** store needs no lock. Queueing sets it again.
+	*/
+	for (auto& t : _tasks)
+	{
+		t->_pending = t->_predecessor_count;
+		t->_counter._value = 1;
+	}
+	for (auto& t : _roots)
+	{
+		ga_job::run(&t->_decl, 1, &t->_counter);
+	}
+}
+
+void ga_task_graph::wait()
+{
+	assert(_running);
+	for (auto& t : _order)
+	{
+		ga_job::wait(&t->_counter);
+	}
+	_running = false;
+}
+
+static void _ga_task_graph_run_task(void* data)
+{
+	ga_task_t* task = static_cast<ga_task_t*>(data);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	task->_user_decl._entry(task->_user_decl._data);
+	task->_duration = std::chrono::high_resolution_clock::now() - start;
+
+	for (auto& s : task->_successors)
+	{
+		if (--s->_pending == 0)
+		{
+			ga_job::run(&s->_decl, 1, &s->_counter);
+		}
+	}
+}
+
+double ga_task_graph::get_critical_path(std::vector<int>* tasks) const
+{
+	assert(_built && !_running);
+
+	/* Longest time through the graph up to and including each task, and the task before it. */
+	std::vector<double> path_ms(_tasks.size(), 0.0);
+	std::vector<int> previous(_tasks.size(), -1);
+
+	int last = -1;
+	for (auto& t : _order)
+	{
+		path_ms[t->_index] += std::chrono::duration<double, std::milli>(t->_duration).count();
+		if (last < 0 || path_ms[t->_index] > path_ms[last])
+		{
+			last = t->_index;
+		}
+
+		for (auto& s : t->_successors)
+		{
+			if (previous[s->_index] < 0 || path_ms[t->_index] > path_ms[s->_index])
+			{
+				path_ms[s->_index] = path_ms[t->_index];
+				previous[s->_index] = t->_index;
+			}
+		}
+	}
+
+	tasks->clear();
+	for (int t = last; t >= 0; t = previous[t])
+	{
+		tasks->insert(tasks->begin(), t);
+	}
+	return last >= 0 ? path_ms[last] : 0.0;
+}
+
+bool ga_task_graph::dump_dot(const char* path) const
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+	{
+		return false;
+	}
+	dump_dot(file);
+	return fclose(file) == 0;
+}
+
+/*
+** Write a name inside a quoted DOT string, escaping what would end it.
+*/
+static void _ga_task_graph_write_name(FILE* file, const char* name)
+{
+	for (const char* c = name; *c; ++c)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			fputc('\\', file);
+		}
+		fputc(*c, file);
+	}
+}
+
+void ga_task_graph::dump_dot(FILE* file) const
+{
+	std::vector<int> critical_path;
+	double critical_ms = get_critical_path(&critical_path);
+
+	/* The task after each one on the critical path. */
+	std::vector<int> critical_next(_tasks.size(), -1);
+	std::vector<bool> critical(_tasks.size(), false);
+	for (int i = 0; i < int(critical_path.size()); ++i)
+	{
+		critical[critical_path[i]] = true;
+		if (i + 1 < int(critical_path.size()))
+		{
+			critical_next[critical_path[i]] = critical_path[i + 1];
+		}
+	}
+
+	fprintf(file, "digraph ga_task_graph {\n");
+	fprintf(file, "\tlabel=\"critical path %.3f ms\";\n", critical_ms);
+	fprintf(file, "\tnode [shape=box];\n");
+	for (auto& t : _tasks)
+	{
+		fprintf(file, "\tt%d [label=\"", t->_index);
+		_ga_task_graph_write_name(file, t->_user_decl._name ? t->_user_decl._name : "unnamed");
+		fprintf(file, "\\n%.3f ms%s\"%s];\n",
+			std::chrono::duration<double, std::milli>(t->_duration).count(),
+			t->_user_decl._main_thread_only ? "\\nmain thread" : "",
+			critical[t->_index] ? ", color=red, penwidth=2" : "");
+	}
+	for (auto& t : _tasks)
+	{
+		for (auto& s : t->_successors)
+		{
+			bool on_path = critical_next[t->_index] == s->_index;
+			fprintf(file, "\tt%d -> t%d%s;\n", t->_index, s->_index, on_path ? " [color=red, penwidth=2]" : "");
+		}
+	}
+	fprintf(file, "}\n");
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_job.h"
+
+#include <cstdio>
+#include <vector>
+
+struct ga_task_t;
+
+/*
+** Jobs and the order they must run in, built once and run as many times as needed,
+** such as once per frame.
+**
+** Each task is queued as soon as the last task it depends on finishes, so tasks
+** that don't depend on each other overlap. Running allocates nothing.
+*/
+class ga_task_graph
+{
+public:
+	ga_task_graph();
+	~ga_task_graph();
+
+	ga_task_graph(const ga_task_graph&) = delete;
+	ga_task_graph& operator=(const ga_task_graph&) = delete;
+
+	/*
+	** Add a task that runs the decl's entry with its data, name, priority, stack and
+	** thread. Returns the index used to refer to the task.
+	*/
+	int add_task(const ga_job_decl_t& decl);
+
+	/*
+	** Make after wait for before to finish.
+	*/
+	void add_dependency(int before, int after);
+
+	/*
+	** Work out the order to run tasks in. Returns false if dependencies form a cycle.
+	** Must be called after the last task or dependency is added, and before run.
+	*/
+	bool build();
+
+	/*
+	** Run every task and wait for them all.
+	*/
+	void run();
+
+	/*
+	** Queue the tasks that depend on nothing, and return. Wait must be called before
+	** the graph is started again.
+	*/
+	void start();
+	void wait();
+	bool is_running() const { return _running; }
+
+	/*
+	** The chain of dependent tasks that took longest in the last run, and its total
+	** time in milliseconds.
+	*/
+	double get_critical_path(std::vector<int>* tasks) const;
+
+	/*
+	** Write the graph in Graphviz DOT format, with each task's time in the last run
+	** and the critical path in red.
+	*/
+	bool dump_dot(const char* path) const;
+	void dump_dot(FILE* file) const;
+
+private:
+	std::vector<ga_task_t*> _tasks;
+
+	/* Tasks in an order where each comes after those it depends on. */
+	std::vector<ga_task_t*> _order;
+	std::vector<ga_task_t*> _roots;
+	bool _built;
+	bool _running;
+};
@@ -0,0 +1,120 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_task_graph.tests.h"
+#include "ga_task_graph.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct diamond_task_t
+{
+	std::atomic_int* _sequence;
+	int _position;
+	int _sleep_ms;
+};
+
+static void diamond_task(void* data)
+{
+	diamond_task_t* task = static_cast<diamond_task_t*>(data);
+	if (task->_sleep_ms > 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(task->_sleep_ms));
+	}
+	task->_position = (*task->_sequence)++;
+}
+
+void ga_task_graph_unit_tests()
+{
+	// Test a diamond: top runs before both sides, and bottom after both, every time
+	// the graph runs. The slow side is the critical path, and quotes in names are
+	// escaped in the DOT output.
+	{
+		const char* k_names[] = { "top", "fast \"side\"", "slow side", "bottom" };
+		std::atomic_int sequence(0);
+		diamond_task_t tasks[4];
+
+		ga_task_graph graph;
+		for (int i = 0; i < 4; ++i)
+		{
+			tasks[i]._sequence = &sequence;
+			tasks[i]._sleep_ms = i == 2 ? 5 : 0;
+
+			ga_job_decl_t decl;
+			decl._entry = diamond_task;
+			decl._data = &tasks[i];
+			decl._name = k_names[i];
+			graph.add_task(decl);
+		}
+		graph.add_dependency(0, 1);
+		graph.add_dependency(0, 2);
+		graph.add_dependency(1, 3);
+		graph.add_dependency(2, 3);
+		bool built = graph.build();
+		assert(built);
+		(void)built;
+
+		for (int run = 0; run < 3; ++run)
+		{
+			sequence = 0;
+			graph.run();
+			assert(sequence == 4);
+			assert(tasks[0]._position == 0);
+			assert(tasks[3]._position == 3);
+		}
+
+		std::vector<int> path;
+		double path_ms = graph.get_critical_path(&path);
+		assert(path.size() == 3);
+		assert(path[0] == 0 && path[1] == 2 && path[2] == 3);
+		assert(path_ms >= 5.0);
+		(void)path_ms;
+
+		FILE* file = tmpfile();
+		assert(file);
+		graph.dump_dot(file);
+
+		std::string dot;
+		rewind(file);
+		char buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			dot.append(buffer, read);
+		}
+		fclose(file);
+
+		assert(dot.find("digraph") == 0);
+		assert(dot.find("\"slow side\\n") != std::string::npos);
+		assert(dot.find("\"fast \\\"side\\\"\\n") != std::string::npos);
+		assert(dot.find("t0 -> t2 [color=red") != std::string::npos);
+		assert(dot.find("t2 -> t3 [color=red") != std::string::npos);
+		assert(dot.find("t0 -> t1;") != std::string::npos);
+	}
+
+	// Test that a cycle fails to build.
+	{
+		ga_task_graph graph;
+		ga_job_decl_t decl;
+		decl._entry = [](void*) {};
+		int a = graph.add_task(decl);
+		int b = graph.add_task(decl);
+		int c = graph.add_task(decl);
+		graph.add_dependency(a, b);
+		graph.add_dependency(b, c);
+		graph.add_dependency(c, b);
+		bool built = graph.build();
+		assert(!built);
+		(void)built;
+	}
+}
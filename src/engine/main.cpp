@@ -9,10 +9,15 @@
 
 #include "framework/ga_camera.h"
 #include "framework/ga_compiler_defines.h"
+#include "framework/ga_frame_pipeline.h"
 #include "framework/ga_input.h"
 #include "framework/ga_sim.h"
 #include "framework/ga_output.h"
 #include "jobs/ga_job.h"
+#include "jobs/ga_job_profiler.h"
+#include "jobs/ga_job.tests.h"
+#include "jobs/ga_task_graph.h"
+#include "jobs/ga_task_graph.tests.h"
 
 #include "entity/ga_entity.h"
 
@@ -24,9 +29,12 @@
 
 #include "physics/ga_intersection.tests.h"
 #include "physics/ga_physics_component.h"
+#include "physics/ga_physics_recording.h"
 #include "physics/ga_physics_world.h"
+#include "physics/ga_physics_world.tests.h"
 #include "physics/ga_rigid_body.h"
 #include "physics/ga_shape.h"
+#include "physics/ga_static_geometry_optimizer.h"
 
 #include "soloud.h"
 
@@ -36,6 +44,8 @@
 #define STB_TRUETYPE_IMPLEMENTATION
 #include <stb_truetype.h>
 
+#include <cassert>
+#include <iostream>
 #include <strstream>
 #include <string>
 #include <sstream>
@@ -77,58 +87,57 @@ static void set_root_path(const char* exepath)
 }
 
 // Scene Creation
-ga_entity* create_cube(ga_mat4f* transform, ga_sim* sim, ga_physics_world* world)
+ga_entity* create_cube(ga_mat4f* transform, ga_sim* sim, ga_static_geometry_optimizer* static_geometry)
 {
 	ga_entity* cube = new ga_entity();
 	ga_cube_component* model = new ga_cube_component(cube, "data/textures/wall3.jpg");
 
 	cube->set_transform(*transform);
 
-	ga_oobb* cube_oobb = new ga_oobb();
-	cube_oobb->_half_vectors[0] = ga_vec3f::x_vector();
-	cube_oobb->_half_vectors[1] = ga_vec3f::y_vector();
-	cube_oobb->_half_vectors[2] = ga_vec3f::z_vector();
-	ga_physics_component* collider = new ga_physics_component(cube, cube_oobb, 1.0f);
-	collider->get_rigid_body()->make_static();
-	world->add_rigid_body(collider->get_rigid_body());
+	// The collider is merged with its neighbors before it's added to the world.
+	ga_oobb cube_oobb;
+	cube_oobb._half_vectors[0] = ga_vec3f::x_vector();
+	cube_oobb._half_vectors[1] = ga_vec3f::y_vector();
+	cube_oobb._half_vectors[2] = ga_vec3f::z_vector();
+	static_geometry->add_box(cube_oobb, *transform);
 
 	sim->add_entity(cube);
 	return cube;
 }
-void create_scene_wall(ga_sim* sim, ga_physics_world* world)
+void create_scene_wall(ga_sim* sim, ga_static_geometry_optimizer* static_geometry)
 {
 	ga_mat4f tran;
 	for (int i = 0; i < 3; ++i) {
 		tran.make_scaling(1);
 		tran.translate({ 0, i * 2.0f, 0 });
-		create_cube(&tran, sim, world);
+		create_cube(&tran, sim, static_geometry);
 
 		tran.make_scaling(1);
 		tran.translate({ 0, i * 2.0f, -2 });
-		create_cube(&tran, sim, world);
+		create_cube(&tran, sim, static_geometry);
 
 		tran.make_scaling(1);
 		tran.translate({ 0, i * 2.0f, -4 });
-		create_cube(&tran, sim, world);
+		create_cube(&tran, sim, static_geometry);
 
 		tran.make_scaling(1);
 		tran.translate({ 0, i * 2.0f, -6 });
-		create_cube(&tran, sim, world);
+		create_cube(&tran, sim, static_geometry);
 
 		tran.make_scaling(1);
 		tran.translate({ 0, i * 2.0f, -8 });
-		create_cube(&tran, sim, world);
+		create_cube(&tran, sim, static_geometry);
 
 		tran.make_scaling(1);
 		tran.translate({ 0, i * 2.0f, -10 });
-		create_cube(&tran, sim, world);
+		create_cube(&tran, sim, static_geometry);
 
 		tran.make_scaling(1);
 		tran.translate({ -2, i * 2.0f, -8 });
-		create_cube(&tran, sim, world);
+		create_cube(&tran, sim, static_geometry);
 	}
 }
-void create_scene_wall2(ga_sim* sim, ga_physics_world* world)
+void create_scene_wall2(ga_sim* sim, ga_static_geometry_optimizer* static_geometry)
 {
 	ga_mat4f tran;
 	for (int i = 0; i < 5; ++i)
@@ -137,43 +146,43 @@ void create_scene_wall2(ga_sim* sim, ga_physics_world* world)
 		{
 			tran.make_scaling(1);
 			tran.translate({ 0, i * 2.0f, 4 - 2.0f * j });
-			create_cube(&tran, sim, world);
+			create_cube(&tran, sim, static_geometry);
 		}
 	}
 }
-void create_scene_window(ga_sim* sim, ga_physics_world* world)
+void create_scene_window(ga_sim* sim, ga_static_geometry_optimizer* static_geometry)
 {
 	ga_mat4f tran;
 	tran.make_scaling(1);
 	tran.translate({ -4, 0, -8 });
-	create_cube(&tran, sim, world);
+	create_cube(&tran, sim, static_geometry);
 
 	tran.make_scaling(1);
 	tran.translate({ -6, 0, -8 });
-	create_cube(&tran, sim, world);
+	create_cube(&tran, sim, static_geometry);
 
 	tran.make_scaling(1);
 	tran.translate({ -6, 2, -8 });
-	create_cube(&tran, sim, world);
+	create_cube(&tran, sim, static_geometry);
 
 	tran.make_scaling(1);
 	tran.translate({ -6, 4, -8 });
-	create_cube(&tran, sim, world);
+	create_cube(&tran, sim, static_geometry);
 
 	tran.make_scaling(1);
 	tran.translate({ -4, 4, -8 });
-	create_cube(&tran, sim, world);
+	create_cube(&tran, sim, static_geometry);
 }
-void create_scene_pillar(ga_sim* sim, ga_physics_world* world)
+void create_scene_pillar(ga_sim* sim, ga_static_geometry_optimizer* static_geometry)
 {
 	ga_mat4f tran;
 	tran.make_scaling(1);
 	tran.translate({ 3, 0, 0 });
-	create_cube(&tran, sim, world);
+	create_cube(&tran, sim, static_geometry);
 
 	tran.make_scaling(1);
 	tran.translate({ 3, 2, 0 });
-	create_cube(&tran, sim, world);
+	create_cube(&tran, sim, static_geometry);
 }
 void setup_scene_audio(ga_sim* sim, ga_physics_world* world, SoLoud::Soloud* audio_engine)
 {
@@ -203,6 +212,47 @@ void setup_scene_audio(ga_sim* sim, ga_physics_world* world, SoLoud::Soloud* aud
 }
 
 
+/*
+** What the frame graph's tasks work on. Params are swapped in each frame.
+*/
+struct frame_phases_t
+{
+	ga_camera* _camera;
+	ga_sim* _sim;
+	ga_physics_world* _world;
+	ga_frame_params* _params;
+};
+
+static void build_frame_graph(ga_task_graph* graph, frame_phases_t* phases)
+{
+	ga_job_decl_t decl;
+	decl._data = phases;
+
+	// The camera only reads input, so it overlaps the sim and physics.
+	decl._name = "camera";
+	decl._entry = [](void* data) { auto p = static_cast<frame_phases_t*>(data); p->_camera->update(p->_params); };
+	graph->add_task(decl);
+
+	decl._name = "sim update";
+	decl._entry = [](void* data) { auto p = static_cast<frame_phases_t*>(data); p->_sim->update(p->_params); };
+	int sim_update = graph->add_task(decl);
+
+	decl._name = "physics step";
+	decl._entry = [](void* data) { auto p = static_cast<frame_phases_t*>(data); p->_world->step(p->_params); };
+	int physics_step = graph->add_task(decl);
+
+	decl._name = "late update";
+	decl._entry = [](void* data) { auto p = static_cast<frame_phases_t*>(data); p->_sim->late_update(p->_params); };
+	int late_update = graph->add_task(decl);
+
+	graph->add_dependency(sim_update, physics_step);
+	graph->add_dependency(physics_step, late_update);
+
+	bool built = graph->build();
+	assert(built);
+	(void)built;
+}
+
 int main(int argc, const char** argv)
 {
 	set_root_path(argv[0]);
@@ -214,6 +264,7 @@ int main(int argc, const char** argv)
 	ga_input* input = new ga_input();
 	ga_sim* sim = new ga_sim();
 	ga_physics_world* world = new ga_physics_world();
+	world->set_fixed_timestep(60.0f, 4);
 	ga_output* output = new ga_output(input->get_window());
 
 	// Create camera.
@@ -229,37 +280,87 @@ int main(int argc, const char** argv)
 	audio_engine.init();
 
 	// Scene
-	create_scene_wall(sim, world);
-	create_scene_window(sim, world);
-	setup_scene_audio(sim, world, &audio_engine);
+	ga_static_geometry_optimizer static_geometry;
+	create_scene_wall(sim, &static_geometry);
+	create_scene_window(sim, &static_geometry);
+	static_geometry.build(world);
+	world->publish_snapshot();
+	std::cout << "Static colliders: " << static_geometry.get_input_count() << " merged into " <<
+		static_geometry.get_output_count() << std::endl;
 
+	setup_scene_audio(sim, world, &audio_engine);
 
-	// Main loop:
-	while (true)
+	// Capture the physics workload for tools/ga_physics_replay, what the job system
+	// is doing as a Chrome trace, and the frame graph's timings, if asked to. Frames
+	// are pipelined unless --serial-frames is given.
+	const char* physics_recording_path = nullptr;
+	const char* job_trace_path = nullptr;
+	const char* frame_graph_path = nullptr;
+	bool pipelined = true;
+	for (int i = 1; i < argc; ++i)
 	{
-		// We pass frame state through the 3 phases using a params object.
-		ga_frame_params params;
-
-		// Gather user input and current time.
-		if (!input->update(&params))
+		if (strcmp(argv[i], "--serial-frames") == 0)
 		{
-			break;
+			pipelined = false;
 		}
+	}
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (strcmp(argv[i], "--record-physics") == 0)
+		{
+			physics_recording_path = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--job-trace") == 0)
+		{
+			job_trace_path = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--frame-graph") == 0)
+		{
+			frame_graph_path = argv[i + 1];
+		}
+	}
+	ga_physics_recording* physics_recording = nullptr;
+	if (physics_recording_path)
+	{
+		physics_recording = new ga_physics_recording();
+		world->start_recording(physics_recording);
+	}
+	if (job_trace_path)
+	{
+		ga_job_profiler::set_enabled(true);
+	}
 
-		// Update the camera.
-		camera->update(&params);
-
-		// Run gameplay.
-		sim->update(&params);
+	// The sim phase runs as a graph of jobs: the camera, gameplay, the physics step
+	// and the late update. The pipeline gathers input before it and draws after it,
+	// passing frame state through the 3 phases using params objects.
+	frame_phases_t phases = { camera, sim, world, nullptr };
+	ga_task_graph frame_graph;
+	build_frame_graph(&frame_graph, &phases);
+	ga_frame_pipeline* pipeline = new ga_frame_pipeline(input, output, &frame_graph, &phases._params, pipelined);
 
-		// Step the physics world.
-		world->step(&params);
+	// Main loop:
+	while (pipeline->update())
+	{
+	}
+	delete pipeline;
 
-		// Perform the late update.
-		sim->late_update(&params);
+	if (frame_graph_path && !frame_graph.dump_dot(frame_graph_path))
+	{
+		std::cerr << "Failed to save frame graph to " << frame_graph_path << std::endl;
+	}
 
-		// Draw to screen.
-		output->update(&params);
+	if (physics_recording)
+	{
+		world->stop_recording();
+		if (!physics_recording->save(physics_recording_path))
+		{
+			std::cerr << "Failed to save physics recording to " << physics_recording_path << std::endl;
+		}
+		delete physics_recording;
+	}
+	if (job_trace_path && !ga_job_profiler::dump(job_trace_path))
+	{
+		std::cerr << "Failed to save job trace to " << job_trace_path << std::endl;
 	}
 
 	world->remove_all_rigid_bodies();
@@ -280,4 +381,7 @@ void run_unit_tests()
 {
 	ga_intersection_utility_unit_tests();
 	ga_intersection_unit_tests();
+	ga_physics_world_unit_tests();
+	ga_job_unit_tests();
+	ga_task_graph_unit_tests();
 }
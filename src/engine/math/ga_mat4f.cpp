@@ -340,3 +340,8 @@ ga_vec3f ga_mat4f::get_right() const
 {
 	return{ data[0][0], data[0][1], data[0][2] };
 }
+
+ga_vec3f ga_mat4f::get_scale() const
+{
+	return{ get_right().mag(), get_up().mag(), get_forward().mag() };
+}
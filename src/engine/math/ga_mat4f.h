@@ -152,4 +152,11 @@ struct ga_mat4f
 	** The third column of the matrix.
 	*/
 	ga_vec3f get_right() const;
+
+	/*
+	** Get the scale along each axis of the matrix.
+	**
+	** The lengths of the first three columns.
+	*/
+	ga_vec3f get_scale() const;
 };
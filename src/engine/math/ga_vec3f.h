@@ -11,6 +11,8 @@
 
 #include "math/ga_vecnf.h"
 
+#include <functional>
+
 /*
 ** Three component floating point vector.
 */
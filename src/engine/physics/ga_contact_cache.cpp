@@ -0,0 +1,133 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_contact_cache.h"
+#include "ga_rigid_body.h"
+
+// New points closer than this to a cached point inherit its impulse.
+static const float k_contact_match_distance = 0.05f;
+
+ga_contact_cache::ga_contact_cache()
+{
+}
+
+ga_contact_cache::~ga_contact_cache()
+{
+}
+
+ga_contact_manifold* ga_contact_cache::update(ga_rigid_body* body_a, ga_rigid_body* body_b,
+	const ga_collision_info* info, uint32_t step)
+{
+	key_t key(body_a, body_b);
+
+	ga_contact_manifold* manifold;
+	auto itr = _lookup.find(key);
+	if (itr == _lookup.end())
+	{
+		_lookup[key] = int(_manifolds.size());
+		_manifolds.push_back(ga_contact_manifold());
+		manifold = &_manifolds.back();
+		manifold->_body_a = body_a;
+		manifold->_body_b = body_b;
+		manifold->_point_count = 0;
+	}
+	else
+	{
+		manifold = &_manifolds[itr->second];
+	}
+
+	ga_contact_point new_points[ga_collision_info::k_max_points];
+	for (int i = 0; i < info->_manifold_point_count; ++i)
+	{
+		ga_contact_point& point = new_points[i];
+		point._position = info->_manifold_points[i];
+		point._penetration = info->_manifold_penetrations[i];
+		point._normal_impulse = 0.0f;
+
+		// Carry over the impulse from the closest matching cached point.
+		float best_dist2 = k_contact_match_distance * k_contact_match_distance;
+		for (int j = 0; j < manifold->_point_count; ++j)
+		{
+			float dist2 = (manifold->_points[j]._position - point._position).mag2();
+			if (dist2 < best_dist2)
+			{
+				best_dist2 = dist2;
+				point._normal_impulse = manifold->_points[j]._normal_impulse;
+			}
+		}
+	}
+
+	// An impulse along a different normal is meaningless.
+	if (manifold->_point_count > 0 && manifold->_normal.dot(info->_normal) < 0.95f)
+	{
+		for (int i = 0; i < info->_manifold_point_count; ++i)
+		{
+			new_points[i]._normal_impulse = 0.0f;
+		}
+	}
+
+	manifold->_normal = info->_normal;
+	manifold->_point_count = info->_manifold_point_count;
+	for (int i = 0; i < info->_manifold_point_count; ++i)
+	{
+		manifold->_points[i] = new_points[i];
+	}
+	manifold->_last_touched_step = step;
+
+	return manifold;
+}
+
+void ga_contact_cache::remove_stale(uint32_t step)
+{
+	const uint32_t k_inactive = k_static | k_sleeping;
+
+	for (int i = int(_manifolds.size()) - 1; i >= 0; --i)
+	{
+		ga_contact_manifold& manifold = _manifolds[i];
+		if (manifold._last_touched_step == step) continue;
+
+		bool resting = (manifold._body_a->_flags & k_inactive) && (manifold._body_b->_flags & k_inactive);
+		if (!resting)
+		{
+			remove_at(i);
+		}
+	}
+}
+
+void ga_contact_cache::remove_body(ga_rigid_body* body)
+{
+	for (int i = int(_manifolds.size()) - 1; i >= 0; --i)
+	{
+		if (_manifolds[i]._body_a == body || _manifolds[i]._body_b == body)
+		{
+			remove_at(i);
+		}
+	}
+}
+
+void ga_contact_cache::clear()
+{
+	_manifolds.clear();
+	_lookup.clear();
+}
+
+void ga_contact_cache::remove_at(int index)
+{
+	ga_contact_manifold& manifold = _manifolds[index];
+	_lookup.erase(key_t(manifold._body_a, manifold._body_b));
+
+	// Swap the last manifold into the hole to keep storage dense.
+	int last = int(_manifolds.size()) - 1;
+	if (index != last)
+	{
+		manifold = _manifolds[last];
+		_lookup[key_t(manifold._body_a, manifold._body_b)] = index;
+	}
+	_manifolds.pop_back();
+}
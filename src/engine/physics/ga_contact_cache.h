@@ -0,0 +1,112 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_intersection.h"
+
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class ga_rigid_body;
+
+/*
+** A single point of contact, with the impulse the solver accumulated on it.
+*/
+struct ga_contact_point
+{
+	ga_vec3f _position;
+	float _penetration;
+
+	// Accumulated normal impulse, carried between steps to warm start the solver.
+	float _normal_impulse;
+
+	// Per-step solver data.
+	float _normal_mass;
+	float _velocity_bias;
+};
+
+/*
+** The set of contact points between a pair of bodies.
+** The normal points from body A towards body B.
+*/
+struct ga_contact_manifold
+{
+	ga_rigid_body* _body_a;
+	ga_rigid_body* _body_b;
+
+	ga_vec3f _normal;
+	ga_contact_point _points[ga_collision_info::k_max_points];
+	int _point_count;
+
+	// Step on which the pair was last found touching.
+	uint32_t _last_touched_step;
+
+	// Per-step solver data: body positions before position correction.
+	ga_vec3f _start_position_a;
+	ga_vec3f _start_position_b;
+};
+
+/*
+** Persistent contact manifolds keyed by body pair.
+** Manifolds are stored densely so the solver can iterate them linearly.
+*/
+class ga_contact_cache
+{
+public:
+	ga_contact_cache();
+	~ga_contact_cache();
+
+	/*
+	** Refresh the manifold for a touching pair with newly generated contact points.
+	** Points that match a cached point keep its accumulated impulse.
+	*/
+	ga_contact_manifold* update(ga_rigid_body* body_a, ga_rigid_body* body_b,
+		const ga_collision_info* info, uint32_t step);
+
+	/*
+	** Drop manifolds not touched on the given step.
+	** Manifolds between two sleeping or static bodies are kept so they warm start on wake.
+	*/
+	void remove_stale(uint32_t step);
+
+	/*
+	** Drop every manifold that references the body.
+	*/
+	void remove_body(ga_rigid_body* body);
+
+	void clear();
+
+	int get_count() const { return int(_manifolds.size()); }
+	ga_contact_manifold* get_manifold(int index) { return &_manifolds[index]; }
+
+private:
+	typedef std::pair<ga_rigid_body*, ga_rigid_body*> key_t;
+
+	struct key_hash_t
+	{
+		size_t operator()(const key_t& k) const
+		{
+			size_t res = 17;
+			res = res * 31 + std::hash<ga_rigid_body*>()(k.first);
+			res = res * 31 + std::hash<ga_rigid_body*>()(k.second);
+			return res;
+		}
+	};
+
+	void remove_at(int index);
+
+	std::vector<ga_contact_manifold> _manifolds;
+	std::unordered_map<key_t, int, key_hash_t> _lookup;
+};
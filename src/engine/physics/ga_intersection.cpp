@@ -11,10 +11,42 @@
 
 #include "ga_shape.h"
 
+#include "framework/ga_compiler_defines.h"
+
 #include <cassert>
+#include <climits>
 #include <float.h>
 #include <vector>
 
+#if defined(GA_SSE)
+#include <emmintrin.h>
+#endif
+
+void ga_collision_info::add_manifold_point(const ga_vec3f& point, float penetration)
+{
+	if (_manifold_point_count < k_max_points)
+	{
+		_manifold_points[_manifold_point_count] = point;
+		_manifold_penetrations[_manifold_point_count] = penetration;
+		++_manifold_point_count;
+		return;
+	}
+
+	int shallowest = 0;
+	for (int i = 1; i < k_max_points; ++i)
+	{
+		if (_manifold_penetrations[i] < _manifold_penetrations[shallowest])
+		{
+			shallowest = i;
+		}
+	}
+	if (penetration > _manifold_penetrations[shallowest])
+	{
+		_manifold_points[shallowest] = point;
+		_manifold_penetrations[shallowest] = penetration;
+	}
+}
+
 float distance_to_plane(const ga_vec3f& point, const ga_plane* plane)
 {
 	return plane->_normal.dot(point) - plane->_normal.dot(plane->_point);
@@ -124,7 +156,10 @@ bool oobb_vs_plane(const ga_shape* a, const ga_mat4f& transform_a, const ga_shap
 	if (collision)
 	{
 		info->_penetration = radius - distance;
-		info->_normal = plane._normal;
+
+		// Keep the normal pointing from a to b.
+		info->_normal = (a->get_type() == k_shape_plane) ? plane._normal : -plane._normal;
+		info->_manifold_point_count = 0;
 
 		const int32_t k_num_corners = 8;
 		// We can find the collision point by finding the point penetrating farthest into the plane.
@@ -148,62 +183,89 @@ bool oobb_vs_plane(const ga_shape* a, const ga_mat4f& transform_a, const ga_shap
 			{
 				max_pen = pens[i];
 			}
-		}
 
-		// Gather all the corners that equal the maximum penetration.
-		std::vector<ga_vec3f> max_corners;
-		for (int i = 0; i < k_num_corners; ++i)
-		{
-			if (ga_equalf(pens[i], max_pen))
+			// Every corner below the plane is part of the contact manifold.
+			if (pens[i] < 0.0f)
 			{
-				max_corners.push_back(corners[i]);
+				info->add_manifold_point(corners[i], -pens[i]);
 			}
 		}
 
 		// Now, average the corners with the maximum penetration to find the collision point.
 		// If the point is an entire surface or edge, we should get a point in the middle of it.
 		ga_vec3f average = { 0.0f, 0.0f, 0.0f };
-		for (auto& c : max_corners)
+		int max_corner_count = 0;
+		for (int i = 0; i < k_num_corners; ++i)
 		{
-			average += c;
+			if (ga_equalf(pens[i], max_pen))
+			{
+				average += corners[i];
+				++max_corner_count;
+			}
 		}
-		average.scale(1.0f / static_cast<float>(max_corners.size()));
+		average.scale(1.0f / static_cast<float>(max_corner_count));
 
-		info->_point = average + info->_normal.scale_result(info->_penetration);
+		info->_point = average + plane._normal.scale_result(info->_penetration);
 	}
 
 	return collision;
 }
 
+/*
+** Fills out the four corners of the box farthest along a vector, farthest first.
+** Ties keep corner order, matching repeated farthest_along_vector calls.
+*/
+static void farthest_corners_along_vector(const ga_vec3f corners[8], const ga_vec3f& vector, ga_vec3f out[4])
+{
+	float dots[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		dots[i] = corners[i].dot(vector);
+	}
+
+	bool used[8] = {};
+	for (int n = 0; n < 4; ++n)
+	{
+		int best = -1;
+		for (int i = 0; i < 8; ++i)
+		{
+			if (!used[i] && (best < 0 || dots[i] > dots[best]))
+			{
+				best = i;
+			}
+		}
+		used[best] = true;
+		out[n] = corners[best];
+	}
+}
+
 ga_vec3f separating_axis_point_of_collision(const ga_oobb* oobb_a, const ga_oobb* oobb_b, uint32_t min_penetration_index)
 {
 	// This is not the ideal way of doing this, but it should arrive at the correct result.
 	ga_vec3f point_of_intersection;
 
-	std::vector<ga_vec3f> corners_a;
-	std::vector<ga_vec3f> corners_b;
+	ga_vec3f corners_a[8];
+	ga_vec3f corners_b[8];
 	oobb_a->get_corners(corners_a);
 	oobb_b->get_corners(corners_b);
 		
 	ga_vec3f a_to_b = oobb_b->_center - oobb_a->_center;
 
-	// Find the two points of a closest to b.
-	ga_vec3f primary_a = farthest_along_vector(corners_a, a_to_b);
-	corners_a.erase(std::find(corners_a.begin(), corners_a.end(), primary_a));
-	ga_vec3f secondary_a = farthest_along_vector(corners_a, a_to_b);
-	corners_a.erase(std::find(corners_a.begin(), corners_a.end(), secondary_a));
-	ga_vec3f tertiary_a = farthest_along_vector(corners_a, a_to_b);
-	corners_a.erase(std::find(corners_a.begin(), corners_a.end(), tertiary_a));
-	ga_vec3f quarternary_a = farthest_along_vector(corners_a, a_to_b);
-
-	// Find the two points of b closest to a.
-	ga_vec3f primary_b = farthest_along_vector(corners_b, -a_to_b);
-	corners_b.erase(std::find(corners_b.begin(), corners_b.end(), primary_b));
-	ga_vec3f secondary_b = farthest_along_vector(corners_b, -a_to_b);
-	corners_b.erase(std::find(corners_b.begin(), corners_b.end(), secondary_b));
-	ga_vec3f tertiary_b = farthest_along_vector(corners_b, -a_to_b);
-	corners_b.erase(std::find(corners_b.begin(), corners_b.end(), tertiary_b));
-	ga_vec3f quarternary_b = farthest_along_vector(corners_b, -a_to_b);
+	// Find the four points of a closest to b, and of b closest to a.
+	ga_vec3f closest_a[4];
+	ga_vec3f closest_b[4];
+	farthest_corners_along_vector(corners_a, a_to_b, closest_a);
+	farthest_corners_along_vector(corners_b, -a_to_b, closest_b);
+
+	ga_vec3f primary_a = closest_a[0];
+	ga_vec3f secondary_a = closest_a[1];
+	ga_vec3f tertiary_a = closest_a[2];
+	ga_vec3f quarternary_a = closest_a[3];
+
+	ga_vec3f primary_b = closest_b[0];
+	ga_vec3f secondary_b = closest_b[1];
+	ga_vec3f tertiary_b = closest_b[2];
+	ga_vec3f quarternary_b = closest_b[3];
 
 	// If the normal is one of the boxes' axes, use the closest point from the other box.
 	if (min_penetration_index < 3)
@@ -287,10 +349,137 @@ ga_vec3f separating_axis_point_of_collision(const ga_oobb* oobb_a, const ga_oobb
 	return point_of_intersection;
 }
 
+/*
+** Approximates the clipped contact polygon of a face contact by the corners of the
+** incident box that lie behind the reference box's face.
+** Normal points from a to b; reference_is_a selects which box owns the face.
+*/
+static void separating_axis_manifold(const ga_oobb* oobb_a, const ga_oobb* oobb_b, bool reference_is_a,
+	const ga_vec3f& normal, ga_collision_info* info)
+{
+	const ga_oobb* reference = reference_is_a ? oobb_a : oobb_b;
+	const ga_oobb* incident = reference_is_a ? oobb_b : oobb_a;
+
+	// Signed direction from the reference box towards the incident box.
+	ga_vec3f dir = reference_is_a ? normal : -normal;
+
+	float extent = 0.0f;
+	for (int i = 0; i < 3; ++i)
+	{
+		extent += ga_absf(reference->_half_vectors[i].dot(dir));
+	}
+	float face = reference->_center.dot(dir) + extent;
+
+	for (int i = 0; i < 8; ++i)
+	{
+		ga_vec3f corner = incident->_center;
+		corner += (i & 1) ? incident->_half_vectors[0] : -incident->_half_vectors[0];
+		corner += (i & 2) ? incident->_half_vectors[1] : -incident->_half_vectors[1];
+		corner += (i & 4) ? incident->_half_vectors[2] : -incident->_half_vectors[2];
+
+		float penetration = face - corner.dot(dir);
+		if (penetration > 0.0f)
+		{
+			info->add_manifold_point(corner, penetration);
+		}
+	}
+}
+
+/*
+** Overlap of two world space boxes along each of the 15 candidate axes.
+** Fills out the normalized axes and the overlap on each; a negative overlap is a
+** separating axis. Degenerate cross product axes (parallel edges) can't separate
+** and are given an overlap of FLT_MAX.
+**
+** The projections are done four axes at a time with SSE where available. All
+** storage is on the stack.
+*/
+static const int k_sat_axis_count = 15;
+static const int k_sat_axis_padded = 16;
+
+static void separating_axis_overlaps(const ga_oobb& oobb_a, const ga_oobb& oobb_b,
+	ga_vec3f axes[k_sat_axis_padded], float overlaps[k_sat_axis_padded])
+{
+	bool degenerate[k_sat_axis_padded] = {};
+
+	// Assemble axes
+	for (int i = 0; i < 3; ++i)
+	{
+		axes[i] = oobb_a._half_vectors[i].normal();
+		axes[3 + i] = oobb_b._half_vectors[i].normal();
+	}
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			ga_vec3f cross = ga_vec3f_cross(oobb_a._half_vectors[i], oobb_b._half_vectors[j]);
+			float mag2 = cross.mag2();
+			degenerate[6 + i * 3 + j] = !(mag2 > FLT_EPSILON * FLT_EPSILON);
+			axes[6 + i * 3 + j] = degenerate[6 + i * 3 + j] ? axes[0] : cross.scale_result(1.0f / ga_sqrtf(mag2));
+		}
+	}
+
+	// Pad to a multiple of four with a harmless duplicate.
+	axes[k_sat_axis_count] = axes[0];
+	degenerate[k_sat_axis_count] = true;
+
+	ga_vec3f center_delta = oobb_b._center - oobb_a._center;
+
+#if defined(GA_SSE)
+	const __m128 k_abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	for (int group = 0; group < k_sat_axis_padded; group += 4)
+	{
+		// Structure of arrays: four axes per register.
+		__m128 axis_x = _mm_setr_ps(axes[group].x, axes[group + 1].x, axes[group + 2].x, axes[group + 3].x);
+		__m128 axis_y = _mm_setr_ps(axes[group].y, axes[group + 1].y, axes[group + 2].y, axes[group + 3].y);
+		__m128 axis_z = _mm_setr_ps(axes[group].z, axes[group + 1].z, axes[group + 2].z, axes[group + 3].z);
+
+		__m128 radius = _mm_setzero_ps();
+		for (int j = 0; j < 3; ++j)
+		{
+			const ga_vec3f& ha = oobb_a._half_vectors[j];
+			__m128 dot_a = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(ha.x), axis_x),
+				_mm_mul_ps(_mm_set1_ps(ha.y), axis_y)),
+				_mm_mul_ps(_mm_set1_ps(ha.z), axis_z));
+
+			const ga_vec3f& hb = oobb_b._half_vectors[j];
+			__m128 dot_b = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(hb.x), axis_x),
+				_mm_mul_ps(_mm_set1_ps(hb.y), axis_y)),
+				_mm_mul_ps(_mm_set1_ps(hb.z), axis_z));
+
+			radius = _mm_add_ps(radius, _mm_add_ps(_mm_and_ps(dot_a, k_abs_mask), _mm_and_ps(dot_b, k_abs_mask)));
+		}
+
+		__m128 distance = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_set1_ps(center_delta.x), axis_x),
+			_mm_mul_ps(_mm_set1_ps(center_delta.y), axis_y)),
+			_mm_mul_ps(_mm_set1_ps(center_delta.z), axis_z));
+
+		_mm_storeu_ps(overlaps + group, _mm_sub_ps(radius, _mm_and_ps(distance, k_abs_mask)));
+	}
+#else
+	for (int i = 0; i < k_sat_axis_padded; ++i)
+	{
+		float radius = 0.0f;
+		for (int j = 0; j < 3; ++j)
+		{
+			radius += ga_absf(oobb_a._half_vectors[j].dot(axes[i]));
+			radius += ga_absf(oobb_b._half_vectors[j].dot(axes[i]));
+		}
+		overlaps[i] = radius - ga_absf(center_delta.dot(axes[i]));
+	}
+#endif
+
+	for (int i = 0; i < k_sat_axis_padded; ++i)
+	{
+		if (degenerate[i]) overlaps[i] = FLT_MAX;
+	}
+}
+
 bool separating_axis_test(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
 {
-	bool collision = true;
-	std::vector<ga_vec3f> axes;
 	ga_oobb oobb_a, oobb_b;
 
 	oobb_a = *reinterpret_cast<const ga_oobb*>(a);
@@ -305,77 +494,319 @@ bool separating_axis_test(const ga_shape* a, const ga_mat4f& transform_a, const
 	oobb_b._half_vectors[1] = transform_b.transform_vector(oobb_b._half_vectors[1]);
 	oobb_b._half_vectors[2] = transform_b.transform_vector(oobb_b._half_vectors[2]);
 
-	float min_penetration = FLT_MAX;
-	ga_vec3f min_penetration_axis;
+	ga_vec3f axes[k_sat_axis_padded];
+	float overlaps[k_sat_axis_padded];
+	separating_axis_overlaps(oobb_a, oobb_b, axes, overlaps);
+
+	// The boxes collide if no axis separates them. The contact is along the axis of
+	// minimum penetration. Edge axes must beat the face axes by a small tolerance, so
+	// rounding noise on boxes with parallel faces doesn't pick an edge contact.
+	const float k_edge_axis_tolerance = 1.0e-4f;
 	uint32_t min_penetration_index = INT_MAX;
+	float min_penetration = FLT_MAX;
+	for (int i = 0; i < k_sat_axis_count; ++i)
+	{
+		if (overlaps[i] < 0.0f)
+		{
+			return false;
+		}
+		float tolerance = i < 6 ? 0.0f : k_edge_axis_tolerance;
+		if (overlaps[i] + tolerance < min_penetration)
+		{
+			min_penetration = overlaps[i];
+			min_penetration_index = i;
+		}
+	}
 
-	// The local variable 'collision' should be set true or false depending on whether the
-	// two boxes are interpenetrating.
+	if (min_penetration_index == INT_MAX)
+	{
+		return true;
+	}
 
-	// Assemble axes
-	for (int i = 0; i < 3; ++i)
+	// The normal of the collision is the axis of minimum penetration, pointing from a to b.
+	ga_vec3f min_penetration_axis = axes[min_penetration_index];
+	if (min_penetration_axis.dot(oobb_b._center - oobb_a._center) < 0.0f)
 	{
-		axes.push_back(oobb_a._half_vectors[i].normal());
+		min_penetration_axis = -min_penetration_axis;
 	}
-	for (int i = 0; i < 3; ++i)
+	info->_normal = min_penetration_axis;
+	info->_penetration = min_penetration;
+	info->_point = separating_axis_point_of_collision(&oobb_a, &oobb_b, min_penetration_index);
+
+	info->_manifold_point_count = 0;
+	if (min_penetration_index < 6)
 	{
-		axes.push_back(oobb_b._half_vectors[i].normal());
+		separating_axis_manifold(&oobb_a, &oobb_b, min_penetration_index < 3, min_penetration_axis, info);
 	}
-	for (int i = 0; i < 3; ++i)
+	if (info->_manifold_point_count == 0)
 	{
-		for (int j = 0; j < 3; ++j)
-		{
-			axes.push_back(ga_vec3f_cross(oobb_a._half_vectors[i],
-				oobb_b._half_vectors[j]).normal());
-		}
+		// Edge contacts have a single point.
+		info->add_manifold_point(info->_point, min_penetration);
 	}
 
-	// Test for seperation
-	for (int i = 0; i < axes.size(); ++i)
+	return true;
+}
+
+
+ga_vec3f closest_point_on_segment(const ga_vec3f& point, const ga_vec3f& a, const ga_vec3f& b)
+{
+	ga_vec3f segment = b - a;
+	float length2 = segment.mag2();
+	if (length2 <= 0.0f) return a;
+
+	float t = ga_max(0.0f, ga_min(1.0f, (point - a).dot(segment) / length2));
+	return a + segment.scale_result(t);
+}
+
+void closest_points_on_segments(
+	const ga_vec3f& start_a,
+	const ga_vec3f& end_a,
+	const ga_vec3f& start_b,
+	const ga_vec3f& end_b,
+	ga_vec3f& point_a,
+	ga_vec3f& point_b)
+{
+	// Unlike closest_points_on_lines this clamps to the segments and handles
+	// parallel and degenerate segments. From Ericson, Real-Time Collision Detection 5.1.9.
+	ga_vec3f d1 = end_a - start_a;
+	ga_vec3f d2 = end_b - start_b;
+	ga_vec3f r = start_a - start_b;
+	float a = d1.dot(d1);
+	float e = d2.dot(d2);
+	float f = d2.dot(r);
+
+	float s = 0.0f;
+	float t = 0.0f;
+	if (a <= FLT_EPSILON && e <= FLT_EPSILON)
 	{
-		float proj_a = 0;
-		float proj_b = 0;
-		for (int j = 0; j < 3; ++j)
-		{
-			proj_a += abs(oobb_a._half_vectors[j].dot(axes[i]));
-			proj_b += abs(oobb_b._half_vectors[j].dot(axes[i]));
-		}
-		float center_a = oobb_a._center.dot(axes[i]);
-		float center_b = oobb_b._center.dot(axes[i]);
-		float min_a = center_a - proj_a;
-		float max_a = center_a + proj_a;
-		float min_b = center_b - proj_b;
-		float max_b = center_b + proj_b;
-
-		// Check if not overlapping
-		if (min_a > max_b || max_a < min_b)
+		// Both segments are points.
+	}
+	else if (a <= FLT_EPSILON)
+	{
+		t = ga_max(0.0f, ga_min(1.0f, f / e));
+	}
+	else
+	{
+		float c = d1.dot(r);
+		if (e <= FLT_EPSILON)
 		{
-			collision = false;
-			break;
+			s = ga_max(0.0f, ga_min(1.0f, -c / a));
 		}
 		else
 		{
-			float penetration = ga_min((max_b - min_a), (max_a - min_b));
-			if (penetration < min_penetration)
+			float b = d1.dot(d2);
+			float denom = a * e - b * b;
+			s = denom != 0.0f ? ga_max(0.0f, ga_min(1.0f, (b * f - c * e) / denom)) : 0.0f;
+			t = (b * s + f) / e;
+			if (t < 0.0f)
+			{
+				t = 0.0f;
+				s = ga_max(0.0f, ga_min(1.0f, -c / a));
+			}
+			else if (t > 1.0f)
 			{
-				min_penetration = penetration;
-				min_penetration_axis = axes[i];
-				min_penetration_index = i;
+				t = 1.0f;
+				s = ga_max(0.0f, ga_min(1.0f, (b - c) / a));
 			}
 		}
 	}
 
-	if (collision && min_penetration_index < INT_MAX)
+	point_a = start_a + d1.scale_result(s);
+	point_b = start_b + d2.scale_result(t);
+}
+
+/*
+** A sphere or capsule in world space. Spheres have both points equal.
+*/
+struct ga_swept_sphere
+{
+	ga_vec3f _point_a;
+	ga_vec3f _point_b;
+	float _radius;
+};
+
+static bool is_swept_sphere(const ga_shape* shape)
+{
+	return shape->get_type() == k_shape_sphere || shape->get_type() == k_shape_capsule;
+}
+
+static ga_swept_sphere get_swept_sphere(const ga_shape* shape, const ga_mat4f& transform)
+{
+	// A scaled radius grows by the largest scale, so a non-uniform scale turns
+	// spheres into the sphere that contains them.
+	ga_vec3f scale = transform.get_scale();
+	float radius_scale = ga_max(scale.x, ga_max(scale.y, scale.z));
+
+	ga_swept_sphere result;
+	if (shape->get_type() == k_shape_sphere)
+	{
+		const ga_sphere* sphere = reinterpret_cast<const ga_sphere*>(shape);
+		result._point_a = transform.transform_point(sphere->_center);
+		result._point_b = result._point_a;
+		result._radius = sphere->_radius * radius_scale;
+	}
+	else
+	{
+		const ga_capsule* capsule = reinterpret_cast<const ga_capsule*>(shape);
+		result._point_a = transform.transform_point(capsule->_point_a);
+		result._point_b = transform.transform_point(capsule->_point_b);
+		result._radius = capsule->_radius * radius_scale;
+	}
+	return result;
+}
+
+bool capsule_vs_plane(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
+{
+	// Figure out which shape is which.
+	bool plane_is_a = a->get_type() == k_shape_plane;
+	ga_swept_sphere capsule = plane_is_a ? get_swept_sphere(b, transform_b) : get_swept_sphere(a, transform_a);
+	ga_plane plane = *reinterpret_cast<const ga_plane*>(plane_is_a ? a : b);
+	const ga_mat4f& plane_transform = plane_is_a ? transform_a : transform_b;
+	plane._normal = plane_transform.transform_vector(plane._normal);
+	plane._point += plane_transform.get_translation();
+
+	float distance_a = distance_to_plane(capsule._point_a, &plane);
+	float distance_b = distance_to_plane(capsule._point_b, &plane);
+	float distance = ga_min(distance_a, distance_b);
+
+	bool collision = distance < capsule._radius;
+	if (collision)
+	{
+		// Keep the normal pointing from a to b.
+		info->_normal = plane_is_a ? plane._normal : -plane._normal;
+		info->_penetration = capsule._radius - distance;
+		info->_manifold_point_count = 0;
+
+		// Each end cap below the plane is a contact point, so a capsule lying flat rests on two.
+		if (distance_a < capsule._radius)
+		{
+			info->add_manifold_point(capsule._point_a - plane._normal.scale_result(capsule._radius), capsule._radius - distance_a);
+		}
+		if (distance_b < capsule._radius && !(capsule._point_b == capsule._point_a))
+		{
+			info->add_manifold_point(capsule._point_b - plane._normal.scale_result(capsule._radius), capsule._radius - distance_b);
+		}
+
+		ga_vec3f deepest = distance_a < distance_b ? capsule._point_a : capsule._point_b;
+		info->_point = deepest - plane._normal.scale_result(distance);
+	}
+
+	return collision;
+}
+
+bool capsule_vs_capsule(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
+{
+	ga_swept_sphere capsule_a = get_swept_sphere(a, transform_a);
+	ga_swept_sphere capsule_b = get_swept_sphere(b, transform_b);
+
+	ga_vec3f point_a, point_b;
+	closest_points_on_segments(capsule_a._point_a, capsule_a._point_b, capsule_b._point_a, capsule_b._point_b, point_a, point_b);
+
+	ga_vec3f a_to_b = point_b - point_a;
+	float radius = capsule_a._radius + capsule_b._radius;
+	float distance2 = a_to_b.mag2();
+
+	bool collision = distance2 < radius * radius;
+	if (collision)
 	{
-		// The normal of the collision is the axis of minimum penetration.
-		info->_normal = min_penetration_axis;
-		info->_penetration = min_penetration;
-		info->_point = separating_axis_point_of_collision(&oobb_a, &oobb_b, min_penetration_index);
+		float distance = ga_sqrtf(distance2);
+
+		// Coincident cores have no preferred direction, so push them apart vertically.
+		info->_normal = distance > FLT_EPSILON ? a_to_b.scale_result(1.0f / distance) : ga_vec3f::y_vector();
+		info->_penetration = radius - distance;
+		info->_point = point_a + info->_normal.scale_result(capsule_a._radius - info->_penetration * 0.5f);
+		info->_manifold_point_count = 0;
+		info->add_manifold_point(info->_point, info->_penetration);
 	}
 
 	return collision;
 }
 
+bool capsule_vs_oobb(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
+{
+	// Figure out which shape is which.
+	bool capsule_is_a = is_swept_sphere(a);
+	ga_swept_sphere capsule = capsule_is_a ? get_swept_sphere(a, transform_a) : get_swept_sphere(b, transform_b);
+	const ga_oobb* local_oobb = reinterpret_cast<const ga_oobb*>(capsule_is_a ? b : a);
+	const ga_mat4f& oobb_transform = capsule_is_a ? transform_b : transform_a;
+
+	ga_vec3f center = oobb_transform.transform_point(local_oobb->_center);
+	ga_vec3f axes[3];
+	float extents[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		ga_vec3f half_vector = oobb_transform.transform_vector(local_oobb->_half_vectors[i]);
+		extents[i] = half_vector.mag();
+		axes[i] = half_vector.scale_result(1.0f / extents[i]);
+	}
+
+	// Box coordinates of the point on the box closest to the given point.
+	auto closest_on_box = [&](const ga_vec3f& point, float local[3])
+	{
+		ga_vec3f offset = point - center;
+		ga_vec3f closest = center;
+		for (int i = 0; i < 3; ++i)
+		{
+			local[i] = offset.dot(axes[i]);
+			closest += axes[i].scale_result(ga_max(-extents[i], ga_min(extents[i], local[i])));
+		}
+		return closest;
+	};
+
+	// The segment and the box are both convex, so alternating closest point queries
+	// converge on the closest pair. A few rounds is plenty for contact purposes.
+	float local[3];
+	ga_vec3f on_segment = (capsule._point_a + capsule._point_b).scale_result(0.5f);
+	ga_vec3f on_box = closest_on_box(on_segment, local);
+	for (int i = 0; i < 4; ++i)
+	{
+		on_segment = closest_point_on_segment(on_box, capsule._point_a, capsule._point_b);
+		on_box = closest_on_box(on_segment, local);
+	}
+
+	ga_vec3f segment_to_box = on_box - on_segment;
+	float distance2 = segment_to_box.mag2();
+	if (distance2 >= capsule._radius * capsule._radius)
+	{
+		return false;
+	}
+
+	ga_vec3f normal;
+	float penetration;
+	if (distance2 > FLT_EPSILON)
+	{
+		float distance = ga_sqrtf(distance2);
+		normal = segment_to_box.scale_result(1.0f / distance);
+		penetration = capsule._radius - distance;
+	}
+	else
+	{
+		// The core is inside the box: push out through the nearest face.
+		int face = 0;
+		float face_depth = FLT_MAX;
+		for (int i = 0; i < 3; ++i)
+		{
+			float depth = extents[i] - ga_absf(local[i]);
+			if (depth < face_depth)
+			{
+				face_depth = depth;
+				face = i;
+			}
+		}
+		normal = local[face] > 0.0f ? -axes[face] : axes[face];
+		penetration = capsule._radius + face_depth;
+	}
+
+	// Keep the normal pointing from a to b.
+	info->_normal = capsule_is_a ? normal : -normal;
+	info->_penetration = penetration;
+	info->_point = on_box;
+	info->_manifold_point_count = 0;
+	info->add_manifold_point(on_box, penetration);
+
+	return true;
+}
+
 
 bool ray_intersection_unimplemented(const ga_vec3f & ray_origin, const ga_vec3f & ray_dir,
 	const ga_shape* shape, const ga_mat4f& transform, float * dist)
@@ -422,7 +853,7 @@ bool ray_vs_oobb(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
 		t = tymax < t || t < 0 ? tymax : t;
 	if (tzmin > 0 && point_in_rect(ptzmin.x, ptzmin.y, min.x, min.y, max.x, max.y))
 		t = tzmin < t || t < 0 ? tzmin : t;
-	if (tzmax > 0 && point_in_rect(ptzmax.x, ptzmin.y, min.x, min.y, max.x, max.y))
+	if (tzmax > 0 && point_in_rect(ptzmax.x, ptzmax.y, min.x, min.y, max.x, max.y))
 		t = tzmax < t || t < 0 ? tzmax : t;
 	
 	if (t >= 0)
@@ -451,7 +882,262 @@ bool ray_vs_plane(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
 }
 
 
+bool ray_vs_sphere(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
+	const ga_shape* shape, const ga_mat4f& transform, float* dist)
+{
+	ga_swept_sphere sphere = get_swept_sphere(shape, transform);
+	return ray_vs_sphere_point(ray_origin, ray_dir, sphere._point_a, sphere._radius, dist);
+}
+
+bool ray_vs_sphere_point(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
+	const ga_vec3f& center, float radius, float* dist)
+{
+	ga_vec3f m = ray_origin - center;
+	float a = ray_dir.dot(ray_dir);
+	float b = m.dot(ray_dir);
+	float c = m.dot(m) - radius * radius;
+
+	// Outside the sphere and pointing away from it.
+	if (c > 0.0f && b > 0.0f) return false;
+
+	float discriminant = b * b - a * c;
+	if (discriminant < 0.0f) return false;
+
+	// Report the first crossing in front of the origin.
+	float root = ga_sqrtf(discriminant);
+	float t = (-b - root) / a;
+	if (t < 0.0f) t = (-b + root) / a;
+	*dist = t;
+	return true;
+}
+
+/*
+** Ray against a capsule given as a world space segment and radius.
+*/
+static bool ray_vs_capsule_segment(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
+	const ga_vec3f& point_a, const ga_vec3f& point_b, float radius, float* dist)
+{
+	bool hit = false;
+	float best = FLT_MAX;
+
+	// End caps.
+	float t;
+	if (ray_vs_sphere_point(ray_origin, ray_dir, point_a, radius, &t) && t < best)
+	{
+		best = t;
+		hit = true;
+	}
+	if (ray_vs_sphere_point(ray_origin, ray_dir, point_b, radius, &t) && t < best)
+	{
+		best = t;
+		hit = true;
+	}
+
+	// Cylinder: solve in the plane perpendicular to the axis, then keep roots within the segment.
+	ga_vec3f axis = point_b - point_a;
+	float length = axis.mag();
+	if (length > FLT_EPSILON)
+	{
+		axis.scale(1.0f / length);
+		ga_vec3f m = ray_origin - point_a;
+		ga_vec3f m_perp = m - axis.scale_result(m.dot(axis));
+		ga_vec3f d_perp = ray_dir - axis.scale_result(ray_dir.dot(axis));
+
+		float a = d_perp.dot(d_perp);
+		float b = m_perp.dot(d_perp);
+		float c = m_perp.dot(m_perp) - radius * radius;
+		float discriminant = b * b - a * c;
+		if (a > FLT_EPSILON && discriminant >= 0.0f)
+		{
+			float root = ga_sqrtf(discriminant);
+			float roots[2] = { (-b - root) / a, (-b + root) / a };
+			for (int i = 0; i < 2; ++i)
+			{
+				float height = (m + ray_dir.scale_result(roots[i])).dot(axis);
+				if (roots[i] >= 0.0f && roots[i] < best && height >= 0.0f && height <= length)
+				{
+					best = roots[i];
+					hit = true;
+				}
+			}
+		}
+	}
+
+	if (hit)
+	{
+		*dist = best;
+	}
+	return hit;
+}
+
+bool ray_vs_capsule(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
+	const ga_shape* shape, const ga_mat4f& transform, float* dist)
+{
+	ga_swept_sphere capsule = get_swept_sphere(shape, transform);
+	return ray_vs_capsule_segment(ray_origin, ray_dir, capsule._point_a, capsule._point_b, capsule._radius, dist);
+}
+
+
 bool point_in_rect(float x, float y, float minx, float miny, float maxx, float maxy)
 {
 	return x >= minx && x <= maxx && y >= miny && y <= maxy;
-}
\ No newline at end of file
+}
+
+bool point_in_oobb(const ga_vec3f& point, const ga_shape* shape, const ga_mat4f& transform)
+{
+	const ga_oobb* oobb = reinterpret_cast<const ga_oobb*>(shape);
+	ga_vec3f local = transform.inverse().transform_point(point) - oobb->_center;
+
+	// Project onto each half vector; inside if no projection exceeds its length.
+	for (int i = 0; i < 3; ++i)
+	{
+		float length2 = oobb->_half_vectors[i].mag2();
+		if (ga_absf(local.dot(oobb->_half_vectors[i])) > length2) return false;
+	}
+	return true;
+}
+
+bool point_in_plane(const ga_vec3f& point, const ga_shape* shape, const ga_mat4f& transform)
+{
+	ga_plane plane = *reinterpret_cast<const ga_plane*>(shape);
+	plane._normal = transform.transform_vector(plane._normal);
+	plane._point += transform.get_translation();
+	return distance_to_plane(point, &plane) <= 0.0f;
+}
+
+bool point_in_capsule(const ga_vec3f& point, const ga_shape* shape, const ga_mat4f& transform)
+{
+	ga_swept_sphere capsule = get_swept_sphere(shape, transform);
+	ga_vec3f closest = closest_point_on_segment(point, capsule._point_a, capsule._point_b);
+	return (point - closest).mag2() <= capsule._radius * capsule._radius;
+}
+
+bool sphere_sweep_vs_plane(const ga_vec3f& origin, const ga_vec3f& dir, float radius,
+	const ga_shape* shape, const ga_mat4f& transform, float* dist)
+{
+	ga_plane plane = *reinterpret_cast<const ga_plane*>(shape);
+	plane._normal = transform.transform_vector(plane._normal);
+	plane._point += transform.get_translation();
+
+	float distance = distance_to_plane(origin, &plane);
+	if (distance <= radius)
+	{
+		*dist = 0.0f;
+		return true;
+	}
+
+	float approach = plane._normal.dot(dir);
+	if (approach >= 0.0f) return false;
+
+	*dist = (radius - distance) / approach;
+	return true;
+}
+
+bool sphere_sweep_vs_capsule(const ga_vec3f& origin, const ga_vec3f& dir, float radius,
+	const ga_shape* shape, const ga_mat4f& transform, float* dist)
+{
+	// Sweeping a sphere against a capsule is a ray against the capsule grown by the radius.
+	ga_swept_sphere capsule = get_swept_sphere(shape, transform);
+	float total_radius = capsule._radius + radius;
+
+	ga_vec3f closest = closest_point_on_segment(origin, capsule._point_a, capsule._point_b);
+	if ((origin - closest).mag2() <= total_radius * total_radius)
+	{
+		*dist = 0.0f;
+		return true;
+	}
+
+	return ray_vs_capsule_segment(origin, dir, capsule._point_a, capsule._point_b, total_radius, dist);
+}
+
+bool sphere_sweep_vs_oobb(const ga_vec3f& origin, const ga_vec3f& dir, float radius,
+	const ga_shape* shape, const ga_mat4f& transform, float* dist)
+{
+	// The swept sphere touches the box where the ray meets the box rounded by the
+	// radius: its faces pushed out by the radius, joined by capsules along its edges.
+	const ga_oobb* oobb = reinterpret_cast<const ga_oobb*>(shape);
+	ga_vec3f center = transform.transform_point(oobb->_center);
+	ga_vec3f axes[3];
+	float extents[3];
+	float local_origin[3];
+	float local_dir[3];
+	float distance2 = 0.0f;
+	for (int i = 0; i < 3; ++i)
+	{
+		ga_vec3f half_vector = transform.transform_vector(oobb->_half_vectors[i]);
+		extents[i] = half_vector.mag();
+		axes[i] = half_vector.scale_result(1.0f / extents[i]);
+		local_origin[i] = (origin - center).dot(axes[i]);
+		local_dir[i] = dir.dot(axes[i]);
+
+		float outside = ga_max(ga_absf(local_origin[i]) - extents[i], 0.0f);
+		distance2 += outside * outside;
+	}
+
+	if (distance2 <= radius * radius)
+	{
+		*dist = 0.0f;
+		return true;
+	}
+
+	// Slab test against the box grown by the radius.
+	float t_enter = 0.0f;
+	float t_exit = FLT_MAX;
+	for (int i = 0; i < 3; ++i)
+	{
+		float grown = extents[i] + radius;
+		if (ga_absf(local_dir[i]) < FLT_EPSILON)
+		{
+			if (ga_absf(local_origin[i]) > grown) return false;
+			continue;
+		}
+
+		float t0 = (-grown - local_origin[i]) / local_dir[i];
+		float t1 = (grown - local_origin[i]) / local_dir[i];
+		t_enter = ga_max(t_enter, ga_min(t0, t1));
+		t_exit = ga_min(t_exit, ga_max(t0, t1));
+		if (t_enter > t_exit) return false;
+	}
+
+	// Entering over a face: that's the contact.
+	int outside_axes = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (ga_absf(local_origin[i] + local_dir[i] * t_enter) > extents[i]) ++outside_axes;
+	}
+	if (outside_axes <= 1)
+	{
+		*dist = t_enter;
+		return true;
+	}
+
+	// Entering over an edge or corner region, where the rounded box is made of capsules.
+	bool hit = false;
+	float best = FLT_MAX;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		int u = (axis + 1) % 3;
+		int v = (axis + 2) % 3;
+		for (int corner = 0; corner < 4; ++corner)
+		{
+			ga_vec3f edge_center = center +
+				axes[u].scale_result((corner & 1) ? extents[u] : -extents[u]) +
+				axes[v].scale_result((corner & 2) ? extents[v] : -extents[v]);
+			ga_vec3f half_edge = axes[axis].scale_result(extents[axis]);
+
+			float t;
+			if (ray_vs_capsule_segment(origin, dir, edge_center - half_edge, edge_center + half_edge, radius, &t) && t < best)
+			{
+				best = t;
+				hit = true;
+			}
+		}
+	}
+
+	if (hit)
+	{
+		*dist = best;
+	}
+	return hit;
+}
+
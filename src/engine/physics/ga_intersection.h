@@ -22,12 +22,27 @@ class ga_rigid_body;
 ** Information returned when a collision is detected.
 ** Includes the point of collision, the normal at the collision point, and
 ** the amount the two objects are interpenetrating.
+**
+** The normal always points from the first shape passed to the test towards the
+** second. The manifold points are the penetrating features of the contact (up to
+** four), used by the contact solver; _point is their representative center.
 */
 struct ga_collision_info
 {
+	static const int k_max_points = 4;
+
 	ga_vec3f _point;
 	ga_vec3f _normal;
 	float _penetration;
+
+	ga_vec3f _manifold_points[k_max_points];
+	float _manifold_penetrations[k_max_points];
+	int _manifold_point_count = 0;
+
+	/*
+	** Add a manifold point. When full, the shallowest point is replaced.
+	*/
+	void add_manifold_point(const ga_vec3f& point, float penetration);
 };
 
 struct ga_raycast_hit_info
@@ -60,6 +75,22 @@ bool closest_points_on_lines(
 	ga_vec3f& point_a,
 	ga_vec3f& point_b);
 
+/*
+** Compute the closest point on a line segment to a point.
+*/
+ga_vec3f closest_point_on_segment(const ga_vec3f& point, const ga_vec3f& a, const ga_vec3f& b);
+
+/*
+** Compute the closest points between two line segments, clamped to the segments.
+*/
+void closest_points_on_segments(
+	const ga_vec3f& start_a,
+	const ga_vec3f& end_a,
+	const ga_vec3f& start_b,
+	const ga_vec3f& end_b,
+	ga_vec3f& point_a,
+	ga_vec3f& point_b);
+
 /*
 ** Compute the point farthest along a directional vector.
 */
@@ -80,6 +111,14 @@ bool oobb_vs_plane(const ga_shape* a, const ga_mat4f& transform_a, const ga_shap
 */
 bool separating_axis_test(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info);
 
+/*
+** Collision tests for spheres and capsules. A sphere is treated as a capsule
+** whose segment has zero length, so every test accepts either shape.
+*/
+bool capsule_vs_plane(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info);
+bool capsule_vs_capsule(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info);
+bool capsule_vs_oobb(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info);
+
 
 /*
 ** Stub function for unimplemented ray intersection algorithms.
@@ -97,4 +136,37 @@ bool ray_vs_oobb(const ga_vec3f & ray_origin, const ga_vec3f & ray_dir,
 bool ray_vs_plane(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
 	const ga_shape* shape, const ga_mat4f& transform, float* dist);
 
-bool point_in_rect(float x, float y, float minx, float miny, float maxx, float maxy);
\ No newline at end of file
+bool ray_vs_sphere(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
+	const ga_shape* shape, const ga_mat4f& transform, float* dist);
+
+bool ray_vs_capsule(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
+	const ga_shape* shape, const ga_mat4f& transform, float* dist);
+
+/*
+** Check for intersection between a ray and a world space sphere.
+** Dist is set to the first crossing in front of the ray origin.
+*/
+bool ray_vs_sphere_point(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
+	const ga_vec3f& center, float radius, float* dist);
+
+bool point_in_rect(float x, float y, float minx, float miny, float maxx, float maxy);
+
+/*
+** Check whether a point lies inside or on a shape. Planes are solid below the surface.
+** Capsule tests accept spheres too.
+*/
+bool point_in_oobb(const ga_vec3f& point, const ga_shape* shape, const ga_mat4f& transform);
+bool point_in_plane(const ga_vec3f& point, const ga_shape* shape, const ga_mat4f& transform);
+bool point_in_capsule(const ga_vec3f& point, const ga_shape* shape, const ga_mat4f& transform);
+
+/*
+** Sweep a sphere of the given radius from origin along a unit direction.
+** Dist is set to t along the direction at first contact, or zero if the sphere
+** starts out touching the shape. Capsule sweeps accept spheres too.
+*/
+bool sphere_sweep_vs_plane(const ga_vec3f& origin, const ga_vec3f& dir, float radius,
+	const ga_shape* shape, const ga_mat4f& transform, float* dist);
+bool sphere_sweep_vs_oobb(const ga_vec3f& origin, const ga_vec3f& dir, float radius,
+	const ga_shape* shape, const ga_mat4f& transform, float* dist);
+bool sphere_sweep_vs_capsule(const ga_vec3f& origin, const ga_vec3f& dir, float radius,
+	const ga_shape* shape, const ga_mat4f& transform, float* dist);
\ No newline at end of file
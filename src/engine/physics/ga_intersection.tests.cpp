@@ -11,6 +11,7 @@
 #include "ga_intersection.h"
 
 #include "ga_shape.h"
+#include "ga_shape_dispatch.h"
 
 #include <cassert>
 
@@ -130,4 +131,165 @@ void ga_intersection_unit_tests()
 		hit = ray_vs_plane({ 0, 10, 0 }, { 0, 1, 0 }, &plane, trans_a, &dist);
 		assert(!hit);
 	}
+
+	// Test shape dispatch resolves both orders of a pair.
+	{
+		ga_plane plane;
+		plane._point = { 0.0f, 0.0f, 0.0f };
+		plane._normal = { 0.0f, 1.0f, 0.0f };
+
+		ga_oobb oobb;
+		oobb._half_vectors[0] = { 1.0f, 0.0f, 0.0f };
+		oobb._half_vectors[1] = { 0.0f, 1.0f, 0.0f };
+		oobb._half_vectors[2] = { 0.0f, 0.0f, 1.0f };
+
+		ga_mat4f trans_plane, trans_oobb;
+		trans_plane.make_identity();
+		trans_oobb.make_translation({ 0.0f, 0.9f, 0.0f });
+
+		ga_collision_info info;
+		assert(ga_collide(&plane, trans_plane, &oobb, trans_oobb, &info));
+		assert(info._normal.y > 0.0f);
+		assert(ga_collide(&oobb, trans_oobb, &plane, trans_plane, &info));
+		assert(info._normal.y < 0.0f);
+
+		assert((ga_collider<ga_plane, ga_oobb>::k_implemented));
+		assert((!ga_collider<ga_plane, ga_plane>::k_implemented));
+
+		float dist;
+		assert(ga_intersect_ray({ 0, 10, 0 }, { 0, -1, 0 }, &oobb, trans_oobb, &dist));
+		assert(ga_equalf(dist, 8.1f));
+	}
+
+	// Test sphere and capsule collisions.
+	{
+		ga_plane plane;
+		plane._point = { 0.0f, 0.0f, 0.0f };
+		plane._normal = { 0.0f, 1.0f, 0.0f };
+
+		ga_sphere sphere;
+		sphere._radius = 1.0f;
+
+		ga_capsule capsule;
+		capsule._point_a = { -1.0f, 0.0f, 0.0f };
+		capsule._point_b = { 1.0f, 0.0f, 0.0f };
+		capsule._radius = 0.5f;
+
+		ga_oobb oobb;
+		oobb._half_vectors[0] = { 1.0f, 0.0f, 0.0f };
+		oobb._half_vectors[1] = { 0.0f, 1.0f, 0.0f };
+		oobb._half_vectors[2] = { 0.0f, 0.0f, 1.0f };
+
+		ga_mat4f trans_a, trans_b;
+		trans_a.make_identity();
+		ga_collision_info info;
+
+		// Sphere resting slightly in the floor.
+		trans_b.make_translation({ 0.0f, 0.9f, 0.0f });
+		assert(ga_collide(&plane, trans_a, &sphere, trans_b, &info));
+		assert(ga_absf(info._penetration - 0.1f) < 0.0001f);
+		assert(info._normal.y > 0.0f);
+		trans_b.make_translation({ 0.0f, 1.1f, 0.0f });
+		assert(!ga_collide(&plane, trans_a, &sphere, trans_b, &info));
+
+		// A capsule lying flat touches the floor at both ends.
+		trans_b.make_translation({ 0.0f, 0.4f, 0.0f });
+		assert(ga_collide(&plane, trans_a, &capsule, trans_b, &info));
+		assert(info._manifold_point_count == 2);
+
+		// Spheres and capsules against each other.
+		trans_b.make_translation({ 0.0f, 1.4f, 0.0f });
+		assert(ga_collide(&capsule, trans_a, &sphere, trans_b, &info));
+		assert(info._normal.y > 0.99f);
+		trans_b.make_translation({ 2.0f, 1.4f, 0.0f });
+		assert(!ga_collide(&capsule, trans_a, &sphere, trans_b, &info));
+
+		// Spheres and capsules against boxes, including a capsule through the box.
+		trans_b.make_translation({ 0.0f, 1.9f, 0.0f });
+		assert(ga_collide(&oobb, trans_a, &sphere, trans_b, &info));
+		assert(info._normal.y > 0.99f);
+		trans_b.make_translation({ 1.8f, 1.8f, 0.0f });
+		assert(!ga_collide(&oobb, trans_a, &sphere, trans_b, &info));
+		trans_b.make_translation({ 0.0f, 0.8f, 0.0f });
+		assert(ga_collide(&capsule, trans_b, &oobb, trans_a, &info));
+		assert(info._normal.y < -0.99f);
+		assert(ga_absf(info._penetration - 0.7f) < 0.0001f);
+	}
+
+	// Test sphere and capsule raycasts.
+	{
+		ga_sphere sphere;
+		sphere._radius = 1.0f;
+
+		ga_capsule capsule;
+		capsule._point_a = { 0.0f, -1.0f, 0.0f };
+		capsule._point_b = { 0.0f, 1.0f, 0.0f };
+		capsule._radius = 0.5f;
+
+		ga_mat4f trans;
+		trans.make_identity();
+
+		float dist;
+		assert(ga_intersect_ray({ 10, 0, 0 }, { -1, 0, 0 }, &sphere, trans, &dist));
+		assert(ga_equalf(dist, 9.0f));
+		assert(!ga_intersect_ray({ 10, 0, 0 }, { 1, 0, 0 }, &sphere, trans, &dist));
+		assert(!ga_intersect_ray({ 10, 2, 0 }, { -1, 0, 0 }, &sphere, trans, &dist));
+
+		// Side of the cylinder, then the top cap.
+		assert(ga_intersect_ray({ 10, 0.5f, 0 }, { -1, 0, 0 }, &capsule, trans, &dist));
+		assert(ga_equalf(dist, 9.5f));
+		assert(ga_intersect_ray({ 0, 10, 0 }, { 0, -1, 0 }, &capsule, trans, &dist));
+		assert(ga_equalf(dist, 8.5f));
+		assert(!ga_intersect_ray({ 10, 1.6f, 0 }, { -1, 0, 0 }, &capsule, trans, &dist));
+	}
+
+	// Test sphere sweeps and point containment.
+	{
+		ga_plane plane;
+		plane._point = { 0.0f, 0.0f, 0.0f };
+		plane._normal = { 0.0f, 1.0f, 0.0f };
+
+		ga_capsule capsule;
+		capsule._point_a = { 0.0f, -1.0f, 0.0f };
+		capsule._point_b = { 0.0f, 1.0f, 0.0f };
+		capsule._radius = 0.5f;
+
+		ga_oobb oobb;
+		oobb._half_vectors[0] = { 1.0f, 0.0f, 0.0f };
+		oobb._half_vectors[1] = { 0.0f, 1.0f, 0.0f };
+		oobb._half_vectors[2] = { 0.0f, 0.0f, 1.0f };
+
+		ga_mat4f trans;
+		trans.make_identity();
+
+		float dist;
+
+		// Box face, edge and corner.
+		assert(ga_sweep_sphere({ 10, 0, 0 }, { -1, 0, 0 }, 0.5f, &oobb, trans, &dist));
+		assert(ga_equalf(dist, 8.5f));
+		assert(ga_sweep_sphere({ 10, 1.3f, 0 }, { -1, 0, 0 }, 0.5f, &oobb, trans, &dist));
+		assert(ga_absf(dist - (9.0f - ga_sqrtf(0.25f - 0.09f))) < 0.0001f);
+		assert(ga_sweep_sphere({ 10, 1.3f, 1.3f }, { -1, 0, 0 }, 0.5f, &oobb, trans, &dist));
+		assert(ga_absf(dist - (9.0f - ga_sqrtf(0.25f - 0.18f))) < 0.0001f);
+		assert(!ga_sweep_sphere({ 10, 1.4f, 1.4f }, { -1, 0, 0 }, 0.5f, &oobb, trans, &dist));
+		assert(!ga_sweep_sphere({ 10, 0, 0 }, { 1, 0, 0 }, 0.5f, &oobb, trans, &dist));
+
+		// Starting in contact hits immediately.
+		assert(ga_sweep_sphere({ 1.2f, 0, 0 }, { 1, 0, 0 }, 0.5f, &oobb, trans, &dist));
+		assert(dist == 0.0f);
+
+		assert(ga_sweep_sphere({ 3, 5, 0 }, { 0, -1, 0 }, 1.0f, &plane, trans, &dist));
+		assert(ga_equalf(dist, 4.0f));
+		assert(!ga_sweep_sphere({ 3, 5, 0 }, { 0, 1, 0 }, 1.0f, &plane, trans, &dist));
+
+		assert(ga_sweep_sphere({ 10, 0.5f, 0 }, { -1, 0, 0 }, 0.25f, &capsule, trans, &dist));
+		assert(ga_equalf(dist, 9.25f));
+
+		assert(ga_point_in_shape({ 0.9f, -0.9f, 0.9f }, &oobb, trans));
+		assert(!ga_point_in_shape({ 1.1f, 0.0f, 0.0f }, &oobb, trans));
+		assert(ga_point_in_shape({ 4.0f, -0.1f, 0.0f }, &plane, trans));
+		assert(!ga_point_in_shape({ 4.0f, 0.1f, 0.0f }, &plane, trans));
+		assert(ga_point_in_shape({ 0.0f, 1.4f, 0.0f }, &capsule, trans));
+		assert(!ga_point_in_shape({ 0.4f, 1.4f, 0.0f }, &capsule, trans));
+	}
 }
@@ -0,0 +1,83 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_mesh_export.h"
+#include "ga_shape.h"
+
+static void export_box_mesh(const ga_oobb* box, const ga_mat4f& transform, const ga_rigid_body* body,
+	ga_mesh_export* out)
+{
+	ga_vec3f center = transform.transform_point(box->_center);
+	ga_vec3f half_vectors[3];
+	ga_vec3f axes[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		half_vectors[i] = transform.transform_vector(box->_half_vectors[i]);
+		axes[i] = half_vectors[i].normal();
+	}
+
+	// The half vectors needn't be perpendicular, so each face normal is taken across
+	// the two half vectors spanning the face, and turned to point the third's way.
+	ga_vec3f face_normals[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		face_normals[i] = ga_vec3f_cross(half_vectors[(i + 1) % 3], half_vectors[(i + 2) % 3]).normal();
+		if (face_normals[i].dot(half_vectors[i]) < 0.0f)
+		{
+			face_normals[i] = -face_normals[i];
+		}
+	}
+
+	// Corner index bits 2, 1 and 0 are the signs of the x, y and z half vectors.
+	ga_vec3f corners[8];
+	box->get_corners(corners);
+	for (int c = 0; c < 8; ++c)
+	{
+		corners[c] = transform.transform_point(corners[c]);
+
+		ga_mesh_corner corner;
+		corner._position = corners[c];
+		corner._outward = (corners[c] - center).normal();
+		corner._axes[0] = axes[0];
+		corner._axes[1] = axes[1];
+		corner._axes[2] = axes[2];
+		corner._body = body;
+		out->_corners.push_back(corner);
+	}
+
+	// Four edges run along each axis, one per sign combination of the other two.
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		int axis_bit = 4 >> axis;
+		int other_a = (axis + 1) % 3;
+		int other_b = (axis + 2) % 3;
+		for (int c = 0; c < 8; ++c)
+		{
+			if (c & axis_bit) continue;
+
+			ga_mesh_edge edge;
+			edge._start = corners[c];
+			edge._end = corners[c | axis_bit];
+			edge._face_normals[0] = (c & (4 >> other_a)) ? face_normals[other_a] : -face_normals[other_a];
+			edge._face_normals[1] = (c & (4 >> other_b)) ? face_normals[other_b] : -face_normals[other_b];
+			edge._outward = (edge._face_normals[0] + edge._face_normals[1]).normal();
+			edge._body = body;
+			out->_edges.push_back(edge);
+		}
+	}
+}
+
+void ga_export_shape_mesh(const ga_shape* shape, const ga_mat4f& transform, const ga_rigid_body* body,
+	ga_mesh_export* out)
+{
+	if (shape->get_type() == k_shape_oobb)
+	{
+		export_box_mesh(static_cast<const ga_oobb*>(shape), transform, body, out);
+	}
+}
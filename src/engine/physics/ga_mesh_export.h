@@ -0,0 +1,71 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_mat4f.h"
+#include "math/ga_vec3f.h"
+
+#include <vector>
+
+class ga_rigid_body;
+struct ga_shape;
+
+/*
+** A box corner in world space.
+*/
+struct ga_mesh_corner
+{
+	ga_vec3f _position;
+
+	// Unit direction from the box's center out through the corner. Step along it to
+	// get off the mesh.
+	ga_vec3f _outward;
+
+	// Unit directions of the box's three half vectors.
+	ga_vec3f _axes[3];
+
+	const ga_rigid_body* _body;
+};
+
+/*
+** A box edge in world space.
+*/
+struct ga_mesh_edge
+{
+	ga_vec3f _start;
+	ga_vec3f _end;
+
+	// Outward normals of the two faces that meet at the edge.
+	ga_vec3f _face_normals[2];
+
+	// Unit direction away from the mesh, halfway between the face normals.
+	ga_vec3f _outward;
+
+	const ga_rigid_body* _body;
+};
+
+/*
+** Corners and edges of collision geometry, for systems that reason about the shape
+** of the level rather than collide with it: sound propagation, navigation,
+** diffraction. See ga_physics_world::get_static_mesh_export.
+*/
+struct ga_mesh_export
+{
+	std::vector<ga_mesh_corner> _corners;
+	std::vector<ga_mesh_edge> _edges;
+};
+
+/*
+** Append the shape's corners and edges, placed by the transform. Boxes have eight
+** corners and twelve edges; planes, spheres and capsules have none.
+** Corners are in ga_oobb::get_corners order.
+*/
+void ga_export_shape_mesh(const ga_shape* shape, const ga_mat4f& transform, const ga_rigid_body* body,
+	ga_mesh_export* out);
@@ -12,27 +12,36 @@
 #include "ga_rigid_body.h"
 
 #include "entity/ga_entity.h"
+#include "framework/ga_frame_params.h"
 
 //#define GA_PHYSICS_DEBUG_DRAW
 
-ga_physics_component::ga_physics_component(ga_entity* ent, ga_shape* shape, float mass)
-	: ga_component(ent)
+ga_physics_component::ga_physics_component(ga_entity* ent, ga_physics_world* world, ga_shape* shape, float mass)
+	: ga_component(ent), _world(world)
 {
-	_body = new ga_rigid_body(shape, mass);
-	_body->_transform = ent->get_transform();
+	_body = world->create_rigid_body(shape, mass);
+	_body->set_transform(ent->get_transform());
+	_synced_transform = ent->get_transform();
+	world->add_rigid_body(_body);
 }
 
 ga_physics_component::~ga_physics_component()
 {
-	delete _body;
+	_world->destroy_rigid_body(_body);
 }
 
 void ga_physics_component::update(ga_frame_params* params)
 {
-	// First, re-sync the rigid body's transform with the entity's.
-	_body->_transform = get_entity()->get_transform();
-
-#if GA_PHYSICS_DEBUG_DRAW
+	// First, re-sync the rigid body's transform with the entity's if something else moved
+	// the entity. Otherwise the entity holds an interpolated transform, which must not be
+	// fed back into the simulation.
+	ga_mat4f entity_transform = get_entity()->get_transform();
+	if (!entity_transform.equal(_synced_transform))
+	{
+		_body->set_transform(entity_transform);
+	}
+
+#if defined(GA_PHYSICS_DEBUG_DRAW) && !defined(GA_HEADLESS)
 	ga_dynamic_drawcall draw;
 	_body->get_debug_draw(&draw);
 
@@ -45,5 +54,6 @@ void ga_physics_component::update(ga_frame_params* params)
 void ga_physics_component::late_update(ga_frame_params* params)
 {
 	// Sync the entity's transform with the rigid body's.
-	get_entity()->set_transform(_body->_transform);
+	_synced_transform = _body->get_interpolated_transform(params->_physics_interpolation);
+	get_entity()->set_transform(_synced_transform);
 }
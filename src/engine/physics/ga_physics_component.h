@@ -10,15 +10,18 @@
 */
 
 #include "entity/ga_component.h"
+#include "math/ga_mat4f.h"
 
 /*
 ** A component that adds physics simulation to an entity.
-** Owns a rigid body and synchronizes its transform and that of the entity.
+** Owns a rigid body in the world's pool, added to the world for as long as the
+** component lives, and synchronizes its transform and that of the entity.
+** The entity is given the body's transform interpolated between physics steps.
 */
 class ga_physics_component : public ga_component
 {
 public:
-	ga_physics_component(class ga_entity* ent, struct ga_shape* shape, float mass);
+	ga_physics_component(class ga_entity* ent, class ga_physics_world* world, struct ga_shape* shape, float mass);
 	virtual ~ga_physics_component();
 
 	virtual void update(struct ga_frame_params* params) override;
@@ -27,5 +30,9 @@ public:
 	class ga_rigid_body* get_rigid_body() const { return _body; }
 
 private:
+	class ga_physics_world* _world;
 	class ga_rigid_body* _body;
+
+	// The transform last written to the entity, used to detect outside moves.
+	ga_mat4f _synced_transform;
 };
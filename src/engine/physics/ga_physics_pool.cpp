@@ -0,0 +1,31 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_physics_pool.h"
+
+void ga_physics_allocator::destroy_shape(ga_shape* shape)
+{
+	switch (shape->get_type())
+	{
+	case k_shape_plane: _planes.destroy(static_cast<ga_plane*>(shape)); break;
+	case k_shape_oobb: _oobbs.destroy(static_cast<ga_oobb*>(shape)); break;
+	case k_shape_sphere: _spheres.destroy(static_cast<ga_sphere*>(shape)); break;
+	case k_shape_capsule: _capsules.destroy(static_cast<ga_capsule*>(shape)); break;
+	default: assert(false);
+	}
+}
+
+void ga_physics_allocator::clear()
+{
+	_bodies.clear();
+	_planes.clear();
+	_oobbs.clear();
+	_spheres.clear();
+	_capsules.clear();
+}
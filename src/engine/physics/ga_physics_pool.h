@@ -0,0 +1,246 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_rigid_body.h"
+#include "ga_shape.h"
+
+#include <assert.h>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+/*
+** Refers to an object in a pool. A handle goes stale when its object is destroyed,
+** even if the slot is reused for another.
+*/
+struct ga_physics_handle
+{
+	uint32_t _index;
+	uint32_t _generation;
+};
+
+/*
+** A pool of objects of one type, kept in fixed size slabs aligned to cache lines.
+**
+** Objects never move once created, so pointers to them stay valid until they're
+** destroyed. Each slot keeps its index next to its object, so finding an object's
+** slot costs nothing. Freed slots are recycled most recent first, and a new slab is
+** only allocated once every slot is in use. Not thread safe.
+*/
+template<typename T, int k_slab_size = 256>
+class ga_physics_pool
+{
+public:
+	ga_physics_pool() {}
+	~ga_physics_pool()
+	{
+		clear();
+		for (int i = 0; i < int(_slabs.size()); ++i)
+		{
+			delete[] _slabs[i]._memory;
+		}
+	}
+
+	ga_physics_pool(const ga_physics_pool&) = delete;
+	ga_physics_pool& operator=(const ga_physics_pool&) = delete;
+
+	template<typename... Args>
+	T* create(Args&&... args)
+	{
+		if (_free.empty())
+		{
+			add_slab();
+		}
+
+		uint32_t index = _free.back();
+		_free.pop_back();
+		_live[index] = 1;
+		++_live_count;
+
+		slot* new_slot = get_slot_of(index);
+		new_slot->_index = index;
+		return new (&new_slot->_object) T(std::forward<Args>(args)...);
+	}
+
+	void destroy(T* object)
+	{
+		uint32_t index = get_index(object);
+		assert(_live[index]);
+
+		object->~T();
+		_live[index] = 0;
+		++_generations[index];
+		--_live_count;
+		_free.push_back(index);
+	}
+
+	/*
+	** Destroy every live object. The slabs are kept for reuse.
+	*/
+	void clear()
+	{
+		for (uint32_t i = 0; i < uint32_t(_live.size()); ++i)
+		{
+			if (_live[i])
+			{
+				destroy(get_slot(i));
+			}
+		}
+	}
+
+	ga_physics_handle get_handle(const T* object) const
+	{
+		uint32_t index = get_index(object);
+		return { index, _generations[index] };
+	}
+
+	/*
+	** The object a handle refers to, or null if the handle is stale.
+	*/
+	T* get(ga_physics_handle handle) const
+	{
+		if (handle._index >= _live.size() || !_live[handle._index] || _generations[handle._index] != handle._generation)
+		{
+			return nullptr;
+		}
+		return get_slot(handle._index);
+	}
+
+	/*
+	** Call func on every live object, in memory order.
+	*/
+	template<typename F>
+	void for_each(F func)
+	{
+		for (uint32_t i = 0; i < uint32_t(_live.size()); ++i)
+		{
+			if (_live[i])
+			{
+				func(get_slot(i));
+			}
+		}
+	}
+
+	int get_live_count() const { return _live_count; }
+	int get_capacity() const { return int(_slabs.size()) * k_slab_size; }
+
+private:
+	static const size_t k_slab_alignment = 64;
+	static_assert(alignof(T) <= k_slab_alignment, "Pooled type needs more than cache line alignment");
+
+	// The object comes first, so a pointer to it is a pointer to its slot.
+	struct slot
+	{
+		union
+		{
+			T _object;
+		};
+		uint32_t _index;
+
+		slot() {}
+		~slot() {}
+	};
+
+	struct slab
+	{
+		uint8_t* _memory;
+		slot* _slots;
+	};
+
+	std::vector<slab> _slabs;
+	std::vector<uint32_t> _generations;
+	std::vector<uint8_t> _live;
+	std::vector<uint32_t> _free;
+	int _live_count = 0;
+
+	void add_slab()
+	{
+		slab new_slab;
+		new_slab._memory = new uint8_t[sizeof(slot) * k_slab_size + k_slab_alignment - 1];
+		uintptr_t aligned = (uintptr_t(new_slab._memory) + k_slab_alignment - 1) & ~uintptr_t(k_slab_alignment - 1);
+		new_slab._slots = reinterpret_cast<slot*>(aligned);
+
+		uint32_t first = uint32_t(_slabs.size()) * k_slab_size;
+		_slabs.push_back(new_slab);
+		_generations.resize(first + k_slab_size, 0);
+		_live.resize(first + k_slab_size, 0);
+
+		// Pushed in reverse so slots are handed out in address order.
+		for (int i = k_slab_size - 1; i >= 0; --i)
+		{
+			_free.push_back(first + i);
+		}
+	}
+
+	slot* get_slot_of(uint32_t index) const
+	{
+		return _slabs[index / k_slab_size]._slots + index % k_slab_size;
+	}
+
+	T* get_slot(uint32_t index) const
+	{
+		return &get_slot_of(index)->_object;
+	}
+
+	uint32_t get_index(const T* object) const
+	{
+		uint32_t index = reinterpret_cast<const slot*>(object)->_index;
+		assert(index < _live.size() && get_slot(index) == object);
+		return index;
+	}
+};
+
+/*
+** Pools for rigid bodies and each shape type.
+**
+** Owners of many shapes, such as level geometry, create them here instead of on the
+** heap one at a time. Bodies meant for a world come from the world's own pool; this
+** one is for bodies kept outside any world. Destroying the allocator destroys
+** everything still in it.
+*/
+class ga_physics_allocator
+{
+public:
+	ga_rigid_body* create_rigid_body(ga_shape* shape, float mass) { return _bodies.create(shape, mass); }
+	void destroy_rigid_body(ga_rigid_body* body) { _bodies.destroy(body); }
+
+	ga_physics_handle get_handle(const ga_rigid_body* body) const { return _bodies.get_handle(body); }
+	ga_rigid_body* get_rigid_body(ga_physics_handle handle) const { return _bodies.get(handle); }
+
+	/*
+	** Create a copy of the shape.
+	*/
+	template<typename T>
+	T* create_shape(const T& shape) { return get_shape_pool<T>().create(shape); }
+	void destroy_shape(ga_shape* shape);
+
+	int get_rigid_body_count() const { return _bodies.get_live_count(); }
+
+	/*
+	** Destroy every body, then every shape.
+	*/
+	void clear();
+
+private:
+	ga_physics_pool<ga_rigid_body> _bodies;
+	ga_physics_pool<ga_plane> _planes;
+	ga_physics_pool<ga_oobb> _oobbs;
+	ga_physics_pool<ga_sphere> _spheres;
+	ga_physics_pool<ga_capsule> _capsules;
+
+	template<typename T> ga_physics_pool<T>& get_shape_pool();
+};
+
+template<> inline ga_physics_pool<ga_plane>& ga_physics_allocator::get_shape_pool<ga_plane>() { return _planes; }
+template<> inline ga_physics_pool<ga_oobb>& ga_physics_allocator::get_shape_pool<ga_oobb>() { return _oobbs; }
+template<> inline ga_physics_pool<ga_sphere>& ga_physics_allocator::get_shape_pool<ga_sphere>() { return _spheres; }
+template<> inline ga_physics_pool<ga_capsule>& ga_physics_allocator::get_shape_pool<ga_capsule>() { return _capsules; }
@@ -0,0 +1,391 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_physics_recording.h"
+#include "ga_rigid_body.h"
+#include "ga_shape.h"
+
+#include "framework/ga_frame_params.h"
+
+#include <assert.h>
+#include <cstdio>
+#include <cstring>
+
+static const uint32_t k_recording_magic = 0x52504147; // "GAPR"
+static const uint32_t k_recording_version = 1;
+
+template<typename T>
+static bool write_array(FILE* file, const std::vector<T>& array)
+{
+	uint32_t count = uint32_t(array.size());
+	if (fwrite(&count, sizeof(count), 1, file) != 1) return false;
+	return count == 0 || fwrite(array.data(), sizeof(T), count, file) == count;
+}
+
+template<typename T>
+static bool read_array(FILE* file, std::vector<T>& array)
+{
+	uint32_t count;
+	if (fread(&count, sizeof(count), 1, file) != 1) return false;
+	array.resize(count);
+	return count == 0 || fread(array.data(), sizeof(T), count, file) == count;
+}
+
+// Shapes are stored as their type and up to twelve floats of parameters.
+static void write_shape(const ga_shape* shape, uint32_t* type, float data[12])
+{
+	*type = shape->get_type();
+	memset(data, 0, sizeof(float) * 12);
+	switch (shape->get_type())
+	{
+	case k_shape_plane:
+	{
+		const ga_plane* plane = static_cast<const ga_plane*>(shape);
+		memcpy(data + 0, plane->_point.axes, sizeof(float) * 3);
+		memcpy(data + 3, plane->_normal.axes, sizeof(float) * 3);
+		break;
+	}
+	case k_shape_oobb:
+	{
+		const ga_oobb* oobb = static_cast<const ga_oobb*>(shape);
+		memcpy(data + 0, oobb->_center.axes, sizeof(float) * 3);
+		for (int i = 0; i < 3; ++i)
+		{
+			memcpy(data + 3 + i * 3, oobb->_half_vectors[i].axes, sizeof(float) * 3);
+		}
+		break;
+	}
+	case k_shape_sphere:
+	{
+		const ga_sphere* sphere = static_cast<const ga_sphere*>(shape);
+		memcpy(data + 0, sphere->_center.axes, sizeof(float) * 3);
+		data[3] = sphere->_radius;
+		break;
+	}
+	case k_shape_capsule:
+	{
+		const ga_capsule* capsule = static_cast<const ga_capsule*>(shape);
+		memcpy(data + 0, capsule->_point_a.axes, sizeof(float) * 3);
+		memcpy(data + 3, capsule->_point_b.axes, sizeof(float) * 3);
+		data[6] = capsule->_radius;
+		break;
+	}
+	default:
+		assert(false);
+	}
+}
+
+ga_physics_recording::ga_physics_recording()
+{
+	memset(&_world, 0, sizeof(_world));
+	memset(&_last_force_fields, 0, sizeof(_last_force_fields));
+}
+
+ga_physics_recording::~ga_physics_recording()
+{
+	destroy_replay_bodies();
+}
+
+bool ga_physics_recording::save(const char* path) const
+{
+	FILE* file = fopen(path, "wb");
+	if (!file) return false;
+
+	bool ok = fwrite(&k_recording_magic, sizeof(k_recording_magic), 1, file) == 1 &&
+		fwrite(&k_recording_version, sizeof(k_recording_version), 1, file) == 1 &&
+		fwrite(&_world, sizeof(_world), 1, file) == 1 &&
+		write_array(file, _bodies) &&
+		write_array(file, _steps) &&
+		write_array(file, _inputs) &&
+		write_array(file, _force_fields) &&
+		write_array(file, _final_states);
+
+	ok = fclose(file) == 0 && ok;
+	return ok;
+}
+
+bool ga_physics_recording::load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file) return false;
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	bool ok = fread(&magic, sizeof(magic), 1, file) == 1 && magic == k_recording_magic &&
+		fread(&version, sizeof(version), 1, file) == 1 && version == k_recording_version &&
+		fread(&_world, sizeof(_world), 1, file) == 1 &&
+		read_array(file, _bodies) &&
+		read_array(file, _steps) &&
+		read_array(file, _inputs) &&
+		read_array(file, _force_fields) &&
+		read_array(file, _final_states);
+	fclose(file);
+
+	// Reject logs whose steps point outside the stored inputs.
+	for (int i = 0; ok && i < _steps.size(); ++i)
+	{
+		const step_desc& step = _steps[i];
+		ok = uint64_t(step._first_input) + step._input_count <= _inputs.size() &&
+			step._force_fields < int32_t(_force_fields.size());
+		for (uint32_t j = 0; ok && j < step._input_count; ++j)
+		{
+			ok = _inputs[step._first_input + j]._body < _bodies.size();
+		}
+	}
+	for (int i = 0; ok && i < _bodies.size(); ++i)
+	{
+		ok = _bodies[i]._shape_type < k_shape_count;
+	}
+	return ok && _final_states.size() == _bodies.size();
+}
+
+void ga_physics_recording::begin_replay(ga_physics_world* world)
+{
+	assert(world->_bodies.empty());
+	destroy_replay_bodies();
+
+	world->_fixed_timestep = _world._fixed_timestep;
+	world->_max_substeps = _world._max_substeps;
+	world->_time_accumulator = _world._time_accumulator;
+	world->_solver_iterations = _world._solver_iterations;
+	world->_step_index = _world._step_index;
+	world->_contacts.clear();
+
+	for (int i = 0; i < _bodies.size(); ++i)
+	{
+		const body_desc& desc = _bodies[i];
+		ga_shape* shape = create_replay_shape(desc._shape_type, desc._shape_data);
+		ga_rigid_body* body = world->create_rigid_body(shape, desc._mass);
+		body->_coefficient_of_restitution = desc._coefficient_of_restitution;
+		write_state(desc._state, body);
+		world->add_rigid_body(body);
+
+		_replay_bodies.push_back(body);
+	}
+}
+
+void ga_physics_recording::replay_step(ga_physics_world* world, int step)
+{
+	const step_desc& desc = _steps[step];
+
+	for (uint32_t i = 0; i < desc._input_count; ++i)
+	{
+		const body_input& input = _inputs[desc._first_input + i];
+		write_state(input._state, _replay_bodies[input._body]);
+	}
+
+	if (desc._force_fields >= 0)
+	{
+		const force_fields& fields = _force_fields[desc._force_fields];
+		for (int i = 0; i < ga_physics_world::k_max_force_fields; ++i)
+		{
+			world->_force_fields[i] = fields._fields[i];
+			world->_force_field_used[i] = fields._used[i] != 0;
+		}
+	}
+
+	ga_frame_params params;
+	params._delta_time = std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+		std::chrono::nanoseconds(desc._delta_time_ns));
+	params._single_step = desc._single_step != 0;
+	world->step(&params);
+}
+
+bool ga_physics_recording::verify_replay() const
+{
+	if (_replay_bodies.size() != _final_states.size()) return false;
+
+	for (int i = 0; i < _replay_bodies.size(); ++i)
+	{
+		body_state state;
+		read_state(_replay_bodies[i], &state);
+		if (!states_equal(state, _final_states[i])) return false;
+	}
+	return true;
+}
+
+void ga_physics_recording::start(const ga_physics_world* world)
+{
+	_world._fixed_timestep = world->_fixed_timestep;
+	_world._max_substeps = world->_max_substeps;
+	_world._time_accumulator = world->_time_accumulator;
+	_world._solver_iterations = world->_solver_iterations;
+	_world._step_index = world->_step_index;
+
+	_bodies.resize(world->_bodies.size());
+	_last_states.resize(world->_bodies.size());
+	for (int i = 0; i < world->_bodies.size(); ++i)
+	{
+		const ga_rigid_body* body = world->_bodies[i];
+		body_desc& desc = _bodies[i];
+		write_shape(body->_shape, &desc._shape_type, desc._shape_data);
+		desc._mass = body->_mass;
+		desc._coefficient_of_restitution = body->_coefficient_of_restitution;
+		read_state(body, &desc._state);
+		_last_states[i] = desc._state;
+	}
+
+	read_force_fields(world, &_last_force_fields);
+	_force_fields.clear();
+	_force_fields.push_back(_last_force_fields);
+
+	_steps.clear();
+	_inputs.clear();
+	_final_states.clear();
+}
+
+void ga_physics_recording::record_step(const ga_physics_world* world, const ga_frame_params* params)
+{
+	step_desc step;
+	step._delta_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(params->_delta_time).count();
+	step._single_step = params->_single_step ? 1 : 0;
+	step._first_input = uint32_t(_inputs.size());
+	step._input_count = 0;
+	step._force_fields = -1;
+
+	force_fields fields;
+	read_force_fields(world, &fields);
+	bool fields_changed = memcmp(&fields, &_last_force_fields, sizeof(fields)) != 0;
+	if (fields_changed)
+	{
+		_force_fields.push_back(fields);
+		_last_force_fields = fields;
+	}
+
+	// The first step always sets the fields, so replay doesn't depend on the defaults.
+	if (fields_changed || _steps.empty())
+	{
+		step._force_fields = int32_t(_force_fields.size()) - 1;
+	}
+
+	for (int i = 0; i < world->_bodies.size(); ++i)
+	{
+		body_input input;
+		input._body = uint32_t(i);
+		read_state(world->_bodies[i], &input._state);
+		if (!states_equal(input._state, _last_states[i]))
+		{
+			_inputs.push_back(input);
+			++step._input_count;
+		}
+	}
+
+	_steps.push_back(step);
+}
+
+void ga_physics_recording::end_step(const ga_physics_world* world)
+{
+	for (int i = 0; i < world->_bodies.size(); ++i)
+	{
+		read_state(world->_bodies[i], &_last_states[i]);
+	}
+}
+
+void ga_physics_recording::stop(const ga_physics_world* world)
+{
+	_final_states.resize(world->_bodies.size());
+	for (int i = 0; i < world->_bodies.size(); ++i)
+	{
+		read_state(world->_bodies[i], &_final_states[i]);
+	}
+	_last_states.clear();
+}
+
+void ga_physics_recording::destroy_replay_bodies()
+{
+	_replay_allocator.clear();
+	_replay_bodies.clear();
+}
+
+ga_shape* ga_physics_recording::create_replay_shape(uint32_t type, const float data[12])
+{
+	switch (type)
+	{
+	case k_shape_plane:
+	{
+		ga_plane plane;
+		memcpy(plane._point.axes, data + 0, sizeof(float) * 3);
+		memcpy(plane._normal.axes, data + 3, sizeof(float) * 3);
+		return _replay_allocator.create_shape(plane);
+	}
+	case k_shape_oobb:
+	{
+		ga_oobb oobb;
+		memcpy(oobb._center.axes, data + 0, sizeof(float) * 3);
+		for (int i = 0; i < 3; ++i)
+		{
+			memcpy(oobb._half_vectors[i].axes, data + 3 + i * 3, sizeof(float) * 3);
+		}
+		return _replay_allocator.create_shape(oobb);
+	}
+	case k_shape_sphere:
+	{
+		ga_sphere sphere;
+		memcpy(sphere._center.axes, data + 0, sizeof(float) * 3);
+		sphere._radius = data[3];
+		return _replay_allocator.create_shape(sphere);
+	}
+	case k_shape_capsule:
+	{
+		ga_capsule capsule;
+		memcpy(capsule._point_a.axes, data + 0, sizeof(float) * 3);
+		memcpy(capsule._point_b.axes, data + 3, sizeof(float) * 3);
+		capsule._radius = data[6];
+		return _replay_allocator.create_shape(capsule);
+	}
+	default:
+		assert(false);
+		return nullptr;
+	}
+}
+
+void ga_physics_recording::read_state(const ga_rigid_body* body, body_state* state)
+{
+	// Cleared first so padding compares and saves consistently.
+	memset(state, 0, sizeof(*state));
+	state->_transform = body->_transform;
+	state->_velocity = body->_velocity;
+	state->_angular_momentum = body->_angular_momentum;
+	state->_angular_velocity = body->_angular_velocity;
+	state->_force_accumulator = body->_force_accumulator;
+	state->_torque_accumulator = body->_torque_accumulator;
+	state->_flags = body->_flags;
+	state->_sleep_timer = body->_sleep_timer;
+}
+
+void ga_physics_recording::write_state(const body_state& state, ga_rigid_body* body)
+{
+	body->set_transform(state._transform);
+	body->_velocity = state._velocity;
+	body->_angular_momentum = state._angular_momentum;
+	body->_angular_velocity = state._angular_velocity;
+	body->_force_accumulator = state._force_accumulator;
+	body->_torque_accumulator = state._torque_accumulator;
+	body->_flags = state._flags;
+	body->_sleep_timer = state._sleep_timer;
+}
+
+bool ga_physics_recording::states_equal(const body_state& a, const body_state& b)
+{
+	// Compared bitwise: a replay has to match exactly, not approximately.
+	return memcmp(&a, &b, sizeof(body_state)) == 0;
+}
+
+void ga_physics_recording::read_force_fields(const ga_physics_world* world, force_fields* fields)
+{
+	memset(fields, 0, sizeof(*fields));
+	for (int i = 0; i < ga_physics_world::k_max_force_fields; ++i)
+	{
+		fields->_used[i] = world->_force_field_used[i] ? 1 : 0;
+		if (world->_force_field_used[i])
+		{
+			fields->_fields[i] = world->_force_fields[i];
+		}
+	}
+}
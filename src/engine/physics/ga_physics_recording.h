@@ -0,0 +1,155 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_physics_pool.h"
+#include "ga_physics_world.h"
+
+#include "math/ga_mat4f.h"
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+#include <vector>
+
+class ga_rigid_body;
+struct ga_frame_params;
+struct ga_shape;
+
+/*
+** A captured physics workload, for reproducing and benchmarking it outside the game.
+**
+** Recording stores the world's settings and every body as they were when it started,
+** then the inputs to each step: the frame time, and the state of any body that was
+** changed from outside the world since the previous step (velocities and forces
+** added, teleports, wakes). The bodies' state when recording stops is kept too.
+**
+** Replaying into an empty world rebuilds the bodies and feeds the same inputs back
+** to the same sequence of steps, which reproduces the recorded run bit for bit.
+** See tools/ga_physics_replay.cpp.
+*/
+class ga_physics_recording
+{
+public:
+	ga_physics_recording();
+	~ga_physics_recording();
+
+	/*
+	** Read or write the recording as a binary log. Return false on failure.
+	*/
+	bool save(const char* path) const;
+	bool load(const char* path);
+
+	int get_body_count() const { return int(_bodies.size()); }
+	int get_step_count() const { return int(_steps.size()); }
+
+	/*
+	** Recreate the recorded world in an empty one: its settings, then its bodies in
+	** the same order. The bodies are made in the world's pool. The recording owns
+	** their shapes until the next begin_replay or its destruction, so remove the
+	** bodies from the world before either.
+	*/
+	void begin_replay(ga_physics_world* world);
+
+	/*
+	** Apply the inputs recorded for a step, then step the world.
+	*/
+	void replay_step(ga_physics_world* world, int step);
+
+	/*
+	** Whether the replayed bodies exactly match the state recorded at the end.
+	** Call after replaying every step.
+	*/
+	bool verify_replay() const;
+
+private:
+	// Everything about a body that stepping reads or external code can change.
+	struct body_state
+	{
+		ga_mat4f _transform;
+		ga_vec3f _velocity;
+		ga_vec3f _angular_momentum;
+		ga_vec3f _angular_velocity;
+		ga_vec3f _force_accumulator;
+		ga_vec3f _torque_accumulator;
+		uint32_t _flags;
+		float _sleep_timer;
+	};
+
+	struct body_desc
+	{
+		uint32_t _shape_type;
+		float _shape_data[12];
+		float _mass;
+		float _coefficient_of_restitution;
+		body_state _state;
+	};
+
+	struct body_input
+	{
+		uint32_t _body;
+		body_state _state;
+	};
+
+	struct force_fields
+	{
+		ga_force_field _fields[ga_physics_world::k_max_force_fields];
+		uint8_t _used[ga_physics_world::k_max_force_fields];
+	};
+
+	struct step_desc
+	{
+		int64_t _delta_time_ns;
+		uint32_t _single_step;
+		uint32_t _first_input;
+		uint32_t _input_count;
+		// Index of the force fields set at this step, or -1 if unchanged.
+		int32_t _force_fields;
+	};
+
+	struct world_desc
+	{
+		float _fixed_timestep;
+		int32_t _max_substeps;
+		float _time_accumulator;
+		int32_t _solver_iterations;
+		uint32_t _step_index;
+	};
+
+	world_desc _world;
+	std::vector<body_desc> _bodies;
+	std::vector<step_desc> _steps;
+	std::vector<body_input> _inputs;
+	std::vector<force_fields> _force_fields;
+	std::vector<body_state> _final_states;
+
+	// Body state after the last recorded step, to spot changes made between steps.
+	std::vector<body_state> _last_states;
+	force_fields _last_force_fields;
+
+	// Shapes created by begin_replay, and its bodies in recorded order.
+	ga_physics_allocator _replay_allocator;
+	std::vector<ga_rigid_body*> _replay_bodies;
+
+	// Called by the world while it holds its bodies lock.
+	void start(const ga_physics_world* world);
+	void record_step(const ga_physics_world* world, const ga_frame_params* params);
+	void end_step(const ga_physics_world* world);
+	void stop(const ga_physics_world* world);
+
+	void destroy_replay_bodies();
+	ga_shape* create_replay_shape(uint32_t type, const float data[12]);
+
+	static void read_state(const ga_rigid_body* body, body_state* state);
+	static void write_state(const body_state& state, ga_rigid_body* body);
+	static bool states_equal(const body_state& a, const body_state& b);
+	static void read_force_fields(const ga_physics_world* world, force_fields* fields);
+
+	friend class ga_physics_world;
+};
@@ -0,0 +1,208 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_physics_snapshot.h"
+#include "ga_shape.h"
+#include "ga_shape_dispatch.h"
+
+#include "math/ga_math.h"
+
+#include <float.h>
+
+/*
+** True if the ray enters the sphere before max_dist (or starts inside it).
+*/
+static bool ray_reaches_bounding_sphere(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
+	const ga_vec3f& center, float radius, float max_dist)
+{
+	if (radius == FLT_MAX) return true;
+
+	ga_vec3f m = ray_origin - center;
+	float c = m.dot(m) - radius * radius;
+	if (c <= 0.0f) return true;
+
+	float a = ray_dir.dot(ray_dir);
+	float b = m.dot(ray_dir);
+	if (b > 0.0f) return false;
+
+	float discriminant = b * b - a * c;
+	if (discriminant < 0.0f) return false;
+
+	return (-b - ga_sqrtf(discriminant)) / a < max_dist;
+}
+
+static bool bounds_reach_sphere(const ga_bounding_sphere& bounds, const ga_vec3f& center, float radius)
+{
+	if (bounds._radius == FLT_MAX) return true;
+
+	float total_radius = bounds._radius + radius;
+	return (bounds._center - center).mag2() <= total_radius * total_radius;
+}
+
+bool ga_physics_snapshot::raycast_all(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
+	std::vector<ga_raycast_hit_info>* hit_info, float max_dist) const
+{
+	bool hit = false;
+	for (int i = 0; i < _colliders.size(); ++i)
+	{
+		const ga_collider_snapshot& collider = _colliders[i];
+
+		// Cheap bounding sphere reject before the exact test.
+		if (!ray_reaches_bounding_sphere(ray_origin, ray_dir, collider._bounds._center, collider._bounds._radius, max_dist)) continue;
+
+		float t = 0;
+		if (ga_intersect_ray(ray_origin, ray_dir, collider._shape, collider._transform, &t) &&
+			t < max_dist)
+		{
+			if (hit_info != NULL)
+			{
+				ga_raycast_hit_info info;
+				info._dist = t;
+				info._point = ray_origin + ray_dir.scale_result(t);
+				info._normal = ga_vec3f::zero_vector();
+				info._collider = collider._body;
+				hit_info->push_back(info);
+			}
+			hit = true;
+		}
+	}
+	return hit;
+}
+
+bool ga_physics_snapshot::point_in_any_solid(const ga_vec3f& point) const
+{
+	for (int i = 0; i < _colliders.size(); ++i)
+	{
+		const ga_collider_snapshot& collider = _colliders[i];
+		if (collider._shape->get_type() == k_shape_plane) continue;
+		if (!bounds_reach_sphere(collider._bounds, point, 0.0f)) continue;
+
+		if (ga_point_in_shape(point, collider._shape, collider._transform))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+int ga_physics_snapshot::overlap_point(const ga_vec3f& point, ga_rigid_body** results, int capacity) const
+{
+	int count = 0;
+	for (int i = 0; i < _colliders.size() && count < capacity; ++i)
+	{
+		const ga_collider_snapshot& collider = _colliders[i];
+		if (!bounds_reach_sphere(collider._bounds, point, 0.0f)) continue;
+
+		if (ga_point_in_shape(point, collider._shape, collider._transform))
+		{
+			results[count++] = collider._body;
+		}
+	}
+	return count;
+}
+
+int ga_physics_snapshot::overlap_sphere(const ga_vec3f& center, float radius, ga_rigid_body** results, int capacity) const
+{
+	ga_sphere query;
+	query._center = center;
+	query._radius = radius;
+
+	ga_mat4f identity;
+	identity.make_identity();
+
+	int count = 0;
+	for (int i = 0; i < _colliders.size() && count < capacity; ++i)
+	{
+		const ga_collider_snapshot& collider = _colliders[i];
+		if (!bounds_reach_sphere(collider._bounds, center, radius)) continue;
+
+		ga_collision_info info;
+		if (ga_collide(&query, identity, collider._shape, collider._transform, &info))
+		{
+			results[count++] = collider._body;
+		}
+	}
+	return count;
+}
+
+int ga_physics_snapshot::overlap_box(const ga_oobb& box, const ga_mat4f& transform, ga_rigid_body** results, int capacity) const
+{
+	// The half vectors are perpendicular, so the corner distance is the root of their squared lengths.
+	ga_vec3f center = transform.transform_point(box._center);
+	float radius2 = 0.0f;
+	for (int i = 0; i < 3; ++i)
+	{
+		radius2 += transform.transform_vector(box._half_vectors[i]).mag2();
+	}
+	float radius = ga_sqrtf(radius2);
+
+	int count = 0;
+	for (int i = 0; i < _colliders.size() && count < capacity; ++i)
+	{
+		const ga_collider_snapshot& collider = _colliders[i];
+		if (!bounds_reach_sphere(collider._bounds, center, radius)) continue;
+
+		ga_collision_info info;
+		if (ga_collide(&box, transform, collider._shape, collider._transform, &info))
+		{
+			results[count++] = collider._body;
+		}
+	}
+	return count;
+}
+
+int ga_physics_snapshot::sweep_sphere(const ga_vec3f& origin, const ga_vec3f& dir, float radius, float max_dist,
+	ga_raycast_hit_info* hits, int capacity) const
+{
+	if (capacity <= 0) return 0;
+
+	ga_mat4f identity;
+	identity.make_identity();
+
+	int count = 0;
+	for (int i = 0; i < _colliders.size(); ++i)
+	{
+		const ga_collider_snapshot& collider = _colliders[i];
+		if (!ray_reaches_bounding_sphere(origin, dir, collider._bounds._center, collider._bounds._radius + radius, max_dist)) continue;
+
+		float t;
+		if (!ga_sweep_sphere(origin, dir, radius, collider._shape, collider._transform, &t) || t > max_dist) continue;
+
+		// Insertion sort into the buffer, dropping the farthest hit once it's full.
+		if (count == capacity && t >= hits[count - 1]._dist) continue;
+		int slot = count < capacity ? count++ : count - 1;
+		while (slot > 0 && hits[slot - 1]._dist > t)
+		{
+			hits[slot] = hits[slot - 1];
+			--slot;
+		}
+
+		ga_raycast_hit_info& hit = hits[slot];
+		hit._dist = t;
+		hit._collider = collider._body;
+
+		// A sphere just touching doesn't register as a collision, so find the contact
+		// with a slightly larger one.
+		ga_sphere probe;
+		probe._center = origin + dir.scale_result(t);
+		probe._radius = radius + 0.001f;
+		ga_collision_info info;
+		if (ga_collide(&probe, identity, collider._shape, collider._transform, &info))
+		{
+			hit._point = info._point;
+			hit._normal = -info._normal;
+		}
+		else
+		{
+			hit._point = probe._center + dir.scale_result(radius);
+			hit._normal = -dir;
+		}
+	}
+	return count;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_intersection.h"
+
+#include "math/ga_mat4f.h"
+#include "math/ga_vec3f.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class ga_rigid_body;
+struct ga_oobb;
+struct ga_shape;
+
+struct ga_bounding_sphere
+{
+	ga_vec3f _center;
+	float _radius;
+};
+
+/*
+** A collider as it was when its snapshot was published.
+** The body pointer is a handle for hit reporting; it must not be dereferenced
+** from a query, since the step may be writing to it.
+*/
+struct ga_collider_snapshot
+{
+	const ga_shape* _shape;
+	ga_rigid_body* _body;
+	ga_mat4f _transform;
+	ga_bounding_sphere _bounds;
+};
+
+/*
+** A read-only copy of the world's collider data.
+**
+** The world publishes a snapshot at the end of every step. Any number of threads
+** can query a published snapshot without locks while the next step runs, since the
+** step only ever writes to the bodies and to snapshots nobody is reading.
+** See ga_physics_world::acquire_snapshot.
+*/
+class ga_physics_snapshot
+{
+public:
+	/*
+	** Step the snapshot was taken on.
+	*/
+	uint32_t get_epoch() const { return _epoch; }
+
+	int get_collider_count() const { return int(_colliders.size()); }
+	const ga_collider_snapshot& get_collider(int index) const { return _colliders[index]; }
+
+	/*
+	** Every collider the ray hits within max_dist, unsorted, with the distance and
+	** point where it enters each. Normals aren't computed and are left zero.
+	*/
+	bool raycast_all(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
+		std::vector<ga_raycast_hit_info>* hit_info, float max_dist) const;
+
+	/*
+	** Whether the point lies inside or on any box, sphere or capsule. Planes are
+	** skipped: they bound the level rather than fill it.
+	*/
+	bool point_in_any_solid(const ga_vec3f& point) const;
+
+	/*
+	** Overlap queries. Each writes the bodies of the colliders touching the query
+	** shape into the caller's buffer and returns how many it wrote, stopping once
+	** the buffer is full. Nothing is allocated.
+	*/
+	int overlap_point(const ga_vec3f& point, ga_rigid_body** results, int capacity) const;
+	int overlap_sphere(const ga_vec3f& center, float radius, ga_rigid_body** results, int capacity) const;
+	int overlap_box(const ga_oobb& box, const ga_mat4f& transform, ga_rigid_body** results, int capacity) const;
+
+	/*
+	** Sweep a sphere from origin along a unit direction, up to max_dist. Writes the
+	** colliders it touches into the caller's buffer, nearest first, and returns how
+	** many it wrote. If there are more hits than capacity the nearest are kept.
+	** Colliders the sphere starts out touching are hit at distance zero.
+	*/
+	int sweep_sphere(const ga_vec3f& origin, const ga_vec3f& dir, float radius, float max_dist,
+		ga_raycast_hit_info* hits, int capacity) const;
+
+private:
+	std::vector<ga_collider_snapshot> _colliders;
+	uint32_t _epoch = 0;
+
+	// Threads currently holding this snapshot. Written snapshots are only reused
+	// once this drops to zero.
+	mutable std::atomic<int> _readers{ 0 };
+
+	friend class ga_physics_world;
+};
@@ -8,42 +8,60 @@
 */
 
 #include "ga_physics_world.h"
+#include "ga_physics_recording.h"
 #include "ga_rigid_body.h"
 #include "ga_shape.h"
+#include "ga_shape_dispatch.h"
 
+#include "framework/ga_alloc_counter.h"
 #include "framework/ga_drawcall.h"
 #include "framework/ga_frame_params.h"
+#include "jobs/ga_job.h"
 
 #include <algorithm>
 #include <assert.h>
-#include <ctime>
+#include <cstring>
+#include <float.h>
+#include <math.h>
+#include <thread>
+#include <unordered_map>
 
-typedef bool (*intersection_func_t)(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info);
-typedef bool (*intersect_ray_func_t)(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir, const ga_shape* shape, const ga_mat4f& transform, float* dist);
+// Bodies slower than these for k_time_to_sleep seconds are put to sleep, along
+// with the rest of their island.
+static const float k_sleep_linear_velocity = 0.1f;
+static const float k_sleep_angular_velocity = 0.1f;
+static const float k_time_to_sleep = 0.5f;
 
-static intersection_func_t k_dispatch_table[k_shape_count][k_shape_count];
-static intersect_ray_func_t k_ray_dispatch_table[k_shape_count];
+// Contacts approaching slower than this don't bounce.
+static const float k_restitution_velocity = 1.0f;
+
+// Penetration allowed before position correction kicks in, and the fraction of
+// the remaining penetration removed per position iteration.
+static const float k_penetration_slop = 0.005f;
+static const float k_penetration_correction = 0.2f;
+static const int k_position_iterations = 4;
+
+// Fast bodies sweep this fraction of their shape's inner sphere, so the slight
+// penetration of resting contacts doesn't register as a hit.
+static const float k_fast_sweep_radius_scale = 0.5f;
+
+// Color batches with fewer manifolds than this are solved inline rather than through
+// jobs. This is also the smallest slice of a batch handed to a single job.
+static const int k_min_parallel_batch_size = 32;
+static const int k_max_solver_jobs = 32;
 
 ga_physics_world::ga_physics_world()
 {
-	// Clear the dispatch tables.
-	for (int i = 0; i < k_shape_count; ++i)
+	for (int i = 0; i < k_max_force_fields; ++i)
 	{
-		for (int j = 0; j < k_shape_count; ++j)
-		{
-			k_dispatch_table[i][j] = intersection_unimplemented;
-		}
-		k_ray_dispatch_table[i] = ray_intersection_unimplemented;
+		_force_field_used[i] = false;
 	}
 
-	k_dispatch_table[k_shape_oobb][k_shape_oobb] = separating_axis_test;
-	k_dispatch_table[k_shape_plane][k_shape_oobb] = oobb_vs_plane;
-	k_dispatch_table[k_shape_oobb][k_shape_plane] = oobb_vs_plane;
-	k_ray_dispatch_table[k_shape_oobb] = ray_vs_oobb;
-	k_ray_dispatch_table[k_shape_plane] = ray_vs_plane;
-
 	// Default gravity to Earth's constant.
-	_gravity = { 0.0f, -9.807f, 0.0f };
+	ga_force_field gravity;
+	gravity._type = k_force_field_acceleration;
+	gravity._vector = { 0.0f, -9.807f, 0.0f };
+	_gravity_field = add_force_field(gravity);
 }
 
 ga_physics_world::~ga_physics_world()
@@ -53,19 +71,67 @@ ga_physics_world::~ga_physics_world()
 
 void ga_physics_world::add_rigid_body(ga_rigid_body* body)
 {
+	assert(_recording == nullptr);
+
 	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
-	_bodies.push_back(body);
+	if (_stepping)
+	{
+		_added_bodies.push_back(body);
+	}
+	else
+	{
+		_bodies.push_back(body);
+	}
 	_bodies_lock.clear(std::memory_order_release);
 }
 
 void ga_physics_world::remove_rigid_body(ga_rigid_body* body)
 {
+	assert(_recording == nullptr);
+
 	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	if (_stepping)
+	{
+		_removed_bodies.push_back(body);
+		_bodies_lock.clear(std::memory_order_release);
+		return;
+	}
 	_bodies.erase(std::remove(_bodies.begin(), _bodies.end(), body));
+	_contacts.remove_body(body);
+	write_snapshot();
+	_bodies_lock.clear(std::memory_order_release);
+
+	// The caller may delete the body as soon as this returns.
+	wait_for_snapshot_readers();
+}
+ga_rigid_body* ga_physics_world::create_rigid_body(ga_shape* shape, float mass)
+{
+	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	ga_rigid_body* body = _body_pool.create(shape, mass);
 	_bodies_lock.clear(std::memory_order_release);
+	return body;
 }
+
+void ga_physics_world::destroy_rigid_body(ga_rigid_body* body)
+{
+	remove_rigid_body(body);
+
+	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	if (_stepping)
+	{
+		_destroyed_bodies.push_back(body);
+	}
+	else
+	{
+		_body_pool.destroy(body);
+	}
+	_bodies_lock.clear(std::memory_order_release);
+}
+
 void ga_physics_world::remove_all_rigid_bodies()
 {
+	assert(_recording == nullptr && !_stepping);
+
 	while (_bodies.size() > 0)
 	{
 		ga_rigid_body* body = _bodies[_bodies.size() - 1];
@@ -73,74 +139,401 @@ void ga_physics_world::remove_all_rigid_bodies()
 		_bodies.erase(std::remove(_bodies.begin(), _bodies.end(), body));
 		_bodies_lock.clear(std::memory_order_release);
 	}	
+	_contacts.clear();
+
+	publish_snapshot();
+	wait_for_snapshot_readers();
+}
+
+int ga_physics_world::add_force_field(const ga_force_field& field)
+{
+	for (int i = 0; i < k_max_force_fields; ++i)
+	{
+		if (!_force_field_used[i])
+		{
+			_force_fields[i] = field;
+			_force_field_used[i] = true;
+			return i;
+		}
+	}
+	return -1;
+}
+
+void ga_physics_world::set_force_field(int handle, const ga_force_field& field)
+{
+	assert(handle >= 0 && handle < k_max_force_fields && _force_field_used[handle]);
+	_force_fields[handle] = field;
+}
+
+void ga_physics_world::remove_force_field(int handle)
+{
+	assert(handle >= 0 && handle < k_max_force_fields);
+	_force_field_used[handle] = false;
+}
+
+void ga_physics_world::set_fixed_timestep(float hz, int max_substeps)
+{
+	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	_fixed_timestep = hz > 0.0f ? 1.0f / hz : 0.0f;
+	_max_substeps = ga_max(max_substeps, 1);
+	_time_accumulator = 0.0f;
+	_bodies_lock.clear(std::memory_order_release);
 }
 
 void ga_physics_world::step(ga_frame_params* params)
 {
+	uint64_t allocation_count = ga_get_allocation_count();
+
+	// The solver waits on jobs, and the jobs run meanwhile may add or remove bodies.
+	// Holding the lock through that would leave them spinning on it forever.
 	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	assert(!_stepping);
+	_stepping = true;
+	_bodies_lock.clear(std::memory_order_release);
 
-	// Step the physics sim.
+	// Shapes may have been edited since the last step, so refresh the cached
+	// bounds before anything culls against them. Static and sleeping bodies keep
+	// theirs unless they were moved from outside.
 	for (int i = 0; i < _bodies.size(); ++i)
 	{
-		if (_bodies[i]->_flags & k_static) continue;
-
 		ga_rigid_body* body = _bodies[i];
+		if ((body->_flags & k_transform_set) || !(body->_flags & (k_static | k_sleeping)))
+		{
+			body->update_bounds();
+			body->_flags &= ~k_transform_set;
+		}
+	}
+
+	float dt = std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count();
+
+	// We should not attempt to resolve collisions if we're paused and have not single stepped.
+	bool should_resolve = dt > 0.0f || params->_single_step;
+
+	if (_recording)
+	{
+		_recording->record_step(this, params);
+	}
+
+	if (_fixed_timestep <= 0.0f)
+	{
+		save_previous_transforms();
+		simulate(params, dt, should_resolve);
+		_last_substep_count = 1;
+		params->_physics_interpolation = 1.0f;
+	}
+	else
+	{
+		_time_accumulator += dt;
+
+		// A single step while paused always advances exactly one substep.
+		if (params->_single_step)
+		{
+			_time_accumulator = ga_max(_time_accumulator, _fixed_timestep);
+		}
+
+		_last_substep_count = 0;
+		while (_time_accumulator >= _fixed_timestep && _last_substep_count < _max_substeps)
+		{
+			save_previous_transforms();
+			simulate(params, _fixed_timestep, true);
+			_time_accumulator -= _fixed_timestep;
+			++_last_substep_count;
+		}
 
-		if ((_bodies[i]->_flags & k_weightless) == 0)
+		// If we couldn't keep up, drop the backlog rather than falling further behind every frame.
+		if (_time_accumulator >= _fixed_timestep)
 		{
-			body->_forces.push_back(_gravity);
+			_time_accumulator = fmodf(_time_accumulator, _fixed_timestep);
 		}
 
-		step_linear_dynamics(params, body);
-		step_angular_dynamics(params, body);
+		params->_physics_interpolation = _time_accumulator / _fixed_timestep;
+	}
+
+	if (_recording)
+	{
+		_recording->end_step(this);
 	}
 
-	test_intersections(params);
+	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	_stepping = false;
+
+	bool removed = !_removed_bodies.empty() || !_destroyed_bodies.empty();
+	for (ga_rigid_body* body : _removed_bodies)
+	{
+		auto added = std::find(_added_bodies.begin(), _added_bodies.end(), body);
+		if (added != _added_bodies.end())
+		{
+			_added_bodies.erase(added);
+			continue;
+		}
+		_bodies.erase(std::remove(_bodies.begin(), _bodies.end(), body));
+		_contacts.remove_body(body);
+	}
+	_removed_bodies.clear();
+	_bodies.insert(_bodies.end(), _added_bodies.begin(), _added_bodies.end());
+	_added_bodies.clear();
 
+	write_snapshot();
 	_bodies_lock.clear(std::memory_order_release);
+
+	if (removed)
+	{
+		wait_for_snapshot_readers();
+
+		while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+		for (ga_rigid_body* body : _destroyed_bodies)
+		{
+			_body_pool.destroy(body);
+		}
+		_destroyed_bodies.clear();
+		_bodies_lock.clear(std::memory_order_release);
+	}
+
+	_last_step_allocation_count = ga_get_allocation_count() - allocation_count;
 }
 
-void ga_physics_world::test_intersections(ga_frame_params* params)
+void ga_physics_world::start_recording(ga_physics_recording* recording)
+{
+	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	assert(_recording == nullptr && !_stepping);
+	_contacts.clear();
+	_recording = recording;
+	_recording->start(this);
+	_bodies_lock.clear(std::memory_order_release);
+}
+
+void ga_physics_world::stop_recording()
+{
+	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	assert(_recording != nullptr);
+	_recording->stop(this);
+	_recording = nullptr;
+	_bodies_lock.clear(std::memory_order_release);
+}
+
+void ga_physics_world::save_previous_transforms()
 {
-	// Intersection tests. Naive N^2 comparisons.
 	for (int i = 0; i < _bodies.size(); ++i)
 	{
-		for (int j = i + 1; j < _bodies.size(); ++j)
+		_bodies[i]->_previous_transform = _bodies[i]->_transform;
+	}
+}
+
+void ga_physics_world::simulate(ga_frame_params* params, float dt, bool should_resolve)
+{
+	++_step_index;
+
+	// Sum the force fields once for the whole step.
+	ga_vec3f field_acceleration = ga_vec3f::zero_vector();
+	ga_vec3f field_force = ga_vec3f::zero_vector();
+	for (int i = 0; i < k_max_force_fields; ++i)
+	{
+		if (!_force_field_used[i]) continue;
+
+		if (_force_fields[i]._type == k_force_field_acceleration)
+		{
+			field_acceleration += _force_fields[i]._vector;
+		}
+		else
 		{
-			ga_shape* shape_a = _bodies[i]->_shape;
-			ga_shape* shape_b = _bodies[j]->_shape;
-			intersection_func_t func = k_dispatch_table[shape_a->get_type()][shape_b->get_type()];
+			field_force += _force_fields[i]._vector;
+		}
+	}
+
+	// Every body starts the step in its own island.
+	_island_parent.resize(_bodies.size());
+	_island_sleep_timer.resize(_bodies.size());
+	for (int i = 0; i < _bodies.size(); ++i)
+	{
+		_island_parent[i] = i;
+	}
+
+	// Step the physics sim.
+	for (int i = 0; i < _bodies.size(); ++i)
+	{
+		if (_bodies[i]->_flags & (k_static | k_sleeping)) continue;
+
+		ga_rigid_body* body = _bodies[i];
+
+		step_linear_dynamics(dt, body, field_acceleration, field_force);
+		step_angular_dynamics(dt, body);
+	}
+
+	sweep_fast_bodies();
+
+	test_intersections(params, should_resolve);
+
+	if (should_resolve)
+	{
+		_contacts.remove_stale(_step_index);
+		solve_contacts();
+	}
+
+	update_sleeping(dt);
+}
+
+static bool bounding_spheres_overlap(const ga_bounding_sphere& a, const ga_bounding_sphere& b)
+{
+	if (a._radius == FLT_MAX || b._radius == FLT_MAX) return true;
+
+	float radius = a._radius + b._radius;
+	return (b._center - a._center).mag2() <= radius * radius;
+}
+
+struct ga_physics_world::bucket_tester
+{
+	ga_physics_world* _world;
+	ga_frame_params* _params;
+	bool _should_resolve;
+
+	template<typename A, typename B>
+	void operator()()
+	{
+		_world->test_bucket<A, B>(_params, _should_resolve);
+	}
+};
+
+void ga_physics_world::test_intersections(ga_frame_params* params, bool should_resolve)
+{
+	// Bucket the bodies by shape type, so each pair of buckets can run a loop
+	// specialized for its two shapes.
+	for (int t = 0; t < k_shape_count; ++t)
+	{
+		_shape_buckets[t].clear();
+	}
+	_bounding_spheres.resize(_bodies.size());
+	for (int i = 0; i < _bodies.size(); ++i)
+	{
+		_shape_buckets[_bodies[i]->_shape->get_type()].push_back(i);
+		_bodies[i]->get_bounding_sphere(_bounding_spheres[i]._center, _bounding_spheres[i]._radius);
+	}
+
+	bucket_tester tester = { this, params, should_resolve };
+	ga_for_each_shape_pair<>::run(tester);
+}
+
+template<typename A, typename B>
+void ga_physics_world::test_bucket(ga_frame_params* params, bool should_resolve)
+{
+	const std::vector<int>& bucket_a = _shape_buckets[ga_shape_traits<A>::k_type];
+	const std::vector<int>& bucket_b = _shape_buckets[ga_shape_traits<B>::k_type];
+	const bool same_bucket = ga_shape_traits<A>::k_type == ga_shape_traits<B>::k_type;
+
+	// Intersection tests. Naive N^2 comparisons.
+	for (int bucket_i = 0; bucket_i < bucket_a.size(); ++bucket_i)
+	{
+		int i = bucket_a[bucket_i];
+		const A* shape_a = static_cast<const A*>(_bodies[i]->_shape);
+
+		for (int bucket_j = same_bucket ? bucket_i + 1 : 0; bucket_j < bucket_b.size(); ++bucket_j)
+		{
+			int j = bucket_b[bucket_j];
+
+			// Pairs where neither body can move have nothing to resolve.
+			const uint32_t k_inactive = k_static | k_sleeping;
+			if ((_bodies[i]->_flags & k_inactive) && (_bodies[j]->_flags & k_inactive)) continue;
+
+			// Cheap bounding sphere reject before the exact test.
+			if (!bounding_spheres_overlap(_bounding_spheres[i], _bounding_spheres[j])) continue;
+
+			const B* shape_b = static_cast<const B*>(_bodies[j]->_shape);
 
 			ga_collision_info info;
-			bool collision = func(shape_a, _bodies[i]->_transform, shape_b, _bodies[j]->_transform, &info);
+			bool collision = ga_collider<A, B>::test(shape_a, _bodies[i]->_transform, shape_b, _bodies[j]->_transform, &info);
 			if (collision)
 			{
-				std::time_t time = std::chrono::system_clock::to_time_t(
-					std::chrono::system_clock::now());
-
-#if defined(GA_PHYSICS_DEBUG_DRAW)
-				ga_dynamic_drawcall collision_draw;
-				collision_draw._positions.push_back(ga_vec3f::zero_vector());
-				collision_draw._positions.push_back(info._normal);
-				collision_draw._indices.push_back(0);
-				collision_draw._indices.push_back(1);
-				collision_draw._color = { 1.0f, 1.0f, 0.0f };
-				collision_draw._draw_mode = GL_LINES;
-				collision_draw._material = nullptr;
-				collision_draw._transform.make_translation(info._point);
-
-				while (params->_dynamic_drawcall_lock.test_and_set(std::memory_order_acquire)) {}
-				params->_dynamic_drawcalls.push_back(collision_draw);
-				params->_dynamic_drawcall_lock.clear(std::memory_order_release);
+				on_collision(params, should_resolve, i, j, &info);
+			}
+		}
+	}
+}
+
+void ga_physics_world::on_collision(ga_frame_params* params, bool should_resolve, int i, int j, ga_collision_info* info)
+{
+#if defined(GA_PHYSICS_DEBUG_DRAW) && !defined(GA_HEADLESS)
+	ga_dynamic_drawcall collision_draw;
+	collision_draw._positions.push_back(ga_vec3f::zero_vector());
+	collision_draw._positions.push_back(info->_normal);
+	collision_draw._indices.push_back(0);
+	collision_draw._indices.push_back(1);
+	collision_draw._color = { 1.0f, 1.0f, 0.0f };
+	collision_draw._draw_mode = GL_LINES;
+	collision_draw._material = nullptr;
+	collision_draw._transform.make_translation(info->_point);
+
+	while (params->_dynamic_drawcall_lock.test_and_set(std::memory_order_acquire)) {}
+	params->_dynamic_drawcalls.push_back(collision_draw);
+	params->_dynamic_drawcall_lock.clear(std::memory_order_release);
 #endif
-				// We should not attempt to resolve collisions if we're paused and have not single stepped.
-				bool should_resolve = params->_delta_time > std::chrono::milliseconds(0) || params->_single_step;
+	if (should_resolve)
+	{
+		// An awake body touching a sleeping one wakes it.
+		if (_bodies[i]->_flags & k_sleeping) _bodies[i]->wake();
+		if (_bodies[j]->_flags & k_sleeping) _bodies[j]->wake();
 
-				if (should_resolve)
-				{
-					resolve_collision(_bodies[i], _bodies[j], &info);
-				}
-			}
+		_contacts.update(_bodies[i], _bodies[j], info, _step_index);
+	}
+
+	// Static bodies don't join islands, otherwise the floor would connect everything.
+	if (((_bodies[i]->_flags | _bodies[j]->_flags) & k_static) == 0)
+	{
+		merge_islands(i, j);
+	}
+}
+
+int ga_physics_world::find_island(int body_index)
+{
+	while (_island_parent[body_index] != body_index)
+	{
+		_island_parent[body_index] = _island_parent[_island_parent[body_index]];
+		body_index = _island_parent[body_index];
+	}
+	return body_index;
+}
+
+void ga_physics_world::merge_islands(int body_index_a, int body_index_b)
+{
+	int island_a = find_island(body_index_a);
+	int island_b = find_island(body_index_b);
+	if (island_a != island_b)
+	{
+		_island_parent[island_b] = island_a;
+	}
+}
+
+void ga_physics_world::update_sleeping(float dt)
+{
+	// Advance each awake body's timer, and track the least rested body per island.
+	for (int i = 0; i < _bodies.size(); ++i)
+	{
+		_island_sleep_timer[i] = FLT_MAX;
+	}
+	for (int i = 0; i < _bodies.size(); ++i)
+	{
+		ga_rigid_body* body = _bodies[i];
+		if (body->_flags & (k_static | k_sleeping)) continue;
+
+		bool resting =
+			body->_velocity.mag2() < k_sleep_linear_velocity * k_sleep_linear_velocity &&
+			body->_angular_velocity.mag2() < k_sleep_angular_velocity * k_sleep_angular_velocity;
+		body->_sleep_timer = resting ? body->_sleep_timer + dt : 0.0f;
+
+		int island = find_island(i);
+		_island_sleep_timer[island] = ga_min(_island_sleep_timer[island], body->_sleep_timer);
+	}
+
+	// Put whole islands to sleep once every body in them has rested long enough.
+	for (int i = 0; i < _bodies.size(); ++i)
+	{
+		ga_rigid_body* body = _bodies[i];
+		if (body->_flags & (k_static | k_sleeping)) continue;
+
+		if (_island_sleep_timer[find_island(i)] >= k_time_to_sleep)
+		{
+			body->_flags |= k_sleeping;
+			body->_velocity = ga_vec3f::zero_vector();
+			body->_angular_momentum = ga_vec3f::zero_vector();
+			body->_angular_velocity = ga_vec3f::zero_vector();
 		}
 	}
 }
@@ -148,65 +541,228 @@ void ga_physics_world::test_intersections(ga_frame_params* params)
 bool ga_physics_world::raycast_all(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
 	std::vector<ga_raycast_hit_info>* hit_info, float max_dist)
 {
-	bool hit = false;
+	const ga_physics_snapshot* snapshot = acquire_snapshot();
+	bool hit = snapshot->raycast_all(ray_origin, ray_dir, hit_info, max_dist);
+	release_snapshot(snapshot);
+	return hit;
+}
+
+bool ga_physics_world::point_in_any_solid(const ga_vec3f& point)
+{
+	const ga_physics_snapshot* snapshot = acquire_snapshot();
+	bool inside = snapshot->point_in_any_solid(point);
+	release_snapshot(snapshot);
+	return inside;
+}
+
+int ga_physics_world::overlap_point(const ga_vec3f& point, ga_rigid_body** results, int capacity)
+{
+	const ga_physics_snapshot* snapshot = acquire_snapshot();
+	int count = snapshot->overlap_point(point, results, capacity);
+	release_snapshot(snapshot);
+	return count;
+}
+
+int ga_physics_world::overlap_sphere(const ga_vec3f& center, float radius, ga_rigid_body** results, int capacity)
+{
+	const ga_physics_snapshot* snapshot = acquire_snapshot();
+	int count = snapshot->overlap_sphere(center, radius, results, capacity);
+	release_snapshot(snapshot);
+	return count;
+}
+
+int ga_physics_world::overlap_box(const ga_oobb& box, const ga_mat4f& transform, ga_rigid_body** results, int capacity)
+{
+	const ga_physics_snapshot* snapshot = acquire_snapshot();
+	int count = snapshot->overlap_box(box, transform, results, capacity);
+	release_snapshot(snapshot);
+	return count;
+}
+
+int ga_physics_world::sweep_sphere(const ga_vec3f& origin, const ga_vec3f& dir, float radius, float max_dist,
+	ga_raycast_hit_info* hits, int capacity)
+{
+	const ga_physics_snapshot* snapshot = acquire_snapshot();
+	int count = snapshot->sweep_sphere(origin, dir, radius, max_dist, hits, capacity);
+	release_snapshot(snapshot);
+	return count;
+}
+
+std::shared_ptr<const ga_mesh_export> ga_physics_world::get_static_mesh_export()
+{
+	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	if (!_stepping && !is_mesh_export_current())
+	{
+		rebuild_mesh_export();
+	}
+	std::shared_ptr<const ga_mesh_export> mesh = _mesh_export;
+	_bodies_lock.clear(std::memory_order_release);
+
+	return mesh;
+}
+
+bool ga_physics_world::is_mesh_export_current() const
+{
+	int source = 0;
 	for (int i = 0; i < _bodies.size(); ++i)
 	{
-		ga_shape* shape = _bodies[i]->_shape;
-		float t = 0;
-		intersect_ray_func_t func = k_ray_dispatch_table[shape->get_type()];
-		if (func(ray_origin, ray_dir, shape, _bodies[i]->_transform, &t) &&
-			t < max_dist)
+		const ga_rigid_body* body = _bodies[i];
+		if ((body->_flags & k_static) == 0) continue;
+
+		if (source >= _mesh_export_sources.size() ||
+			_mesh_export_sources[source]._body != body ||
+			_mesh_export_sources[source]._shape != body->_shape ||
+			memcmp(&_mesh_export_sources[source]._transform, &body->_transform, sizeof(ga_mat4f)) != 0)
 		{
-			if (hit_info != NULL)
-			{
-				ga_raycast_hit_info info;
-				info._collider = _bodies[i];
-				hit_info->push_back(info);
-			}
-			hit = true;
+			return false;
 		}
+		++source;
 	}
-	return hit;
+	return source == _mesh_export_sources.size();
 }
 
-std::vector<ga_vec3f> ga_physics_world::get_mesh_corners(float away_dist)
+void ga_physics_world::rebuild_mesh_export()
 {
-	std::vector<ga_vec3f> out;
+	// Bodies that haven't moved keep their corners and edges; only new or moved
+	// bodies are exported again.
+	std::unordered_map<const ga_rigid_body*, int> previous_sources;
+	for (int i = 0; i < _mesh_export_sources.size(); ++i)
+	{
+		previous_sources[_mesh_export_sources[i]._body] = i;
+	}
+
+	std::shared_ptr<const ga_mesh_export> previous_export = _mesh_export;
+	std::shared_ptr<ga_mesh_export> mesh = std::make_shared<ga_mesh_export>();
+	std::vector<mesh_export_source> sources_before;
+	std::swap(sources_before, _mesh_export_sources);
 
 	for (int i = 0; i < _bodies.size(); ++i)
 	{
-		ga_rigid_body* rb = _bodies[i];
-		ga_shape* shape = rb->_shape;
-		ga_oobb* cube = (ga_oobb*)shape;
-		if (cube != NULL)
+		const ga_rigid_body* body = _bodies[i];
+		if ((body->_flags & k_static) == 0) continue;
+
+		mesh_export_source source;
+		source._body = body;
+		source._shape = body->_shape;
+		source._transform = body->_transform;
+		source._first_corner = int(mesh->_corners.size());
+		source._first_edge = int(mesh->_edges.size());
+
+		auto previous = previous_sources.find(body);
+		const mesh_export_source* before = previous != previous_sources.end() ? &sources_before[previous->second] : nullptr;
+		if (before && before->_shape == body->_shape &&
+			memcmp(&before->_transform, &body->_transform, sizeof(ga_mat4f)) == 0)
 		{
-			std::vector<ga_vec3f> corners;
-			cube->get_corners(corners);
-			for (int j = 0; j < corners.size(); ++j)
+			auto corners = previous_export->_corners.begin() + before->_first_corner;
+			auto edges = previous_export->_edges.begin() + before->_first_edge;
+			mesh->_corners.insert(mesh->_corners.end(), corners, corners + before->_corner_count);
+			mesh->_edges.insert(mesh->_edges.end(), edges, edges + before->_edge_count);
+		}
+		else
+		{
+			ga_export_shape_mesh(body->_shape, body->_transform, body, mesh.get());
+		}
+
+		source._corner_count = int(mesh->_corners.size()) - source._first_corner;
+		source._edge_count = int(mesh->_edges.size()) - source._first_edge;
+		_mesh_export_sources.push_back(source);
+	}
+
+	_mesh_export = mesh;
+}
+
+const ga_physics_snapshot* ga_physics_world::acquire_snapshot() const
+{
+	while (true)
+	{
+		int index = _published_snapshot.load();
+		_snapshots[index]._readers.fetch_add(1);
+
+		// A new snapshot may have been published between the load and the increment,
+		// and this one handed back to the writer. Only keep it if it's still current.
+		if (_published_snapshot.load() == index)
+		{
+			return &_snapshots[index];
+		}
+		_snapshots[index]._readers.fetch_sub(1);
+	}
+}
+
+void ga_physics_world::release_snapshot(const ga_physics_snapshot* snapshot) const
+{
+	snapshot->_readers.fetch_sub(1);
+}
+
+void ga_physics_world::publish_snapshot()
+{
+	while (_bodies_lock.test_and_set(std::memory_order_acquire)) {}
+	if (!_stepping)
+	{
+		write_snapshot();
+	}
+	_bodies_lock.clear(std::memory_order_release);
+}
+
+void ga_physics_world::write_snapshot()
+{
+	// Write into a snapshot nobody is reading. Readers only hold one for the length
+	// of a query, so one frees up quickly.
+	int published = _published_snapshot.load();
+	int target = -1;
+	while (target < 0)
+	{
+		for (int i = 0; i < k_snapshot_count; ++i)
+		{
+			if (i != published && _snapshots[i]._readers.load() == 0)
 			{
-				ga_vec3f pos = corners[j];
-				if (away_dist > 0) pos += (corners[j] - cube->_center).normal().scale_result(away_dist);
-				pos = rb->_transform.transform_point(pos);
-				out.push_back(pos);
+				target = i;
+				break;
 			}
 		}
+		if (target < 0) std::this_thread::yield();
+	}
+
+	ga_physics_snapshot& snapshot = _snapshots[target];
+	snapshot._colliders.resize(_bodies.size());
+	for (int i = 0; i < _bodies.size(); ++i)
+	{
+		ga_collider_snapshot& collider = snapshot._colliders[i];
+		collider._shape = _bodies[i]->_shape;
+		collider._body = _bodies[i];
+		collider._transform = _bodies[i]->_transform;
+		_bodies[i]->get_bounding_sphere(collider._bounds._center, collider._bounds._radius);
 	}
-	return out;
+	snapshot._epoch = _step_index;
+
+	_published_snapshot.store(target);
 }
 
-void ga_physics_world::step_linear_dynamics(ga_frame_params* params, ga_rigid_body* body)
+void ga_physics_world::wait_for_snapshot_readers()
 {
-	// Linear dynamics.
-	ga_vec3f overall_force = ga_vec3f::zero_vector();
-	while (body->_forces.size() > 0)
+	// Once nobody holds an older snapshot, removed bodies and their shapes are no
+	// longer reachable from any query.
+	int published = _published_snapshot.load();
+	for (int i = 0; i < k_snapshot_count; ++i)
 	{
-		overall_force += body->_forces.back();
-		body->_forces.pop_back();
+		if (i == published) continue;
+		while (_snapshots[i]._readers.load() != 0)
+		{
+			std::this_thread::yield();
+		}
 	}
+}
 
+void ga_physics_world::step_linear_dynamics(float dt, ga_rigid_body* body,
+	const ga_vec3f& field_acceleration, const ga_vec3f& field_force)
+{
+	// Linear dynamics.
+	ga_vec3f overall_force = body->_force_accumulator + field_force;
+	if ((body->_flags & k_weightless) == 0)
+	{
+		overall_force += field_acceleration.scale_result(body->_mass);
+	}
+	body->_force_accumulator = ga_vec3f::zero_vector();
 
-	float dt = std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count();
-	
 	// Force - and so acceleration - is assumed constant throughout the timestep (we 
 	// don't have a means to calculate acceleration as a function of time). So here the 
 	// Runge Kutta method is used only to account for changing velocity over the timestep.
@@ -227,71 +783,334 @@ void ga_physics_world::step_linear_dynamics(ga_frame_params* params, ga_rigid_bo
 	body->_velocity = v4;
 }
 
-void ga_physics_world::step_angular_dynamics(ga_frame_params* params, ga_rigid_body* body)
+void ga_physics_world::step_angular_dynamics(float dt, ga_rigid_body* body)
 {
-	// TODO: Homework 5 BONUS.
-	// Step the angular dynamics portion of the rigid body.
-	// The rigid body's angular momentum, angular velocity, orientation, and transform
-	// should all be updated with new values.
+	// Torque, like force, is assumed constant over the timestep.
+	body->_angular_momentum += body->_torque_accumulator.scale_result(dt);
+	body->_torque_accumulator = ga_vec3f::zero_vector();
+
+	// Bring the body space inertia tensor into world space, I = R * I_body * R^T,
+	// and solve L = I * w for the angular velocity.
+	ga_mat4f rotation = body->_transform;
+	rotation.set_translation(ga_vec3f::zero_vector());
+	ga_mat4f rotation_transpose = rotation;
+	rotation_transpose.transpose();
+	ga_mat4f world_inertia = rotation_transpose * body->_inertia_tensor * rotation;
+	body->_angular_velocity = world_inertia.inverse().transform_vector(body->_angular_momentum);
+
+	body->integrate_orientation(dt);
 }
 
-void ga_physics_world::resolve_collision(ga_rigid_body* body_a, ga_rigid_body* body_b, ga_collision_info* info)
+void ga_physics_world::sweep_fast_bodies()
 {
-	// First move the objects so they no longer intersect.
-	// Each object will be moved proportionally to their incoming velocities.
-	// If an object is static, it won't be moved.
-	float total_velocity = body_a->_velocity.mag() + body_b->_velocity.mag();
-	float percentage_a = (body_a->_flags & k_static) ? 0.0f : body_a->_velocity.mag() / total_velocity;
-	float percentage_b = (body_a->_flags & k_static) ? 0.0f : body_b->_velocity.mag() / total_velocity;
+	// Each fast body sweeps its inner sphere from where the step started to where it
+	// was integrated to, and is pulled back to the first hit. Its shape then overlaps
+	// what it hit, so the discrete tests pick up the contact and the solver resolves it.
+	for (int i = 0; i < _bodies.size(); ++i)
+	{
+		ga_rigid_body* body = _bodies[i];
+		if ((body->_flags & (k_static | k_sleeping | k_fast)) != k_fast) continue;
 
-	// To avoid instability, nudge the two objects slightly farther apart.
-	const float k_nudge = 0.001f;
-	if ((body_a->_flags & k_static) == 0 && body_a->_velocity.mag2() > 0.0f)
+		// The inner sphere doesn't change as the body turns, so only its center's
+		// motion matters.
+		ga_vec3f motion = body->_transform.get_translation() - body->_previous_transform.get_translation();
+
+		ga_vec3f end;
+		float radius;
+		body->get_inner_sphere(end, radius);
+		radius *= k_fast_sweep_radius_scale;
+
+		// Moving less than the swept radius can't carry the body past anything.
+		float length = motion.mag();
+		if (length <= radius) continue;
+
+		ga_vec3f dir = motion.scale_result(1.0f / length);
+		ga_vec3f start = end - motion;
+
+		float first_hit = length;
+		for (int j = 0; j < _bodies.size(); ++j)
+		{
+			// Only bodies holding still this step are swept against. Moving bodies are
+			// left to the discrete tests.
+			ga_rigid_body* other = _bodies[j];
+			if (j == i || (other->_flags & (k_static | k_sleeping)) == 0) continue;
+
+			ga_vec3f bounds_center;
+			float bounds_radius;
+			other->get_bounding_sphere(bounds_center, bounds_radius);
+			if (bounds_radius != FLT_MAX)
+			{
+				float reach = bounds_radius + radius;
+				if ((closest_point_on_segment(bounds_center, start, end) - bounds_center).mag2() > reach * reach) continue;
+			}
+
+			// Hits at zero are already overlapping, which the discrete tests handle.
+			float t;
+			if (ga_sweep_sphere(start, dir, radius, other->_shape, other->_transform, &t) &&
+				t > 0.0f && t < first_hit)
+			{
+				first_hit = t;
+			}
+		}
+
+		if (first_hit < length)
+		{
+			body->_transform.set_translation(body->_transform.get_translation() - dir.scale_result(length - first_hit));
+		}
+	}
+}
+
+void ga_physics_world::solve_contacts()
+{
+	// Prepare each touching manifold. Approach velocities are measured before any warm
+	// starting, otherwise one contact's cached impulse would look like an impact to the next.
+	for (int m = 0; m < _contacts.get_count(); ++m)
+	{
+		ga_contact_manifold* manifold = _contacts.get_manifold(m);
+		if (manifold->_last_touched_step != _step_index) continue;
+
+		ga_rigid_body* body_a = manifold->_body_a;
+		ga_rigid_body* body_b = manifold->_body_b;
+		float inv_mass_a = (body_a->_flags & k_static) ? 0.0f : 1.0f / body_a->_mass;
+		float inv_mass_b = (body_b->_flags & k_static) ? 0.0f : 1.0f / body_b->_mass;
+		float inv_mass_sum = inv_mass_a + inv_mass_b;
+		if (inv_mass_sum <= 0.0f) continue;
+
+		// Average the coefficients of restitution.
+		float cor_average = (body_a->_coefficient_of_restitution + body_b->_coefficient_of_restitution) / 2.0f;
+
+		// Only bounce on real impacts, so resting contacts settle instead of jittering.
+		float approach_velocity = (body_b->_velocity - body_a->_velocity).dot(manifold->_normal);
+		float velocity_bias = approach_velocity < -k_restitution_velocity ? -cor_average * approach_velocity : 0.0f;
+
+		for (int p = 0; p < manifold->_point_count; ++p)
+		{
+			ga_contact_point& point = manifold->_points[p];
+			point._normal_mass = 1.0f / inv_mass_sum;
+			point._velocity_bias = velocity_bias;
+		}
+	}
+
+	// Warm start with last step's impulses.
+	for (int m = 0; m < _contacts.get_count(); ++m)
+	{
+		ga_contact_manifold* manifold = _contacts.get_manifold(m);
+		if (manifold->_last_touched_step != _step_index) continue;
+
+		ga_rigid_body* body_a = manifold->_body_a;
+		ga_rigid_body* body_b = manifold->_body_b;
+		float inv_mass_a = (body_a->_flags & k_static) ? 0.0f : 1.0f / body_a->_mass;
+		float inv_mass_b = (body_b->_flags & k_static) ? 0.0f : 1.0f / body_b->_mass;
+
+		for (int p = 0; p < manifold->_point_count; ++p)
+		{
+			ga_vec3f impulse = manifold->_normal.scale_result(manifold->_points[p]._normal_impulse);
+			body_a->_velocity -= impulse.scale_result(inv_mass_a);
+			body_b->_velocity += impulse.scale_result(inv_mass_b);
+		}
+	}
+
+	build_solver_batches();
+
+	// Sequential impulses: each point pushes the bodies apart until they stop approaching.
+	// Accumulated impulses are clamped rather than each increment, so later iterations
+	// can take back impulse applied by earlier ones. Batches run one after another, but
+	// the manifolds within a batch share no dynamic bodies and are solved in parallel.
+	for (int iteration = 0; iteration < _solver_iterations; ++iteration)
 	{
-		float pen_a = info->_penetration * percentage_a + k_nudge;
-		body_a->_transform.set_translation(body_a->_transform.get_translation() - body_a->_velocity.normal().scale_result(pen_a));
+		for (int color = 0; color <= k_max_solver_colors; ++color)
+		{
+			solve_batch(color, solve_velocity);
+		}
+	}
+
+	// Push the bodies out of penetration, split by inverse mass. Like the velocity pass this
+	// runs sequentially over several iterations, tracking how far each body has already been
+	// moved, so corrections propagate through stacks. A little overlap is left in place so
+	// the contact persists and keeps its cached impulses.
+	for (int m = 0; m < _contacts.get_count(); ++m)
+	{
+		ga_contact_manifold* manifold = _contacts.get_manifold(m);
+		manifold->_start_position_a = manifold->_body_a->_transform.get_translation();
+		manifold->_start_position_b = manifold->_body_b->_transform.get_translation();
+	}
+
+	for (int iteration = 0; iteration < k_position_iterations; ++iteration)
+	{
+		for (int color = 0; color <= k_max_solver_colors; ++color)
+		{
+			solve_batch(color, solve_position);
+		}
 	}
-	if ((body_b->_flags & k_static) == 0 && body_b->_velocity.mag2() > 0.0f)
+}
+
+void ga_physics_world::build_solver_batches()
+{
+	for (int i = 0; i < _bodies.size(); ++i)
 	{
-		float pen_b = info->_penetration * percentage_b + k_nudge;
-		body_b->_transform.set_translation(body_b->_transform.get_translation() - body_b->_velocity.normal().scale_result(pen_b));
+		_bodies[i]->_solver_colors = 0;
 	}
 
-	// Average the coefficients of restitution.
-	float cor_average = (body_a->_coefficient_of_restitution + body_b->_coefficient_of_restitution) / 2.0f;
+	// Greedily color the manifolds so no dynamic body appears twice in a color.
+	// Static bodies are never written by the solver, so they may be shared freely.
+	// Manifolds that run out of colors land in a final batch that is solved serially.
+	int color_sizes[k_max_solver_colors + 1] = {};
+	_solver_manifold_colors.resize(_contacts.get_count());
+	for (int m = 0; m < _contacts.get_count(); ++m)
+	{
+		ga_contact_manifold* manifold = _contacts.get_manifold(m);
+		ga_rigid_body* body_a = manifold->_body_a;
+		ga_rigid_body* body_b = manifold->_body_b;
+
+		bool dynamic_a = (body_a->_flags & k_static) == 0;
+		bool dynamic_b = (body_b->_flags & k_static) == 0;
+		if (manifold->_last_touched_step != _step_index || (!dynamic_a && !dynamic_b))
+		{
+			_solver_manifold_colors[m] = -1;
+			continue;
+		}
+
+		uint64_t used = (dynamic_a ? body_a->_solver_colors : 0) | (dynamic_b ? body_b->_solver_colors : 0);
+		int color = 0;
+		while (color < k_max_solver_colors && (used & (uint64_t(1) << color)) != 0)
+		{
+			++color;
+		}
+
+		if (color < k_max_solver_colors)
+		{
+			if (dynamic_a) body_a->_solver_colors |= uint64_t(1) << color;
+			if (dynamic_b) body_b->_solver_colors |= uint64_t(1) << color;
+		}
+
+		_solver_manifold_colors[m] = color;
+		++color_sizes[color];
+	}
 
-	ga_vec3f n = info->_normal;
-	ga_vec3f v1 = body_a->_velocity;
-	ga_vec3f v2 = body_b->_velocity;
-	float m1 = body_a->_mass;
-	float m2 = body_b->_mass;
+	// Counting sort the manifolds by color.
+	int offset = 0;
+	for (int color = 0; color <= k_max_solver_colors; ++color)
+	{
+		_solver_batch_starts[color] = offset;
+		offset += color_sizes[color];
+		color_sizes[color] = _solver_batch_starts[color];
+	}
+	_solver_batch_starts[k_max_solver_colors + 1] = offset;
 
-	if (body_a->_flags & k_static) // Body A is static
+	_solver_batch_manifolds.resize(offset);
+	for (int m = 0; m < _contacts.get_count(); ++m)
 	{
-		ga_vec3f impulse = n.scale_result(
-			-(1 + cor_average) * m2 * v2.dot(n));
+		int color = _solver_manifold_colors[m];
+		if (color >= 0)
+		{
+			_solver_batch_manifolds[color_sizes[color]++] = m;
+		}
+	}
+}
+
+void ga_physics_world::solve_batch(int color, contact_solve_func_t func)
+{
+	int begin = _solver_batch_starts[color];
+	int end = _solver_batch_starts[color + 1];
+	int count = end - begin;
 
-		ga_vec3f a2 = impulse.scale_result(1.0f / m2);
-		body_b->_velocity = v2 + a2;
+	// Small batches aren't worth the dispatch, and the overflow batch may share bodies.
+	if (count < k_min_parallel_batch_size || color == k_max_solver_colors)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			func(_contacts.get_manifold(_solver_batch_manifolds[i]));
+		}
+		return;
 	}
-	else if (body_b->_flags & k_static) // Body B is static
+
+	struct solve_data_t
+	{
+		ga_physics_world* _world;
+		contact_solve_func_t _func;
+		int _begin;
+		int _end;
+	};
+
+	ga_job_decl_t decls[k_max_solver_jobs];
+	solve_data_t solve_data[k_max_solver_jobs];
+
+	int job_count = ga_min((count + k_min_parallel_batch_size - 1) / k_min_parallel_batch_size, k_max_solver_jobs);
+	int per_job = (count + job_count - 1) / job_count;
+	for (int j = 0; j < job_count; ++j)
 	{
-		ga_vec3f impulse = n.scale_result(
-			-(1 + cor_average) * m1 * v1.dot(n));
+		solve_data[j]._world = this;
+		solve_data[j]._func = func;
+		solve_data[j]._begin = begin + j * per_job;
+		solve_data[j]._end = ga_min(begin + (j + 1) * per_job, end);
+
+		decls[j]._data = solve_data + j;
+		decls[j]._name = "physics solve";
 
-		ga_vec3f a1 = impulse.scale_result(1.0f / m1);
-		body_a->_velocity = v1 + a1;
+		// The step can't go on until every batch is solved, so don't queue them behind other work.
+		decls[j]._priority = k_job_priority_critical;
+		decls[j]._entry = [](void* data)
+		{
+			auto solve_data = static_cast<solve_data_t*>(data);
+			ga_physics_world* world = solve_data->_world;
+			for (int i = solve_data->_begin; i < solve_data->_end; ++i)
+			{
+				solve_data->_func(world->_contacts.get_manifold(world->_solver_batch_manifolds[i]));
+			}
+		};
 	}
-	else
+
+	ga_job_counter_t solve_counter;
+	ga_job::run(decls, job_count, &solve_counter);
+	ga_job::wait(&solve_counter);
+}
+
+void ga_physics_world::solve_velocity(ga_contact_manifold* manifold)
+{
+	ga_rigid_body* body_a = manifold->_body_a;
+	ga_rigid_body* body_b = manifold->_body_b;
+	float inv_mass_a = (body_a->_flags & k_static) ? 0.0f : 1.0f / body_a->_mass;
+	float inv_mass_b = (body_b->_flags & k_static) ? 0.0f : 1.0f / body_b->_mass;
+
+	for (int p = 0; p < manifold->_point_count; ++p)
 	{
-		ga_vec3f impulse = n.scale_result(
-			((1 + cor_average) * (v2.dot(n) - v1.dot(n))) /
-			(1.0f / m1 + 1.0f / m2));
+		ga_contact_point& point = manifold->_points[p];
 
-		ga_vec3f a1 = impulse.scale_result(1.0f / m1);
-		ga_vec3f a2 = -impulse.scale_result(1.0f / m2);
-		body_a->_velocity = v1 + a1;
-		body_b->_velocity = v2 + a2;
+		float normal_velocity = (body_b->_velocity - body_a->_velocity).dot(manifold->_normal);
+		float lambda = point._normal_mass * (-normal_velocity + point._velocity_bias);
+
+		float old_impulse = point._normal_impulse;
+		point._normal_impulse = ga_max(old_impulse + lambda, 0.0f);
+		lambda = point._normal_impulse - old_impulse;
+
+		// Static bodies may be shared across a batch, so they must not be written.
+		ga_vec3f impulse = manifold->_normal.scale_result(lambda);
+		if (inv_mass_a > 0.0f) body_a->_velocity -= impulse.scale_result(inv_mass_a);
+		if (inv_mass_b > 0.0f) body_b->_velocity += impulse.scale_result(inv_mass_b);
 	}
 }
 
+void ga_physics_world::solve_position(ga_contact_manifold* manifold)
+{
+	ga_rigid_body* body_a = manifold->_body_a;
+	ga_rigid_body* body_b = manifold->_body_b;
+	float inv_mass_a = (body_a->_flags & k_static) ? 0.0f : 1.0f / body_a->_mass;
+	float inv_mass_b = (body_b->_flags & k_static) ? 0.0f : 1.0f / body_b->_mass;
+	float inv_mass_sum = inv_mass_a + inv_mass_b;
+
+	float penetration = 0.0f;
+	for (int p = 0; p < manifold->_point_count; ++p)
+	{
+		penetration = ga_max(penetration, manifold->_points[p]._penetration);
+	}
+
+	ga_vec3f position_a = body_a->_transform.get_translation();
+	ga_vec3f position_b = body_b->_transform.get_translation();
+	ga_vec3f moved = (position_b - manifold->_start_position_b) - (position_a - manifold->_start_position_a);
+	penetration -= moved.dot(manifold->_normal);
+
+	float correction = ga_max(penetration - k_penetration_slop, 0.0f) * k_penetration_correction / inv_mass_sum;
+	ga_vec3f offset = manifold->_normal.scale_result(correction);
+	if (inv_mass_a > 0.0f) body_a->_transform.set_translation(position_a - offset.scale_result(inv_mass_a));
+	if (inv_mass_b > 0.0f) body_b->_transform.set_translation(position_b + offset.scale_result(inv_mass_b));
+}
@@ -10,17 +10,44 @@
 */
 
 #include "math/ga_vec3f.h"
+#include "ga_contact_cache.h"
 #include "ga_intersection.h"
+#include "ga_mesh_export.h"
+#include "ga_physics_pool.h"
+#include "ga_physics_snapshot.h"
+#include "ga_shape.h"
 
 #include <atomic>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 //#define GA_PHYSICS_DEBUG_DRAW
 
 struct ga_collision_info;
+class ga_physics_recording;
 class ga_rigid_body;
 struct ga_frame_params;
 
+enum ga_force_field_t
+{
+	// Uniform acceleration, scaled by each body's mass (e.g. gravity).
+	// Weightless bodies are not affected.
+	k_force_field_acceleration,
+	// Uniform force applied equally to every dynamic body (e.g. wind).
+	k_force_field_force,
+};
+
+/*
+** A world-wide field applied to every dynamic body each step.
+** Fields are summed once per step rather than pushed onto each body.
+*/
+struct ga_force_field
+{
+	ga_force_field_t _type;
+	ga_vec3f _vector;
+};
+
 /*
 ** Represents the physics simulation environment.
 ** Tracks all rigid bodies and dispatches the physics and collision simulations.
@@ -31,28 +58,223 @@ public:
 	ga_physics_world();
 	~ga_physics_world();
 
+	/*
+	** Added bodies show up in queries after the next step or publish_snapshot.
+	** Removal publishes right away and waits out any query still using the body,
+	** so the body and its shape can be deleted as soon as it returns.
+	**
+	** The step doesn't hold the body list locked while it waits on its solver jobs,
+	** so jobs run meanwhile can still call these. Bodies added or removed during a
+	** step join or leave the world when it ends. A body removed during a step must
+	** not be deleted until the step returns.
+	*/
 	void add_rigid_body(ga_rigid_body* body);
 	void remove_rigid_body(ga_rigid_body* body);
 	void remove_all_rigid_bodies();
 
+	/*
+	** Create a body in the world's pool, to be set up and then added, or remove an
+	** added one and destroy it. Pooled bodies sit in cache aligned slabs in the
+	** order they were made, so the step walks them forward through memory instead
+	** of chasing scattered heap objects. Any left when the world is destroyed go
+	** with it. Destroying during a step waits for the step to end.
+	*/
+	ga_rigid_body* create_rigid_body(ga_shape* shape, float mass);
+	void destroy_rigid_body(ga_rigid_body* body);
+
+	/*
+	** Advance the simulation by the frame's delta time.
+	** In fixed timestep mode this runs zero or more fixed substeps, and writes the
+	** fraction of a substep left over to the frame params for render interpolation.
+	*/
 	void step(ga_frame_params* params);
+
+	/*
+	** Queries run against the last published snapshot, so they're safe to call from
+	** any thread, even while the world is stepping.
+	*/
 	bool raycast_all(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir,
 		std::vector<ga_raycast_hit_info>* hit_info, float max_dist=10000);
 
-	std::vector<ga_vec3f> get_mesh_corners(float away_dist=0);
+	/*
+	** Whether the point lies inside or on any box, sphere or capsule. Planes are
+	** ignored.
+	*/
+	bool point_in_any_solid(const ga_vec3f& point);
+
+	/*
+	** Overlap and sweep queries into caller buffers. See ga_physics_snapshot.
+	*/
+	int overlap_point(const ga_vec3f& point, ga_rigid_body** results, int capacity);
+	int overlap_sphere(const ga_vec3f& center, float radius, ga_rigid_body** results, int capacity);
+	int overlap_box(const ga_oobb& box, const ga_mat4f& transform, ga_rigid_body** results, int capacity);
+	int sweep_sphere(const ga_vec3f& origin, const ga_vec3f& dir, float radius, float max_dist,
+		ga_raycast_hit_info* hits, int capacity);
+
+	/*
+	** Corners and edges of every static box, in world space. Each body's share is
+	** computed once and kept until static bodies are added, removed or moved, so
+	** callers needn't cache it themselves. An export is never changed once returned:
+	** a rebuild makes a new one, and callers keep theirs for as long as they hold it.
+	** While the world is stepping, the last export built is returned.
+	*/
+	std::shared_ptr<const ga_mesh_export> get_static_mesh_export();
+
+	/*
+	** Pin the most recently published snapshot for a batch of queries. Lock free, and
+	** never blocks or is blocked by a step. Pair every acquire with a release.
+	*/
+	const ga_physics_snapshot* acquire_snapshot() const;
+	void release_snapshot(const ga_physics_snapshot* snapshot) const;
+
+	/*
+	** Publish the current state of the bodies to queries. Every step does this; call
+	** it to make newly added bodies visible before the next step. During a step this
+	** does nothing, since the step publishes when it ends.
+	*/
+	void publish_snapshot();
+
+	/*
+	** Add a force field to the world. Returns a handle for later updates and removal,
+	** or -1 if all field slots are in use. Gravity is added by default.
+	*/
+	int add_force_field(const ga_force_field& field);
+	void set_force_field(int handle, const ga_force_field& field);
+	void remove_force_field(int handle);
+	int get_gravity_field() const { return _gravity_field; }
+
+	/*
+	** Number of velocity iterations the contact solver runs each step.
+	*/
+	void set_solver_iterations(int iterations) { _solver_iterations = iterations; }
+
+	/*
+	** Step at a fixed rate rather than once per frame with the frame's delta time.
+	** Frame time is accumulated and consumed in substeps of 1/hz seconds, at most
+	** max_substeps per frame; any backlog beyond that is dropped. Pass 0 hz to go
+	** back to stepping once per frame.
+	*/
+	void set_fixed_timestep(float hz, int max_substeps);
+	int get_last_substep_count() const { return _last_substep_count; }
+
+	/*
+	** Capture every step into the recording until recording stops. The contact cache is
+	** cleared first, so the recording doesn't depend on impulses from before it.
+	** Bodies must not be added or removed while recording.
+	*/
+	void start_recording(ga_physics_recording* recording);
+	void stop_recording();
+
+	/*
+	** Number of heap allocations made during the last call to step.
+	** Always zero unless built with GA_TRACK_ALLOCATIONS.
+	*/
+	uint64_t get_last_step_allocation_count() const { return _last_step_allocation_count; }
 
 private:
 	std::vector<ga_rigid_body*> _bodies;
 	std::atomic_flag _bodies_lock = ATOMIC_FLAG_INIT;
 
-	ga_vec3f _gravity;
+	// Set while a step runs with the lock released. The body list then stays as it
+	// is, and adds and removes wait here until the step ends.
+	bool _stepping = false;
+	std::vector<ga_rigid_body*> _added_bodies;
+	std::vector<ga_rigid_body*> _removed_bodies;
+	std::vector<ga_rigid_body*> _destroyed_bodies;
+
+	// Bodies made by create_rigid_body. Guarded by the bodies lock.
+	ga_physics_pool<ga_rigid_body> _body_pool;
+
+	static const int k_max_force_fields = 8;
+	ga_force_field _force_fields[k_max_force_fields];
+	bool _force_field_used[k_max_force_fields];
+	int _gravity_field;
+
+	uint64_t _last_step_allocation_count = 0;
+
+	ga_physics_recording* _recording = nullptr;
+
+	// Query snapshots. One is published; the others are being written or still held
+	// by readers from an earlier step. Only written while holding the bodies lock.
+	static const int k_snapshot_count = 3;
+	ga_physics_snapshot _snapshots[k_snapshot_count];
+	std::atomic<int> _published_snapshot{ 0 };
+
+	void write_snapshot();
+	void wait_for_snapshot_readers();
+
+	// Cached static mesh export, and the static bodies and transforms it was built
+	// from, in body order, with each one's range of corners and edges.
+	struct mesh_export_source
+	{
+		const ga_rigid_body* _body;
+		const ga_shape* _shape;
+		ga_mat4f _transform;
+		int _first_corner;
+		int _first_edge;
+		int _corner_count;
+		int _edge_count;
+	};
+	std::shared_ptr<const ga_mesh_export> _mesh_export = std::make_shared<ga_mesh_export>();
+	std::vector<mesh_export_source> _mesh_export_sources;
+
+	bool is_mesh_export_current() const;
+	void rebuild_mesh_export();
+
+	// Contacts persist across steps so the solver can be warm started.
+	ga_contact_cache _contacts;
+	uint32_t _step_index = 0;
+	int _solver_iterations = 8;
+
+	// Fixed timestep state. A zero timestep steps once per frame.
+	float _fixed_timestep = 0.0f;
+	int _max_substeps = 1;
+	float _time_accumulator = 0.0f;
+	int _last_substep_count = 0;
+
+	// Simulation islands: dynamic bodies connected through contacts, stored as a
+	// union-find forest over body indices. Rebuilt every step.
+	std::vector<int> _island_parent;
+	std::vector<float> _island_sleep_timer;
+
+	void save_previous_transforms();
+	void simulate(ga_frame_params* params, float dt, bool should_resolve);
+
+	void step_linear_dynamics(float dt, ga_rigid_body* body, const ga_vec3f& field_acceleration, const ga_vec3f& field_force);
+	void step_angular_dynamics(float dt, ga_rigid_body* body);
+	void sweep_fast_bodies();
+
+	// Body indices bucketed by shape type, and world space bounding spheres by
+	// body index. Rebuilt every step.
+	std::vector<int> _shape_buckets[k_shape_count];
+	std::vector<ga_bounding_sphere> _bounding_spheres;
+
+	struct bucket_tester;
+
+	void test_intersections(ga_frame_params* params, bool should_resolve);
+	template<typename A, typename B> void test_bucket(ga_frame_params* params, bool should_resolve);
+	void on_collision(ga_frame_params* params, bool should_resolve, int i, int j, ga_collision_info* info);
+
+	int find_island(int body_index);
+	void merge_islands(int body_index_a, int body_index_b);
+	void update_sleeping(float dt);
+
+	void solve_contacts();
+
+	// Solver batches: touched manifolds sorted by graph color. The last color holds
+	// manifolds that didn't fit in any other and is always solved serially.
+	static const int k_max_solver_colors = 64;
+	typedef void (*contact_solve_func_t)(ga_contact_manifold* manifold);
 
-	void step_linear_dynamics(ga_frame_params* params, ga_rigid_body* body);
-	void step_angular_dynamics(ga_frame_params* params, ga_rigid_body* body);
+	std::vector<int> _solver_manifold_colors;
+	std::vector<int> _solver_batch_manifolds;
+	int _solver_batch_starts[k_max_solver_colors + 2];
 
-	void test_intersections(ga_frame_params* params);
+	void build_solver_batches();
+	void solve_batch(int color, contact_solve_func_t func);
+	static void solve_velocity(ga_contact_manifold* manifold);
+	static void solve_position(ga_contact_manifold* manifold);
 
-	void resolve_collision(ga_rigid_body* body_a, ga_rigid_body* body_b, ga_collision_info* info);
-	
+	friend class ga_physics_recording;
 };
 
@@ -0,0 +1,1317 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_physics_world.tests.h"
+#include "ga_physics_world.h"
+
+#include "ga_physics_pool.h"
+#include "ga_physics_recording.h"
+#include "ga_rigid_body.h"
+#include "ga_shape.h"
+#include "ga_shape_dispatch.h"
+#include "ga_static_geometry_optimizer.h"
+
+#include "framework/ga_frame_params.h"
+#include "jobs/ga_job.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <thread>
+#include <vector>
+
+void ga_physics_world_unit_tests()
+{
+	// Test force fields and allocation-free stepping.
+	{
+		ga_physics_world world;
+
+		ga_plane floor_plane;
+		floor_plane._point = { 0.0f, 0.0f, 0.0f };
+		floor_plane._normal = { 0.0f, 1.0f, 0.0f };
+		ga_rigid_body floor(&floor_plane, 0.0f);
+		floor.make_static();
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector();
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+		ga_rigid_body box(&box_oobb, 2.0f);
+		ga_mat4f box_transform;
+		box_transform.make_translation({ 0.0f, 3.0f, 0.0f });
+		box.set_transform(box_transform);
+		box.add_linear_velocity({ 0.0f, -1.0f, 0.0f });
+
+		ga_rigid_body balloon(&box_oobb, 1.0f);
+		ga_mat4f balloon_transform;
+		balloon_transform.make_translation({ 10.0f, 5.0f, 0.0f });
+		balloon.set_transform(balloon_transform);
+		balloon.make_weightless();
+
+		world.add_rigid_body(&floor);
+		world.add_rigid_body(&box);
+		world.add_rigid_body(&balloon);
+
+		ga_force_field wind;
+		wind._type = k_force_field_force;
+		wind._vector = { 1.0f, 0.0f, 0.0f };
+		int wind_field = world.add_force_field(wind);
+		assert(wind_field >= 0);
+
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(10);
+
+		// Let the box land and settle, then every following step must be allocation free.
+		for (int i = 0; i < 300; ++i)
+		{
+			world.step(&params);
+		}
+		for (int i = 0; i < 100; ++i)
+		{
+			world.step(&params);
+			assert(world.get_last_step_allocation_count() == 0);
+		}
+
+		// The weightless balloon is pushed by wind but ignores gravity.
+		assert(balloon.get_linear_velocity().x > 0.0f);
+		assert(ga_equalf(balloon.get_linear_velocity().y, 0.0f));
+
+		// The box has come to rest on the floor.
+		assert(box.get_transform().get_translation().y > 0.0f);
+
+		world.remove_force_field(wind_field);
+		world.remove_all_rigid_bodies();
+	}
+
+	// Test that torque spins a body through its inertia tensor, taken in world space.
+	{
+		ga_physics_world world;
+
+		// Two units wide, four tall and two deep: I_xx = 5 and I_yy = 2 for a mass of 3.
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector().scale_result(2.0f);
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+
+		ga_rigid_body box(&box_oobb, 3.0f);
+		box.make_weightless();
+		world.add_rigid_body(&box);
+
+		// Lying on its side, the long axis is along world x, so spinning about x
+		// uses I_yy.
+		ga_rigid_body lying_box(&box_oobb, 3.0f);
+		lying_box.make_weightless();
+		ga_quatf lying_rotation;
+		lying_rotation.make_axis_angle(ga_vec3f::z_vector(), ga_degrees_to_radians(90.0f));
+		ga_mat4f lying_transform;
+		lying_transform.make_rotation(lying_rotation);
+		lying_transform.translate({ 10.0f, 0.0f, 0.0f });
+		lying_box.set_transform(lying_transform);
+		world.add_rigid_body(&lying_box);
+
+		box.add_torque({ 1.0f, 0.0f, 0.0f });
+		lying_box.add_torque({ 1.0f, 0.0f, 0.0f });
+
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(10);
+		world.step(&params);
+
+		assert(ga_absf(box.get_angular_velocity().x - 0.01f / 5.0f) < 0.00001f);
+		assert(ga_absf(box.get_angular_velocity().y) < 0.00001f);
+		assert(ga_absf(lying_box.get_angular_velocity().x - 0.01f / 2.0f) < 0.00001f);
+		assert(ga_absf(lying_box.get_angular_velocity().z) < 0.00001f);
+
+		// The torque was used up, so the spin holds without it.
+		world.step(&params);
+		assert(ga_absf(box.get_angular_velocity().x - 0.01f / 5.0f) < 0.00001f);
+
+		world.remove_all_rigid_bodies();
+	}
+
+	// Test that a torque turns the body: one step's kick about y gives a spin of one
+	// radian a second, so a hundred 10ms steps turn it a radian.
+	{
+		ga_physics_world world;
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector().scale_result(2.0f);
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+
+		ga_rigid_body box(&box_oobb, 3.0f);
+		box.make_weightless();
+		ga_mat4f transform;
+		transform.make_translation({ 1.0f, 2.0f, 3.0f });
+		box.set_transform(transform);
+		world.add_rigid_body(&box);
+
+		box.add_torque({ 0.0f, 200.0f, 0.0f });
+
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(10);
+		for (int i = 0; i < 100; ++i)
+		{
+			world.step(&params);
+		}
+
+		// Spinning about +y carries the x axis toward -z.
+		const ga_mat4f& turned = box.get_transform();
+		assert(ga_absf(turned.data[0][0] - ga_cosf(1.0f)) < 0.001f);
+		assert(ga_absf(turned.data[0][1]) < 0.001f);
+		assert(ga_absf(turned.data[0][2] + ga_sinf(1.0f)) < 0.001f);
+		assert(ga_absf(turned.data[1][1] - 1.0f) < 0.001f);
+		assert(turned.get_translation() == ga_vec3f({ 1.0f, 2.0f, 3.0f }));
+
+		// The rows stay orthonormal.
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				float dot = turned.data[i][0] * turned.data[j][0] + turned.data[i][1] * turned.data[j][1] +
+					turned.data[i][2] * turned.data[j][2];
+				assert(ga_absf(dot - (i == j ? 1.0f : 0.0f)) < 0.0001f);
+			}
+		}
+
+		world.remove_all_rigid_bodies();
+	}
+
+	// Test that resting islands fall asleep and wake on impulses.
+	{
+		ga_physics_world world;
+
+		ga_plane floor_plane;
+		floor_plane._point = { 0.0f, 0.0f, 0.0f };
+		floor_plane._normal = { 0.0f, 1.0f, 0.0f };
+		ga_rigid_body floor(&floor_plane, 0.0f);
+		floor.make_static();
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector();
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+		ga_rigid_body box(&box_oobb, 1.0f);
+		ga_mat4f box_transform;
+		box_transform.make_translation({ 0.0f, 1.5f, 0.0f });
+		box.set_transform(box_transform);
+
+		world.add_rigid_body(&floor);
+		world.add_rigid_body(&box);
+
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(10);
+
+		for (int i = 0; i < 500 && !box.is_sleeping(); ++i)
+		{
+			world.step(&params);
+		}
+		assert(box.is_sleeping());
+
+		// Sleeping bodies don't move.
+		ga_vec3f rest_position = box.get_transform().get_translation();
+		world.step(&params);
+		assert(box.get_transform().get_translation().equal(rest_position));
+
+		box.add_linear_velocity({ 0.0f, 5.0f, 0.0f });
+		assert(!box.is_sleeping());
+		world.step(&params);
+		assert(box.get_transform().get_translation().y > rest_position.y);
+
+		world.remove_all_rigid_bodies();
+	}
+
+	// Test that a stack of boxes stays stable at a large timestep.
+	{
+		ga_physics_world world;
+
+		ga_plane floor_plane;
+		floor_plane._point = { 0.0f, 0.0f, 0.0f };
+		floor_plane._normal = { 0.0f, 1.0f, 0.0f };
+		ga_rigid_body floor(&floor_plane, 0.0f);
+		floor.make_static();
+		world.add_rigid_body(&floor);
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector();
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+
+		const int k_stack_height = 4;
+		ga_rigid_body* boxes[k_stack_height];
+		for (int i = 0; i < k_stack_height; ++i)
+		{
+			boxes[i] = new ga_rigid_body(&box_oobb, 1.0f);
+			ga_mat4f box_transform;
+			box_transform.make_translation({ 0.0f, 1.0f + i * 2.0f, 0.0f });
+			boxes[i]->set_transform(box_transform);
+			world.add_rigid_body(boxes[i]);
+		}
+
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(33);
+		for (int i = 0; i < 150; ++i)
+		{
+			world.step(&params);
+		}
+
+		for (int i = 0; i < k_stack_height; ++i)
+		{
+			float y = boxes[i]->get_transform().get_translation().y;
+			assert(ga_absf(y - (1.0f + i * 2.0f)) < 0.1f);
+			assert(boxes[i]->is_sleeping());
+		}
+
+		world.remove_all_rigid_bodies();
+		for (int i = 0; i < k_stack_height; ++i)
+		{
+			delete boxes[i];
+		}
+	}
+
+	// Test that many independent stacks, enough to be solved in parallel batches, all settle.
+	{
+		ga_physics_world world;
+
+		ga_plane floor_plane;
+		floor_plane._point = { 0.0f, 0.0f, 0.0f };
+		floor_plane._normal = { 0.0f, 1.0f, 0.0f };
+		ga_rigid_body floor(&floor_plane, 0.0f);
+		floor.make_static();
+		world.add_rigid_body(&floor);
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector();
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+
+		const int k_grid_size = 8;
+		const int k_stack_height = 2;
+		std::vector<ga_rigid_body*> boxes;
+		for (int x = 0; x < k_grid_size; ++x)
+		{
+			for (int z = 0; z < k_grid_size; ++z)
+			{
+				for (int i = 0; i < k_stack_height; ++i)
+				{
+					ga_rigid_body* box = new ga_rigid_body(&box_oobb, 1.0f);
+					ga_mat4f box_transform;
+					box_transform.make_translation({ x * 3.0f, 1.0f + i * 2.0f, z * 3.0f });
+					box->set_transform(box_transform);
+					world.add_rigid_body(box);
+					boxes.push_back(box);
+				}
+			}
+		}
+
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(33);
+		for (int i = 0; i < 150; ++i)
+		{
+			world.step(&params);
+		}
+
+		for (int i = 0; i < boxes.size(); ++i)
+		{
+			float y = boxes[i]->get_transform().get_translation().y;
+			assert(ga_absf(y - (1.0f + (i % k_stack_height) * 2.0f)) < 0.1f);
+			assert(boxes[i]->is_sleeping());
+		}
+
+		world.remove_all_rigid_bodies();
+		for (int i = 0; i < boxes.size(); ++i)
+		{
+			delete boxes[i];
+		}
+	}
+
+	// Test that jobs run while the step waits on its solver jobs can add, remove and
+	// query bodies. The main thread runs its own jobs from inside that wait, so one
+	// spinning on the body list would never let the step finish.
+	{
+		ga_physics_world world;
+
+		ga_plane floor_plane;
+		floor_plane._point = { 0.0f, 0.0f, 0.0f };
+		floor_plane._normal = { 0.0f, 1.0f, 0.0f };
+		ga_rigid_body floor(&floor_plane, 0.0f);
+		floor.make_static();
+		world.add_rigid_body(&floor);
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector();
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+
+		// Enough resting boxes that their floor contacts are solved in parallel.
+		const int k_grid_size = 8;
+		std::vector<ga_rigid_body*> boxes;
+		for (int x = 0; x < k_grid_size; ++x)
+		{
+			for (int z = 0; z < k_grid_size; ++z)
+			{
+				ga_rigid_body* box = new ga_rigid_body(&box_oobb, 1.0f);
+				ga_mat4f box_transform;
+				box_transform.make_translation({ x * 3.0f, 1.0f, z * 3.0f });
+				box->set_transform(box_transform);
+				world.add_rigid_body(box);
+				boxes.push_back(box);
+			}
+		}
+
+		ga_rigid_body extra(&box_oobb, 1.0f);
+		ga_mat4f extra_transform;
+		extra_transform.make_translation({ 100.0f, 1.0f, 100.0f });
+		extra.set_transform(extra_transform);
+		extra.make_static();
+
+		struct step_job_t
+		{
+			ga_physics_world* _world;
+			ga_rigid_body* _body;
+		};
+		step_job_t step_job = { &world, &extra };
+
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(16);
+		world.step(&params);
+
+		ga_job_decl_t add_decl;
+		add_decl._entry = [](void* data)
+		{
+			step_job_t* job = static_cast<step_job_t*>(data);
+			job->_world->add_rigid_body(job->_body);
+			job->_world->publish_snapshot();
+			job->_world->get_static_mesh_export();
+		};
+		add_decl._data = &step_job;
+		add_decl._main_thread_only = true;
+		ga_job_counter_t add_counter;
+		ga_job::run(&add_decl, 1, &add_counter);
+		world.step(&params);
+		ga_job::wait(&add_counter);
+
+		ga_rigid_body* found[2];
+		world.publish_snapshot();
+		assert(world.overlap_point({ 100.0f, 1.0f, 100.0f }, found, 2) == 1 && found[0] == &extra);
+
+		ga_job_decl_t remove_decl;
+		remove_decl._entry = [](void* data)
+		{
+			step_job_t* job = static_cast<step_job_t*>(data);
+			job->_world->remove_rigid_body(job->_body);
+		};
+		remove_decl._data = &step_job;
+		remove_decl._main_thread_only = true;
+		ga_job_counter_t remove_counter;
+		ga_job::run(&remove_decl, 1, &remove_counter);
+		world.step(&params);
+		ga_job::wait(&remove_counter);
+		assert(world.overlap_point({ 100.0f, 1.0f, 100.0f }, found, 2) == 0);
+
+		world.remove_all_rigid_bodies();
+		for (int i = 0; i < boxes.size(); ++i)
+		{
+			delete boxes[i];
+		}
+	}
+
+	// Test fixed timestep substepping and interpolation.
+	{
+		ga_physics_world world;
+		world.set_fixed_timestep(50.0f, 4);
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector();
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+		ga_rigid_body box(&box_oobb, 1.0f);
+		box.make_weightless();
+		box.add_linear_velocity({ 1.0f, 0.0f, 0.0f });
+		world.add_rigid_body(&box);
+
+		// Half a step accumulates without simulating.
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(10);
+		world.step(&params);
+		assert(world.get_last_substep_count() == 0);
+		assert(ga_equalf(params._physics_interpolation, 0.5f));
+		assert(ga_equalf(box.get_transform().get_translation().x, 0.0f));
+
+		// The second half completes a step.
+		world.step(&params);
+		assert(world.get_last_substep_count() == 1);
+		assert(ga_equalf(box.get_transform().get_translation().x, 0.02f));
+
+		// Rendering a quarter of the way into the next step sits between the last two.
+		params._delta_time = std::chrono::milliseconds(5);
+		world.step(&params);
+		assert(world.get_last_substep_count() == 0);
+		ga_mat4f interpolated = box.get_interpolated_transform(params._physics_interpolation);
+		assert(ga_equalf(interpolated.get_translation().x, 0.005f));
+
+		// A long frame is clamped to the maximum number of substeps.
+		params._delta_time = std::chrono::milliseconds(1000);
+		world.step(&params);
+		assert(world.get_last_substep_count() == 4);
+		assert(params._physics_interpolation < 1.0f);
+
+		world.remove_all_rigid_bodies();
+	}
+
+	// Test that the bounding sphere prefilter doesn't change raycast results, and
+	// that a sphere and a capsule come to rest on the floor.
+	{
+		ga_physics_world world;
+
+		ga_plane floor_plane;
+		floor_plane._point = { 0.0f, 0.0f, 0.0f };
+		floor_plane._normal = { 0.0f, 1.0f, 0.0f };
+		ga_rigid_body floor(&floor_plane, 0.0f);
+		floor.make_static();
+		world.add_rigid_body(&floor);
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector();
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+
+		ga_sphere sphere;
+		sphere._radius = 0.5f;
+
+		ga_capsule capsule;
+
+		const int k_wall_size = 4;
+		std::vector<ga_rigid_body*> walls;
+		std::vector<ga_shape*> wall_shapes;
+		for (int i = 0; i < k_wall_size; ++i)
+		{
+			for (int j = 0; j < k_wall_size; ++j)
+			{
+				ga_shape* shape = (i + j) % 3 == 0 ? static_cast<ga_shape*>(&sphere) : static_cast<ga_shape*>(&box_oobb);
+				ga_rigid_body* wall = new ga_rigid_body(shape, 1.0f);
+				ga_mat4f wall_transform;
+				wall_transform.make_translation({ 10.0f, 1.0f + i * 2.0f, j * 2.0f });
+				wall->set_transform(wall_transform);
+				wall->make_static();
+				world.add_rigid_body(wall);
+				walls.push_back(wall);
+				wall_shapes.push_back(shape);
+			}
+		}
+		world.publish_snapshot();
+
+		for (int i = 0; i < 200; ++i)
+		{
+			ga_vec3f origin = { 0.0f, (i % 10) * 1.0f, (i / 10) * 0.4f - 1.0f };
+			ga_vec3f target = { 10.0f, (i % 7) * 1.3f, (i % 13) * 0.6f };
+			ga_vec3f dir = (target - origin).normal();
+			float max_dist = (i % 4 == 0) ? 8.0f : 100.0f;
+
+			bool expected = false;
+			for (int k = 0; k < walls.size(); ++k)
+			{
+				float t;
+				if (ga_intersect_ray(origin, dir, wall_shapes[k], walls[k]->get_transform(), &t) && t < max_dist)
+				{
+					expected = true;
+				}
+			}
+
+			// The floor is always hit from above by rays heading down.
+			float floor_t;
+			if (ray_vs_plane(origin, dir, &floor_plane, floor.get_transform(), &floor_t) && floor_t < max_dist)
+			{
+				expected = true;
+			}
+
+			assert(world.raycast_all(origin, dir, NULL, max_dist) == expected);
+		}
+
+		ga_rigid_body ball(&sphere, 1.0f);
+		ga_mat4f ball_transform;
+		ball_transform.make_translation({ -5.0f, 2.0f, 0.0f });
+		ball.set_transform(ball_transform);
+		world.add_rigid_body(&ball);
+
+		ga_rigid_body pill(&capsule, 1.0f);
+		ga_mat4f pill_transform;
+		pill_transform.make_translation({ -5.0f, 2.0f, 5.0f });
+		pill.set_transform(pill_transform);
+		world.add_rigid_body(&pill);
+
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(16);
+		for (int i = 0; i < 200; ++i)
+		{
+			world.step(&params);
+		}
+
+		assert(ga_absf(ball.get_transform().get_translation().y - 0.5f) < 0.05f);
+		assert(ga_absf(pill.get_transform().get_translation().y - 1.0f) < 0.05f);
+		assert(ball.is_sleeping());
+		assert(pill.is_sleeping());
+
+		// A static body's shape grown after its body was created keeps being culled
+		// by its old size until the body is moved from outside, and by its new size
+		// once the world steps after that. The ray passes 2 units from the center.
+		ga_sphere growing_sphere;
+		growing_sphere._radius = 0.5f;
+		ga_rigid_body growing(&growing_sphere, 1.0f);
+		ga_mat4f growing_transform;
+		growing_transform.make_translation({ 30.0f, 5.0f, 0.0f });
+		growing.set_transform(growing_transform);
+		growing.make_static();
+		world.add_rigid_body(&growing);
+
+		ga_vec3f grow_origin = { 25.0f, 7.0f, 0.0f };
+		world.step(&params);
+		assert(!world.raycast_all(grow_origin, ga_vec3f::x_vector(), NULL, 100.0f));
+		growing_sphere._radius = 3.0f;
+		world.step(&params);
+		assert(!world.raycast_all(grow_origin, ga_vec3f::x_vector(), NULL, 100.0f));
+		growing.set_transform(growing_transform);
+		world.step(&params);
+		assert(world.raycast_all(grow_origin, ga_vec3f::x_vector(), NULL, 100.0f));
+
+		// Scaling a capsule's transform scales its radius, in the narrowphase as in the bounds.
+		ga_rigid_body scaled_pill(&capsule, 1.0f);
+		ga_mat4f scaled_transform;
+		scaled_transform.make_scaling(4.0f);
+		scaled_transform.translate({ 30.0f, 5.0f, 20.0f });
+		scaled_pill.set_transform(scaled_transform);
+		scaled_pill.make_static();
+		world.add_rigid_body(&scaled_pill);
+
+		ga_vec3f pill_origin = { 25.0f, 5.0f, 21.5f };
+		float pill_t;
+		assert(ga_intersect_ray(pill_origin, ga_vec3f::x_vector(), &capsule, scaled_pill.get_transform(), &pill_t));
+		assert(ga_absf(pill_t - (5.0f - ga_sqrtf(4.0f - 1.5f * 1.5f))) < 0.001f);
+		world.step(&params);
+		assert(world.raycast_all(pill_origin, ga_vec3f::x_vector(), NULL, 100.0f));
+
+		world.remove_all_rigid_bodies();
+		for (int i = 0; i < walls.size(); ++i)
+		{
+			delete walls[i];
+		}
+	}
+
+	// Test that merging static boxes cuts the collider count without changing which
+	// rays hit or where they first hit, using the default scene's wall and window
+	// layout. Rays pass through fewer colliders, since merged boxes stand in for
+	// several cubes.
+	{
+		std::vector<ga_vec3f> positions;
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 6; ++j)
+			{
+				positions.push_back({ 0.0f, i * 2.0f, j * -2.0f });
+			}
+			positions.push_back({ -2.0f, i * 2.0f, -8.0f });
+		}
+		positions.push_back({ -4.0f, 0.0f, -8.0f });
+		positions.push_back({ -6.0f, 0.0f, -8.0f });
+		positions.push_back({ -6.0f, 2.0f, -8.0f });
+		positions.push_back({ -6.0f, 4.0f, -8.0f });
+		positions.push_back({ -4.0f, 4.0f, -8.0f });
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector();
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+
+		auto nearest_hit = [](const std::vector<ga_raycast_hit_info>& hits)
+		{
+			float nearest = FLT_MAX;
+			for (auto& hit : hits)
+			{
+				nearest = ga_min(nearest, hit._dist);
+			}
+			return nearest;
+		};
+
+		ga_physics_world cube_world;
+		ga_physics_world merged_world;
+		ga_static_geometry_optimizer optimizer;
+		std::vector<ga_rigid_body*> cubes;
+		for (int i = 0; i < positions.size(); ++i)
+		{
+			ga_mat4f transform;
+			transform.make_translation(positions[i]);
+
+			ga_rigid_body* cube = new ga_rigid_body(&box_oobb, 1.0f);
+			cube->set_transform(transform);
+			cube->make_static();
+			cube_world.add_rigid_body(cube);
+			cubes.push_back(cube);
+
+			optimizer.add_box(box_oobb, transform);
+		}
+
+		// A rotated box can't be merged and is passed through as is.
+		ga_mat4f rotated_transform;
+		ga_quatf rotation;
+		rotation.make_axis_angle(ga_vec3f::y_vector(), 0.5f);
+		rotated_transform.make_rotation(rotation);
+		rotated_transform.translate({ 6.0f, 0.0f, 4.0f });
+		ga_rigid_body* rotated = new ga_rigid_body(&box_oobb, 1.0f);
+		rotated->set_transform(rotated_transform);
+		rotated->make_static();
+		cube_world.add_rigid_body(rotated);
+		cubes.push_back(rotated);
+		optimizer.add_box(box_oobb, rotated_transform);
+
+		optimizer.build(&merged_world);
+		cube_world.publish_snapshot();
+		merged_world.publish_snapshot();
+		assert(optimizer.get_input_count() == int(cubes.size()));
+		// The 26 cubes merge into five boxes, plus the rotated one.
+		assert(optimizer.get_output_count() == 6);
+
+		// Cast from every lattice point outside the geometry, including points level with
+		// box faces and edges. Rays starting inside can differ, since they used to stop
+		// at the faces between cubes.
+		const ga_vec3f k_directions[] =
+		{
+			{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+			{ 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+			{ 1.0f, 1.0f, 1.0f }, { -1.0f, 1.0f, -1.0f },
+			{ 1.0f, -1.0f, -1.0f }, { -1.0f, -1.0f, 1.0f },
+			{ 0.37f, 0.11f, -1.0f }, { -1.0f, 0.23f, 0.71f },
+		};
+		const int k_direction_count = sizeof(k_directions) / sizeof(k_directions[0]);
+		for (int x = -9; x <= 9; ++x)
+		{
+			for (int y = -2; y <= 6; ++y)
+			{
+				for (int z = -12; z <= 6; ++z)
+				{
+					ga_vec3f origin = { float(x), float(y), float(z) };
+					bool inside = cube_world.point_in_any_solid(origin);
+					assert(inside == merged_world.point_in_any_solid(origin));
+					if (inside) continue;
+
+					for (int d = 0; d < k_direction_count; ++d)
+					{
+						ga_vec3f dir = k_directions[d].normal();
+						float max_dist = (d % 3 == 0) ? 3.0f : 100.0f;
+						std::vector<ga_raycast_hit_info> cube_hits;
+						std::vector<ga_raycast_hit_info> merged_hits;
+						assert(cube_world.raycast_all(origin, dir, &cube_hits, max_dist) ==
+							merged_world.raycast_all(origin, dir, &merged_hits, max_dist));
+						assert(merged_hits.size() <= cube_hits.size());
+						assert(ga_absf(nearest_hit(cube_hits) - nearest_hit(merged_hits)) < 0.001f);
+					}
+				}
+			}
+		}
+
+		cube_world.remove_all_rigid_bodies();
+		merged_world.remove_all_rigid_bodies();
+		for (int i = 0; i < cubes.size(); ++i)
+		{
+			delete cubes[i];
+		}
+	}
+
+	// Test that scattered boxes on unaligned coordinates merge group by group. A
+	// grid over all of them would have billions of cells. Boxes that merging can't
+	// reduce, like two crossing bars, are kept as given.
+	{
+		ga_static_geometry_optimizer optimizer;
+		ga_physics_world world;
+
+		// Pairs of boxes stacked exactly, each pair somewhere unaligned.
+		const int k_pair_count = 600;
+		uint32_t random = 12345;
+		auto next_random = [&random]() { random = random * 1664525u + 1013904223u; return float(random >> 8) / float(1 << 24); };
+		for (int i = 0; i < k_pair_count; ++i)
+		{
+			ga_vec3f center = { next_random() * 1000.0f, next_random() * 1000.0f, next_random() * 1000.0f };
+			ga_vec3f half = { 0.1f + next_random(), 0.1f + next_random(), 0.1f + next_random() };
+			ga_oobb box;
+			box._half_vectors[0] = ga_vec3f::x_vector().scale_result(half.x);
+			box._half_vectors[1] = ga_vec3f::y_vector().scale_result(half.y);
+			box._half_vectors[2] = ga_vec3f::z_vector().scale_result(half.z);
+
+			ga_mat4f transform;
+			transform.make_translation(center);
+			optimizer.add_box(box, transform);
+			transform.make_translation(center + ga_vec3f::y_vector().scale_result(2.0f * half.y));
+			optimizer.add_box(box, transform);
+		}
+
+		// Two bars crossing in a plus would split into three boxes.
+		ga_oobb bar;
+		bar._half_vectors[0] = ga_vec3f::x_vector().scale_result(3.0f);
+		bar._half_vectors[1] = ga_vec3f::y_vector().scale_result(0.5f);
+		bar._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.5f);
+		ga_mat4f bar_transform;
+		bar_transform.make_translation({ -50.0f, -50.0f, -50.0f });
+		optimizer.add_box(bar, bar_transform);
+		bar._half_vectors[0] = ga_vec3f::x_vector().scale_result(0.5f);
+		bar._half_vectors[1] = ga_vec3f::y_vector().scale_result(3.0f);
+		optimizer.add_box(bar, bar_transform);
+
+		optimizer.build(&world);
+		world.publish_snapshot();
+		assert(optimizer.get_input_count() == 2 * k_pair_count + 2);
+		assert(optimizer.get_output_count() == k_pair_count + 2);
+
+		// A ray up the plus passes through both bars, and first hits the bottom of the
+		// upright one.
+		std::vector<ga_raycast_hit_info> hits;
+		assert(world.raycast_all({ -50.0f, -60.0f, -50.0f }, ga_vec3f::y_vector(), &hits, 100.0f));
+		assert(hits.size() == 2);
+		assert(ga_absf(ga_min(hits[0]._dist, hits[1]._dist) - 7.0f) < 0.001f);
+
+		world.remove_all_rigid_bodies();
+	}
+
+	// Test that queries from other threads see consistent snapshots while the world
+	// steps and bodies come and go.
+	{
+		ga_physics_world world;
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector();
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+
+		ga_rigid_body wall(&box_oobb, 1.0f);
+		ga_mat4f wall_transform;
+		wall_transform.make_translation({ 5.0f, 0.0f, 0.0f });
+		wall.set_transform(wall_transform);
+		wall.make_static();
+		world.add_rigid_body(&wall);
+		world.publish_snapshot();
+
+		std::atomic<bool> done(false);
+		std::atomic<int> failures(0);
+		auto reader = [&]()
+		{
+			uint32_t last_epoch = 0;
+			while (!done.load())
+			{
+				// The static wall is in every snapshot.
+				if (!world.raycast_all(ga_vec3f::zero_vector(), ga_vec3f::x_vector(), NULL, 10.0f))
+				{
+					failures.fetch_add(1);
+				}
+
+				const ga_physics_snapshot* snapshot = world.acquire_snapshot();
+				if (snapshot->get_epoch() < last_epoch || snapshot->get_collider_count() < 1)
+				{
+					failures.fetch_add(1);
+				}
+				last_epoch = snapshot->get_epoch();
+				snapshot->raycast_all({ 0.0f, 10.0f, 0.0f }, ga_vec3f::x_vector(), NULL, 10.0f);
+				world.release_snapshot(snapshot);
+			}
+		};
+		std::thread readers[2] = { std::thread(reader), std::thread(reader) };
+
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(10);
+		for (int i = 0; i < 200; ++i)
+		{
+			// Bodies can be deleted as soon as they've been removed.
+			ga_oobb* falling_oobb = new ga_oobb(box_oobb);
+			ga_rigid_body* falling = new ga_rigid_body(falling_oobb, 1.0f);
+			ga_mat4f falling_transform;
+			falling_transform.make_translation({ 5.0f, 10.0f, 0.0f });
+			falling->set_transform(falling_transform);
+			world.add_rigid_body(falling);
+
+			world.step(&params);
+			world.step(&params);
+
+			world.remove_rigid_body(falling);
+			delete falling;
+			delete falling_oobb;
+		}
+
+		done.store(true);
+		readers[0].join();
+		readers[1].join();
+		assert(failures.load() == 0);
+
+		world.remove_all_rigid_bodies();
+	}
+
+	// Test overlap and sweep queries against a brute force pass over every collider.
+	{
+		ga_physics_world world;
+
+		ga_plane floor_plane;
+		floor_plane._point = { 0.0f, 0.0f, 0.0f };
+		floor_plane._normal = { 0.0f, 1.0f, 0.0f };
+		ga_rigid_body floor(&floor_plane, 0.0f);
+		floor.make_static();
+		world.add_rigid_body(&floor);
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector().scale_result(0.5f);
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+
+		ga_sphere sphere;
+		sphere._radius = 0.75f;
+
+		ga_capsule capsule;
+
+		std::vector<ga_rigid_body*> bodies;
+		std::vector<ga_shape*> shapes;
+		bodies.push_back(&floor);
+		shapes.push_back(&floor_plane);
+		for (int i = 0; i < 5; ++i)
+		{
+			for (int j = 0; j < 5; ++j)
+			{
+				ga_shape* shape = (i + j) % 3 == 0 ? static_cast<ga_shape*>(&box_oobb) :
+					(i + j) % 3 == 1 ? static_cast<ga_shape*>(&sphere) : static_cast<ga_shape*>(&capsule);
+				ga_rigid_body* body = new ga_rigid_body(shape, 1.0f);
+				ga_quatf rotation;
+				rotation.make_axis_angle(ga_vec3f::y_vector(), 0.3f * (i + j));
+				ga_mat4f transform;
+				transform.make_rotation(rotation);
+				transform.set_translation({ i * 3.0f, 1.0f + (j % 2), j * 3.0f });
+				body->set_transform(transform);
+				body->make_static();
+				world.add_rigid_body(body);
+				bodies.push_back(body);
+				shapes.push_back(shape);
+			}
+		}
+		world.publish_snapshot();
+
+		const int k_capacity = 64;
+		ga_rigid_body* results[k_capacity];
+		ga_mat4f identity;
+		identity.make_identity();
+
+		for (int i = 0; i < 300; ++i)
+		{
+			ga_vec3f point = { (i % 17) * 0.8f - 1.0f, (i % 7) * 0.5f - 0.5f, (i % 23) * 0.6f - 1.0f };
+
+			// Point.
+			int count = world.overlap_point(point, results, k_capacity);
+			int expected = 0;
+			for (int k = 0; k < bodies.size(); ++k)
+			{
+				if (ga_point_in_shape(point, shapes[k], bodies[k]->get_transform()))
+				{
+					assert(std::find(results, results + count, bodies[k]) != results + count);
+					++expected;
+				}
+			}
+			assert(count == expected);
+
+			// Sphere.
+			ga_sphere query_sphere;
+			query_sphere._center = point;
+			query_sphere._radius = 0.2f + (i % 5) * 0.3f;
+			count = world.overlap_sphere(point, query_sphere._radius, results, k_capacity);
+			expected = 0;
+			for (int k = 0; k < bodies.size(); ++k)
+			{
+				ga_collision_info info;
+				if (ga_collide(&query_sphere, identity, shapes[k], bodies[k]->get_transform(), &info))
+				{
+					assert(std::find(results, results + count, bodies[k]) != results + count);
+					++expected;
+				}
+			}
+			assert(count == expected);
+
+			// Box.
+			ga_quatf box_rotation;
+			box_rotation.make_axis_angle(ga_vec3f::x_vector(), 0.2f * i);
+			ga_mat4f box_transform;
+			box_transform.make_rotation(box_rotation);
+			box_transform.set_translation(point);
+			count = world.overlap_box(box_oobb, box_transform, results, k_capacity);
+			expected = 0;
+			for (int k = 0; k < bodies.size(); ++k)
+			{
+				ga_collision_info info;
+				if (ga_collide(&box_oobb, box_transform, shapes[k], bodies[k]->get_transform(), &info))
+				{
+					assert(std::find(results, results + count, bodies[k]) != results + count);
+					++expected;
+				}
+			}
+			assert(count == expected);
+
+			// Full buffers stop the query early.
+			assert(world.overlap_sphere(point, 100.0f, results, 3) == 3);
+		}
+
+		// Sweeps come back nearest first, and a small buffer keeps the nearest hits.
+		ga_raycast_hit_info hits[k_capacity];
+		ga_vec3f origin = { -5.0f, 0.5f, 0.0f };
+		ga_vec3f dir = ga_vec3f::x_vector();
+		int count = world.sweep_sphere(origin, dir, 0.5f, 100.0f, hits, k_capacity);
+		assert(count == 6);
+		assert(hits[0]._collider == &floor && hits[0]._dist == 0.0f);
+		for (int i = 1; i < count; ++i)
+		{
+			assert(hits[i - 1]._dist <= hits[i]._dist);
+		}
+		assert(ga_absf(hits[1]._dist - 3.5f) < 0.001f);
+		assert(hits[1]._normal.x < -0.99f);
+
+		ga_raycast_hit_info nearest[3];
+		assert(world.sweep_sphere(origin, dir, 0.5f, 100.0f, nearest, 3) == 3);
+		for (int i = 0; i < 3; ++i)
+		{
+			assert(nearest[i]._collider == hits[i]._collider);
+		}
+		assert(world.sweep_sphere(origin, dir, 0.5f, 5.0f, hits, k_capacity) == 2);
+		assert(world.sweep_sphere(origin, dir, 0.5f, 100.0f, hits, 0) == 0);
+
+		world.remove_all_rigid_bodies();
+		for (int i = 1; i < bodies.size(); ++i)
+		{
+			delete bodies[i];
+		}
+	}
+
+	// Test that fast bodies don't tunnel through a thin wall at a low tick rate,
+	// while the same bodies without the flag do.
+	{
+		ga_physics_world world;
+		world.set_fixed_timestep(30.0f, 4);
+
+		ga_oobb wall_oobb;
+		wall_oobb._half_vectors[0] = ga_vec3f::x_vector().scale_result(0.05f);
+		wall_oobb._half_vectors[1] = ga_vec3f::y_vector().scale_result(4.0f);
+		wall_oobb._half_vectors[2] = ga_vec3f::z_vector().scale_result(20.0f);
+		ga_rigid_body wall(&wall_oobb, 0.0f);
+		ga_mat4f wall_transform;
+		wall_transform.make_translation({ 5.0f, 0.0f, 0.0f });
+		wall.set_transform(wall_transform);
+		wall.make_static();
+		world.add_rigid_body(&wall);
+
+		ga_sphere ball_sphere;
+		ball_sphere._radius = 0.25f;
+
+		ga_oobb brick_oobb;
+		brick_oobb._half_vectors[0] = ga_vec3f::x_vector().scale_result(0.2f);
+		brick_oobb._half_vectors[1] = ga_vec3f::y_vector().scale_result(0.2f);
+		brick_oobb._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.2f);
+
+		ga_rigid_body* bodies[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			ga_shape* shape = i % 2 == 0 ? static_cast<ga_shape*>(&ball_sphere) : static_cast<ga_shape*>(&brick_oobb);
+			bodies[i] = new ga_rigid_body(shape, 1.0f);
+			ga_mat4f transform;
+			transform.make_translation({ 0.0f, 0.0f, i * 4.0f - 6.0f });
+			bodies[i]->set_transform(transform);
+			bodies[i]->make_weightless();
+			if (i < 2) bodies[i]->make_fast();
+			bodies[i]->add_linear_velocity({ 100.0f, 0.0f, 0.0f });
+			world.add_rigid_body(bodies[i]);
+		}
+
+		ga_frame_params params;
+		params._delta_time = std::chrono::microseconds(33334);
+		for (int i = 0; i < 10; ++i)
+		{
+			world.step(&params);
+		}
+
+		for (int i = 0; i < 4; ++i)
+		{
+			float x = bodies[i]->get_transform().get_translation().x;
+			assert(i < 2 ? x < 5.0f : x > 5.0f);
+		}
+		assert(bodies[0]->get_linear_velocity().x < 0.0f);
+		assert(bodies[1]->get_linear_velocity().x < 0.0f);
+
+		world.remove_all_rigid_bodies();
+		for (int i = 0; i < 4; ++i)
+		{
+			delete bodies[i];
+		}
+	}
+
+	// Test that a recorded run replays bit for bit in a fresh world, including inputs
+	// applied between steps.
+	{
+		ga_physics_recording recording;
+
+		ga_plane floor_plane;
+		floor_plane._point = { 0.0f, 0.0f, 0.0f };
+		floor_plane._normal = { 0.0f, 1.0f, 0.0f };
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector().scale_result(0.5f);
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector().scale_result(0.5f);
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.5f);
+
+		ga_sphere ball_sphere;
+		ball_sphere._radius = 0.3f;
+
+		ga_capsule pill_capsule;
+
+		{
+			ga_physics_world world;
+			world.set_fixed_timestep(60.0f, 4);
+
+			ga_rigid_body floor(&floor_plane, 0.0f);
+			floor.make_static();
+			world.add_rigid_body(&floor);
+
+			std::vector<ga_rigid_body*> bodies;
+			for (int i = 0; i < 12; ++i)
+			{
+				ga_shape* shape = i % 3 == 0 ? static_cast<ga_shape*>(&box_oobb) :
+					i % 3 == 1 ? static_cast<ga_shape*>(&ball_sphere) : static_cast<ga_shape*>(&pill_capsule);
+				ga_rigid_body* body = new ga_rigid_body(shape, 1.0f + i * 0.25f);
+				ga_mat4f transform;
+				transform.make_translation({ (i % 4) * 0.3f, 1.0f + i * 1.1f, (i % 3) * 0.2f });
+				body->set_transform(transform);
+				if (i == 5) body->make_fast();
+				world.add_rigid_body(body);
+				bodies.push_back(body);
+			}
+
+			// Settle for a moment before recording, so it starts mid-simulation.
+			ga_frame_params params;
+			params._delta_time = std::chrono::milliseconds(16);
+			for (int i = 0; i < 20; ++i)
+			{
+				world.step(&params);
+			}
+
+			world.start_recording(&recording);
+			for (int i = 0; i < 120; ++i)
+			{
+				if (i == 10) bodies[3]->add_linear_velocity({ 4.0f, 2.0f, 0.0f });
+				if (i == 30) bodies[5]->add_linear_velocity({ 0.0f, -40.0f, 0.0f });
+				if (i == 50)
+				{
+					ga_force_field wind;
+					wind._type = k_force_field_force;
+					wind._vector = { 1.5f, 0.0f, 0.0f };
+					world.add_force_field(wind);
+				}
+				if (i == 70)
+				{
+					ga_mat4f teleport;
+					teleport.make_translation({ 0.0f, 5.0f, 0.0f });
+					bodies[7]->set_transform(teleport);
+				}
+
+				params._delta_time = std::chrono::microseconds(9000 + (i % 5) * 3000);
+				world.step(&params);
+			}
+			world.stop_recording();
+
+			world.remove_all_rigid_bodies();
+			for (int i = 0; i < bodies.size(); ++i)
+			{
+				delete bodies[i];
+			}
+		}
+
+		assert(recording.get_body_count() == 13);
+		assert(recording.get_step_count() == 120);
+
+		ga_physics_world replay_world;
+		recording.begin_replay(&replay_world);
+		for (int i = 0; i < recording.get_step_count() - 1; ++i)
+		{
+			recording.replay_step(&replay_world, i);
+		}
+		assert(!recording.verify_replay());
+		recording.replay_step(&replay_world, recording.get_step_count() - 1);
+		assert(recording.verify_replay());
+
+		replay_world.remove_all_rigid_bodies();
+	}
+
+	// Test that pooled bodies stay put, handles go stale on destroy, and freed slots
+	// are recycled before a new slab is allocated.
+	{
+		ga_physics_allocator allocator;
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector();
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector();
+
+		const int k_body_count = 600;
+		std::vector<ga_rigid_body*> bodies;
+		std::vector<ga_oobb*> shapes;
+		std::vector<ga_physics_handle> handles;
+		for (int i = 0; i < k_body_count; ++i)
+		{
+			ga_oobb* shape = allocator.create_shape(box_oobb);
+			ga_rigid_body* body = allocator.create_rigid_body(shape, 1.0f);
+			bodies.push_back(body);
+			shapes.push_back(shape);
+			handles.push_back(allocator.get_handle(body));
+		}
+		assert(uintptr_t(bodies[0]) % 64 == 0);
+		assert(bodies[1] > bodies[0]);
+		assert(uintptr_t(bodies[1]) - uintptr_t(bodies[0]) <= sizeof(ga_rigid_body) + alignof(ga_rigid_body));
+		assert(allocator.get_rigid_body_count() == k_body_count);
+
+		for (int i = 0; i < k_body_count; ++i)
+		{
+			assert(allocator.get_rigid_body(handles[i]) == bodies[i]);
+		}
+
+		allocator.destroy_rigid_body(bodies[17]);
+		allocator.destroy_shape(shapes[17]);
+		assert(allocator.get_rigid_body(handles[17]) == nullptr);
+
+		ga_rigid_body* recycled = allocator.create_rigid_body(allocator.create_shape(box_oobb), 2.0f);
+		assert(recycled == bodies[17]);
+		assert(allocator.get_rigid_body(handles[17]) == nullptr);
+		assert(allocator.get_rigid_body(allocator.get_handle(recycled)) == recycled);
+		assert(allocator.get_rigid_body_count() == k_body_count);
+
+		allocator.clear();
+		assert(allocator.get_rigid_body_count() == 0);
+		assert(allocator.get_rigid_body(handles[0]) == nullptr);
+	}
+
+	// Test that world bodies come from the world's pool in creation order, and a body
+	// destroyed mid-simulation frees its slot for the next one.
+	{
+		ga_physics_world world;
+
+		ga_sphere ball_sphere;
+		ball_sphere._radius = 0.5f;
+
+		std::vector<ga_rigid_body*> bodies;
+		for (int i = 0; i < 300; ++i)
+		{
+			ga_rigid_body* body = world.create_rigid_body(&ball_sphere, 1.0f);
+			ga_mat4f transform;
+			transform.make_translation({ (i % 20) * 2.0f, 1.0f + (i / 20) * 2.0f, 0.0f });
+			body->set_transform(transform);
+			world.add_rigid_body(body);
+			bodies.push_back(body);
+		}
+		assert(bodies[1] > bodies[0]);
+		assert(uintptr_t(bodies[1]) - uintptr_t(bodies[0]) <= sizeof(ga_rigid_body) + alignof(ga_rigid_body));
+
+		ga_frame_params params;
+		params._delta_time = std::chrono::milliseconds(16);
+		world.step(&params);
+
+		world.destroy_rigid_body(bodies[250]);
+		world.step(&params);
+
+		ga_rigid_body* recycled = world.create_rigid_body(&ball_sphere, 2.0f);
+		assert(recycled == bodies[250]);
+		world.add_rigid_body(recycled);
+		world.step(&params);
+
+		bodies[250] = recycled;
+		for (int i = 0; i < bodies.size(); ++i)
+		{
+			world.destroy_rigid_body(bodies[i]);
+		}
+	}
+
+	// Test the static mesh export: only boxes contribute, edges carry their faces'
+	// normals, and the cache follows static bodies being added and moved.
+	{
+		ga_physics_world world;
+
+		ga_plane floor_plane;
+		floor_plane._point = { 0.0f, 0.0f, 0.0f };
+		floor_plane._normal = { 0.0f, 1.0f, 0.0f };
+		ga_rigid_body floor(&floor_plane, 0.0f);
+		floor.make_static();
+		world.add_rigid_body(&floor);
+
+		ga_oobb box_oobb;
+		box_oobb._half_vectors[0] = ga_vec3f::x_vector();
+		box_oobb._half_vectors[1] = ga_vec3f::y_vector().scale_result(2.0f);
+		box_oobb._half_vectors[2] = ga_vec3f::z_vector().scale_result(0.5f);
+		ga_rigid_body wall(&box_oobb, 1.0f);
+		ga_mat4f wall_transform;
+		wall_transform.make_translation({ 4.0f, 2.0f, 0.0f });
+		wall.set_transform(wall_transform);
+		wall.make_static();
+		world.add_rigid_body(&wall);
+
+		// Dynamic bodies aren't exported.
+		ga_rigid_body crate(&box_oobb, 1.0f);
+		world.add_rigid_body(&crate);
+
+		std::shared_ptr<const ga_mesh_export> mesh = world.get_static_mesh_export();
+		assert(mesh->_corners.size() == 8);
+		assert(mesh->_edges.size() == 12);
+		assert(mesh->_corners[0]._position == ga_vec3f({ 3.0f, 0.0f, -0.5f }));
+		assert(mesh->_corners[7]._position == ga_vec3f({ 5.0f, 4.0f, 0.5f }));
+		assert(mesh->_corners[7]._outward.dot({ 1.0f, 4.0f, 0.5f }) > 0.0f);
+
+		for (int i = 0; i < mesh->_edges.size(); ++i)
+		{
+			const ga_mesh_edge& edge = mesh->_edges[i];
+			ga_vec3f along = (edge._end - edge._start).normal();
+			ga_vec3f midpoint = (edge._start + edge._end).scale_result(0.5f);
+			for (int n = 0; n < 2; ++n)
+			{
+				assert(ga_absf(edge._face_normals[n].dot(along)) < 0.0001f);
+				assert(edge._face_normals[n].dot(midpoint - ga_vec3f({ 4.0f, 2.0f, 0.0f })) > 0.0f);
+			}
+			assert(ga_absf(edge._face_normals[0].dot(edge._face_normals[1])) < 0.0001f);
+		}
+
+		// Unchanged bodies reuse the cached export.
+		assert(world.get_static_mesh_export() == mesh);
+
+		ga_rigid_body pillar(&box_oobb, 1.0f);
+		pillar.make_static();
+		world.add_rigid_body(&pillar);
+		assert(world.get_static_mesh_export()->_corners.size() == 16);
+
+		// An export already handed out is never changed by a rebuild.
+		assert(mesh->_corners.size() == 8);
+		assert(mesh->_corners[0]._position == ga_vec3f({ 3.0f, 0.0f, -0.5f }));
+
+		wall_transform.make_translation({ 4.0f, 2.0f, 10.0f });
+		wall.set_transform(wall_transform);
+		assert(world.get_static_mesh_export()->_corners[0]._position == ga_vec3f({ 3.0f, 0.0f, 9.5f }));
+
+		world.remove_rigid_body(&pillar);
+		assert(world.get_static_mesh_export()->_corners.size() == 8);
+
+		// Spheres are solid for point queries, though they aren't exported; the floor
+		// plane isn't.
+		ga_sphere ball_sphere;
+		ball_sphere._radius = 0.5f;
+		ga_rigid_body ball(&ball_sphere, 1.0f);
+		ga_mat4f ball_transform;
+		ball_transform.make_translation({ -6.0f, 3.0f, 0.0f });
+		ball.set_transform(ball_transform);
+		world.add_rigid_body(&ball);
+		world.publish_snapshot();
+		assert(world.point_in_any_solid({ -6.0f, 3.4f, 0.0f }));
+		assert(!world.point_in_any_solid({ -6.0f, 3.6f, 0.0f }));
+		assert(!world.point_in_any_solid({ -6.0f, -1.0f, 0.0f }));
+		assert(world.point_in_any_solid({ 4.0f, 2.0f, 10.0f }));
+		assert(world.get_static_mesh_export()->_corners.size() == 8);
+
+		world.remove_all_rigid_bodies();
+	}
+}
@@ -10,12 +10,50 @@
 #include "ga_rigid_body.h"
 #include "ga_shape.h"
 
+#include "math/ga_math.h"
+
+#include <float.h>
+
+/*
+** Make the rotation rows of the transform orthogonal again, then give them the
+** scales passed in. Rounding lets the rows drift apart as small turns pile up.
+*/
+static void orthonormalize_rotation(ga_mat4f& transform, const ga_vec3f& scale)
+{
+	ga_vec3f rows[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		rows[i] = { transform.data[i][0], transform.data[i][1], transform.data[i][2] };
+	}
+
+	ga_vec3f x = rows[0].normal();
+	ga_vec3f y = (rows[1] - x.scale_result(x.dot(rows[1]))).normal();
+	ga_vec3f z = ga_vec3f_cross(x, y);
+	if (z.dot(rows[2]) < 0.0f)
+	{
+		// Keep mirrored transforms mirrored.
+		z.negate();
+	}
+
+	rows[0] = x.scale_result(scale.x);
+	rows[1] = y.scale_result(scale.y);
+	rows[2] = z.scale_result(scale.z);
+	for (int i = 0; i < 3; ++i)
+	{
+		transform.data[i][0] = rows[i].x;
+		transform.data[i][1] = rows[i].y;
+		transform.data[i][2] = rows[i].z;
+	}
+}
+
 ga_rigid_body::ga_rigid_body(ga_shape* shape, float mass) : _mass(mass), _shape(shape), _flags(0)
 {
 	_transform.make_identity();
+	_previous_transform.make_identity();
 	_orientation.make_axis_angle(ga_vec3f::y_vector(), 0);
 
 	_shape->get_inertia_tensor(_inertia_tensor, _mass);
+	update_bounds();
 }
 
 ga_rigid_body::~ga_rigid_body()
@@ -27,6 +65,74 @@ void ga_rigid_body::get_debug_draw(ga_dynamic_drawcall* drawcall)
 	_shape->get_debug_draw(_transform, drawcall);
 }
 
+ga_mat4f ga_rigid_body::get_interpolated_transform(float alpha) const
+{
+	// Blend every row, then straighten the rotation out again. A step only turns a
+	// body a little, so this stays close to a proper spherical blend.
+	ga_mat4f result = _transform;
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			result.data[i][j] = _previous_transform.data[i][j] +
+				(_transform.data[i][j] - _previous_transform.data[i][j]) * alpha;
+		}
+	}
+
+	orthonormalize_rotation(result, _transform.get_scale());
+	return result;
+}
+
+void ga_rigid_body::integrate_orientation(float dt)
+{
+	float speed = _angular_velocity.mag();
+	if (speed == 0.0f) return;
+
+	// Turn by the whole angle the spin covers this step, about its axis, rather than
+	// adding the derivative, so fast spins don't skew the rows.
+	ga_quatf spin;
+	spin.make_axis_angle(_angular_velocity.scale_result(1.0f / speed), speed * dt);
+	ga_mat4f rotation;
+	rotation.make_rotation(spin);
+
+	ga_vec3f scale = _transform.get_scale();
+	ga_vec3f translation = _transform.get_translation();
+	_transform.set_translation(ga_vec3f::zero_vector());
+	_transform *= rotation;
+	_transform.set_translation(translation);
+
+	orthonormalize_rotation(_transform, scale);
+}
+
+void ga_rigid_body::get_bounding_sphere(ga_vec3f& center, float& radius) const
+{
+	center = _transform.transform_point(_bounding_center);
+	if (_bounding_radius == FLT_MAX)
+	{
+		radius = FLT_MAX;
+		return;
+	}
+
+	// Account for any scale in the transform.
+	ga_vec3f scale = _transform.get_scale();
+	radius = _bounding_radius * ga_max(scale.x, ga_max(scale.y, scale.z));
+}
+
+void ga_rigid_body::get_inner_sphere(ga_vec3f& center, float& radius) const
+{
+	center = _transform.transform_point(_inner_center);
+
+	// Account for any scale in the transform.
+	ga_vec3f scale = _transform.get_scale();
+	radius = _inner_radius * ga_min(scale.x, ga_min(scale.y, scale.z));
+}
+
+void ga_rigid_body::update_bounds()
+{
+	_shape->get_bounding_sphere(_bounding_center, _bounding_radius);
+	_shape->get_inner_sphere(_inner_center, _inner_radius);
+}
+
 void ga_rigid_body::make_static()
 {
 	_flags |= k_static;
@@ -37,12 +143,37 @@ void ga_rigid_body::make_weightless()
 	_flags |= k_weightless;
 }
 
+void ga_rigid_body::make_fast()
+{
+	_flags |= k_fast;
+}
+
+void ga_rigid_body::wake()
+{
+	_flags &= ~k_sleeping;
+	_sleep_timer = 0.0f;
+}
+
 void ga_rigid_body::add_linear_velocity(const ga_vec3f& v)
 {
+	wake();
 	_velocity += v;
 }
 
 void ga_rigid_body::add_angular_momentum(const ga_vec3f& v)
 {
+	wake();
 	_angular_momentum += v;
 }
+
+void ga_rigid_body::add_force(const ga_vec3f& f)
+{
+	wake();
+	_force_accumulator += f;
+}
+
+void ga_rigid_body::add_torque(const ga_vec3f& t)
+{
+	wake();
+	_torque_accumulator += t;
+}
@@ -13,17 +13,23 @@
 #include "math/ga_vec3f.h"
 
 #include <cstdint>
-#include <vector>
 
 enum ga_rigid_body_flags
 {
 	k_static = 1,
 	k_weightless = 2,
+	k_sleeping = 4,
+	k_fast = 8,
+	k_transform_set = 16,
 };
 
 /*
 ** Represents a body in the physics simulation.
 ** Static bodies will not move (e.g. the floor).
+** Sleeping bodies are at rest and skip integration and narrowphase until woken.
+** Fast bodies are swept along their motion each step so they can't tunnel
+** through thin colliders.
+** Bodies moved with set_transform are marked so the world refreshes them.
 */
 class ga_rigid_body final
 {
@@ -35,12 +41,64 @@ public:
 
 	void make_static();
 	void make_weightless();
+	void make_fast();
+
+	bool is_sleeping() const { return (_flags & k_sleeping) != 0; }
+	void wake();
+
+	const ga_mat4f& get_transform() const { return _transform; }
+
+	/*
+	** Teleport the body. The previous transform is reset too, so the move
+	** isn't smeared across the next interpolated frame.
+	*/
+	void set_transform(const ga_mat4f& t) { _transform = t; _previous_transform = t; _flags |= k_transform_set; }
+
+	/*
+	** Blend between the transforms before and after the last physics step.
+	** Alpha is the fraction of a fixed step that has elapsed since then.
+	*/
+	ga_mat4f get_interpolated_transform(float alpha) const;
+
+	/*
+	** The shape's bounding sphere placed at the body's transform.
+	** Unbounded shapes such as planes report a radius of FLT_MAX.
+	*/
+	void get_bounding_sphere(ga_vec3f& center, float& radius) const;
+
+	/*
+	** The shape's inner sphere placed at the body's transform. See ga_shape.
+	*/
+	void get_inner_sphere(ga_vec3f& center, float& radius) const;
+
+	/*
+	** Recompute the cached local bounding and inner spheres after editing the shape.
+	** The world does this at the start of each step for awake dynamic bodies and
+	** bodies moved with set_transform; others must be refreshed by hand.
+	*/
+	void update_bounds();
+
+	/*
+	** Turn the transform by the angular velocity over dt. Scale and translation are
+	** kept. The world calls this after updating the angular velocity each step.
+	*/
+	void integrate_orientation(float dt);
+	const ga_vec3f& get_linear_velocity() const { return _velocity; }
+	const ga_vec3f& get_angular_velocity() const { return _angular_velocity; }
 
 	void add_linear_velocity(const ga_vec3f& v);
 	void add_angular_momentum(const ga_vec3f& v);
 
+	/*
+	** Accumulate a force or torque to be applied over the next step.
+	** Accumulators are cleared once the step consumes them.
+	*/
+	void add_force(const ga_vec3f& f);
+	void add_torque(const ga_vec3f& t);
+
 private:
 	ga_mat4f _transform;
+	ga_mat4f _previous_transform;
 	ga_quatf _orientation = { 0.0f, 0.0f, 0.0f, 0.0f };
 
 	ga_vec3f _angular_momentum = ga_vec3f::zero_vector();
@@ -51,17 +109,33 @@ private:
 
 	float _mass;
 
+	// Time the body has spent below the sleep velocity thresholds.
+	float _sleep_timer = 0.0f;
+
 	// Ordinarily this would live in a collision material structure.
 	// We just include the value here for simplicity.
 	float _coefficient_of_restitution = 0.5f;
 
 	struct ga_shape* _shape;
 
-	std::vector<ga_vec3f> _forces;
-	std::vector<ga_vec3f> _torques;
+	// Local bounding sphere of the shape, used for early rejects.
+	ga_vec3f _bounding_center;
+	float _bounding_radius;
+
+	// Local inner sphere of the shape, swept for continuous collision.
+	ga_vec3f _inner_center;
+	float _inner_radius;
+
+	ga_vec3f _force_accumulator = ga_vec3f::zero_vector();
+	ga_vec3f _torque_accumulator = ga_vec3f::zero_vector();
 
 	uint32_t _flags;
 
+	// Contact solver colors this body already appears in. Rebuilt every step.
+	uint64_t _solver_colors = 0;
+
 	friend class ga_physics_world;
 	friend class ga_physics_component;
+	friend class ga_contact_cache;
+	friend class ga_physics_recording;
 };
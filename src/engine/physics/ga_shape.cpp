@@ -11,11 +11,13 @@
 #include "framework/ga_drawcall.h"
 #include "math/ga_math.h"
 
+#include <float.h>
 #include <utility>
 #include <vector>
 
 void ga_plane::get_debug_draw(const ga_mat4f& transform, ga_dynamic_drawcall* drawcall)
 {
+#if !defined(GA_HEADLESS)
 	ga_vec3f position = transform.get_translation() + _point;
 
 	// Get a vector perpendicular to the plane normal.
@@ -51,6 +53,7 @@ void ga_plane::get_debug_draw(const ga_mat4f& transform, ga_dynamic_drawcall* dr
 	drawcall->_draw_mode = GL_TRIANGLES;
 	drawcall->_transform = transform;
 	drawcall->_material = nullptr;
+#endif
 }
 
 void ga_plane::get_inertia_tensor(ga_mat4f& tensor, float mass)
@@ -64,24 +67,44 @@ ga_vec3f ga_plane::get_offset_to_point(const ga_mat4f& transform, const ga_vec3f
 	return ga_vec3f::zero_vector();
 }
 
+void ga_plane::get_bounding_sphere(ga_vec3f& center, float& radius) const
+{
+	center = _point;
+	radius = FLT_MAX;
+}
+
+void ga_plane::get_inner_sphere(ga_vec3f& center, float& radius) const
+{
+	center = _point;
+	radius = 0.0f;
+}
+
 void ga_oobb::get_corners(std::vector<ga_vec3f>& corners) const
+{
+	ga_vec3f array[8];
+	get_corners(array);
+	corners.insert(corners.end(), array, array + 8);
+}
+
+void ga_oobb::get_corners(ga_vec3f corners[8]) const
 {
 	ga_vec3f x_hvec = _half_vectors[0];
 	ga_vec3f y_hvec = _half_vectors[1];
 	ga_vec3f z_hvec = _half_vectors[2];
 
-	corners.push_back(_center - x_hvec - y_hvec - z_hvec);
-	corners.push_back(_center - x_hvec - y_hvec + z_hvec);
-	corners.push_back(_center - x_hvec + y_hvec - z_hvec);
-	corners.push_back(_center - x_hvec + y_hvec + z_hvec);
-	corners.push_back(_center + x_hvec - y_hvec - z_hvec);
-	corners.push_back(_center + x_hvec - y_hvec + z_hvec);
-	corners.push_back(_center + x_hvec + y_hvec - z_hvec);
-	corners.push_back(_center + x_hvec + y_hvec + z_hvec);
+	corners[0] = _center - x_hvec - y_hvec - z_hvec;
+	corners[1] = _center - x_hvec - y_hvec + z_hvec;
+	corners[2] = _center - x_hvec + y_hvec - z_hvec;
+	corners[3] = _center - x_hvec + y_hvec + z_hvec;
+	corners[4] = _center + x_hvec - y_hvec - z_hvec;
+	corners[5] = _center + x_hvec - y_hvec + z_hvec;
+	corners[6] = _center + x_hvec + y_hvec - z_hvec;
+	corners[7] = _center + x_hvec + y_hvec + z_hvec;
 }
 
 void ga_oobb::get_debug_draw(const ga_mat4f& transform, ga_dynamic_drawcall* drawcall)
 {
+#if !defined(GA_HEADLESS)
 	get_corners(drawcall->_positions);
 	drawcall->_positions.push_back(ga_vec3f::zero_vector());
 	drawcall->_positions.push_back(_half_vectors[0]);
@@ -116,6 +139,7 @@ void ga_oobb::get_debug_draw(const ga_mat4f& transform, ga_dynamic_drawcall* dra
 	drawcall->_draw_mode = GL_LINES;
 	drawcall->_transform = transform;
 	drawcall->_material = nullptr;
+#endif
 }
 
 void ga_oobb::get_inertia_tensor(ga_mat4f& tensor, float mass)
@@ -137,3 +161,168 @@ ga_vec3f ga_oobb::get_offset_to_point(const ga_mat4f& transform, const ga_vec3f&
 	ga_vec3f center = transform.transform_point(_center);
 	return point - center;
 }
+
+void ga_oobb::get_bounding_sphere(ga_vec3f& center, float& radius) const
+{
+	center = _center;
+	radius = (_half_vectors[0] + _half_vectors[1] + _half_vectors[2]).mag();
+
+	// The half vectors needn't be orthogonal, so check every corner direction.
+	radius = ga_max(radius, (_half_vectors[0] + _half_vectors[1] - _half_vectors[2]).mag());
+	radius = ga_max(radius, (_half_vectors[0] - _half_vectors[1] + _half_vectors[2]).mag());
+	radius = ga_max(radius, (_half_vectors[0] - _half_vectors[1] - _half_vectors[2]).mag());
+}
+
+void ga_oobb::get_inner_sphere(ga_vec3f& center, float& radius) const
+{
+	// Distance from the center to the nearest pair of faces. Each face pair is
+	// spanned by the other two half vectors.
+	center = _center;
+	radius = FLT_MAX;
+	for (int i = 0; i < 3; ++i)
+	{
+		ga_vec3f face_normal = ga_vec3f_cross(_half_vectors[(i + 1) % 3], _half_vectors[(i + 2) % 3]);
+		float normal_length = face_normal.mag();
+		float face_distance = normal_length > 0.0f ? ga_absf(_half_vectors[i].dot(face_normal)) / normal_length : 0.0f;
+		radius = ga_min(radius, face_distance);
+	}
+}
+
+#if !defined(GA_HEADLESS)
+/*
+** Adds a line loop circle of the given radius around an axis to the draw call.
+*/
+static void add_debug_circle(const ga_vec3f& center, const ga_vec3f& u, const ga_vec3f& v, float radius, ga_dynamic_drawcall* drawcall)
+{
+	const int k_segments = 16;
+	uint32_t first = uint32_t(drawcall->_positions.size());
+	for (int i = 0; i < k_segments; ++i)
+	{
+		float angle = (2.0f * GA_PI * i) / k_segments;
+		drawcall->_positions.push_back(center + u.scale_result(ga_cosf(angle) * radius) + v.scale_result(ga_sinf(angle) * radius));
+		drawcall->_indices.push_back(first + i);
+		drawcall->_indices.push_back(first + (i + 1) % k_segments);
+	}
+}
+#endif
+
+void ga_sphere::get_debug_draw(const ga_mat4f& transform, ga_dynamic_drawcall* drawcall)
+{
+#if !defined(GA_HEADLESS)
+	add_debug_circle(_center, ga_vec3f::x_vector(), ga_vec3f::y_vector(), _radius, drawcall);
+	add_debug_circle(_center, ga_vec3f::y_vector(), ga_vec3f::z_vector(), _radius, drawcall);
+	add_debug_circle(_center, ga_vec3f::z_vector(), ga_vec3f::x_vector(), _radius, drawcall);
+
+	drawcall->_color = { 0.0f, 0.0f, 0.0f };
+	drawcall->_draw_mode = GL_LINES;
+	drawcall->_transform = transform;
+	drawcall->_material = nullptr;
+#endif
+}
+
+void ga_sphere::get_inertia_tensor(ga_mat4f& tensor, float mass)
+{
+	tensor.make_identity();
+	tensor.data[0][0] = tensor.data[1][1] = tensor.data[2][2] = 0.4f * mass * _radius * _radius;
+}
+
+ga_vec3f ga_sphere::get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const
+{
+	ga_vec3f center = transform.transform_point(_center);
+	return point - center;
+}
+
+void ga_sphere::get_bounding_sphere(ga_vec3f& center, float& radius) const
+{
+	center = _center;
+	radius = _radius;
+}
+
+void ga_sphere::get_inner_sphere(ga_vec3f& center, float& radius) const
+{
+	center = _center;
+	radius = _radius;
+}
+
+void ga_capsule::get_debug_draw(const ga_mat4f& transform, ga_dynamic_drawcall* drawcall)
+{
+#if !defined(GA_HEADLESS)
+	// Build a frame around the capsule's axis.
+	ga_vec3f axis = _point_b - _point_a;
+	axis = axis.mag2() > 0.0f ? axis.normal() : ga_vec3f::y_vector();
+	ga_vec3f perp = ga_absf(axis.x) < 0.9f ? ga_vec3f::x_vector() : ga_vec3f::y_vector();
+	ga_vec3f u = ga_vec3f_cross(axis, perp).normal();
+	ga_vec3f v = ga_vec3f_cross(axis, u);
+
+	add_debug_circle(_point_a, u, v, _radius, drawcall);
+	add_debug_circle(_point_b, u, v, _radius, drawcall);
+	add_debug_circle(_point_a, u, axis, _radius, drawcall);
+	add_debug_circle(_point_b, u, axis, _radius, drawcall);
+	add_debug_circle(_point_a, v, axis, _radius, drawcall);
+	add_debug_circle(_point_b, v, axis, _radius, drawcall);
+
+	ga_vec3f sides[] = { u, -u, v, -v };
+	for (int i = 0; i < 4; ++i)
+	{
+		uint32_t first = uint32_t(drawcall->_positions.size());
+		drawcall->_positions.push_back(_point_a + sides[i].scale_result(_radius));
+		drawcall->_positions.push_back(_point_b + sides[i].scale_result(_radius));
+		drawcall->_indices.push_back(first);
+		drawcall->_indices.push_back(first + 1);
+	}
+
+	drawcall->_color = { 0.0f, 0.0f, 0.0f };
+	drawcall->_draw_mode = GL_LINES;
+	drawcall->_transform = transform;
+	drawcall->_material = nullptr;
+#endif
+}
+
+void ga_capsule::get_inertia_tensor(ga_mat4f& tensor, float mass)
+{
+	// Split the mass between the cylinder and the two hemispherical caps by volume.
+	ga_vec3f segment = _point_b - _point_a;
+	float height = segment.mag();
+	float r2 = _radius * _radius;
+	float cylinder_volume = GA_PI * r2 * height;
+	float sphere_volume = (4.0f / 3.0f) * GA_PI * r2 * _radius;
+	float cylinder_mass = mass * cylinder_volume / (cylinder_volume + sphere_volume);
+	float sphere_mass = mass - cylinder_mass;
+
+	float axial = cylinder_mass * r2 * 0.5f + sphere_mass * r2 * 0.4f;
+	float perpendicular =
+		cylinder_mass * (height * height / 12.0f + r2 * 0.25f) +
+		sphere_mass * (r2 * 0.4f + height * height * 0.25f + height * _radius * 0.375f);
+
+	// Rotate the principal moments onto the capsule's axis.
+	ga_vec3f axis = height > 0.0f ? segment.scale_result(1.0f / height) : ga_vec3f::y_vector();
+	float a[3] = { axis.x, axis.y, axis.z };
+
+	tensor.make_identity();
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			float outer = a[i] * a[j];
+			tensor.data[i][j] = perpendicular * ((i == j ? 1.0f : 0.0f) - outer) + axial * outer;
+		}
+	}
+}
+
+ga_vec3f ga_capsule::get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const
+{
+	ga_vec3f center = transform.transform_point((_point_a + _point_b).scale_result(0.5f));
+	return point - center;
+}
+
+void ga_capsule::get_bounding_sphere(ga_vec3f& center, float& radius) const
+{
+	center = (_point_a + _point_b).scale_result(0.5f);
+	radius = (_point_b - _point_a).mag() * 0.5f + _radius;
+}
+
+void ga_capsule::get_inner_sphere(ga_vec3f& center, float& radius) const
+{
+	center = (_point_a + _point_b).scale_result(0.5f);
+	radius = _radius;
+}
@@ -21,6 +21,8 @@ enum ga_shape_t
 {
 	k_shape_plane,
 	k_shape_oobb,
+	k_shape_sphere,
+	k_shape_capsule,
 	k_shape_count,
 };
 
@@ -59,6 +61,17 @@ struct ga_shape
 	*/
 	virtual ga_vec3f get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const = 0;
 
+	/*
+	** Returns a sphere in local space enclosing the shape, for cheap rejects.
+	** Unbounded shapes return a radius of FLT_MAX.
+	*/
+	virtual void get_bounding_sphere(ga_vec3f& center, float& radius) const = 0;
+
+	/*
+	** Returns a sphere in local space that lies entirely inside the shape.
+	** Continuous collision sweeps it along a fast body's motion. Planes return a radius of 0.
+	*/
+	virtual void get_inner_sphere(ga_vec3f& center, float& radius) const = 0;
 };
 
 /*
@@ -73,6 +86,8 @@ struct ga_plane final : ga_shape
 	void get_debug_draw(const ga_mat4f& transform, struct ga_dynamic_drawcall* drawcall) override;
 	void get_inertia_tensor(ga_mat4f& tensor, float mass) override;
 	ga_vec3f get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const override;
+	void get_bounding_sphere(ga_vec3f& center, float& radius) const override;
+	void get_inner_sphere(ga_vec3f& center, float& radius) const override;
 };
 
 /*
@@ -88,6 +103,43 @@ struct ga_oobb final : ga_shape
 	void get_debug_draw(const ga_mat4f& transform, struct ga_dynamic_drawcall* drawcall) override;
 	void get_inertia_tensor(ga_mat4f& tensor, float mass) override;
 	ga_vec3f get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const override;
+	void get_bounding_sphere(ga_vec3f& center, float& radius) const override;
+	void get_inner_sphere(ga_vec3f& center, float& radius) const override;
 
 	void get_corners(std::vector<ga_vec3f>& corners) const;
+	void get_corners(ga_vec3f corners[8]) const;
+};
+
+/*
+** Defines a collidable sphere with a center point and radius.
+*/
+struct ga_sphere final : ga_shape
+{
+	ga_vec3f _center = ga_vec3f::zero_vector();
+	float _radius = 1.0f;
+
+	ga_shape_t get_type() const override { return k_shape_sphere; }
+	void get_debug_draw(const ga_mat4f& transform, struct ga_dynamic_drawcall* drawcall) override;
+	void get_inertia_tensor(ga_mat4f& tensor, float mass) override;
+	ga_vec3f get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const override;
+	void get_bounding_sphere(ga_vec3f& center, float& radius) const override;
+	void get_inner_sphere(ga_vec3f& center, float& radius) const override;
+};
+
+/*
+** Defines a collidable capsule: every point within a radius of the segment
+** between two points. Cheap to test, and a good fit for characters.
+*/
+struct ga_capsule final : ga_shape
+{
+	ga_vec3f _point_a = { 0.0f, -0.5f, 0.0f };
+	ga_vec3f _point_b = { 0.0f, 0.5f, 0.0f };
+	float _radius = 0.5f;
+
+	ga_shape_t get_type() const override { return k_shape_capsule; }
+	void get_debug_draw(const ga_mat4f& transform, struct ga_dynamic_drawcall* drawcall) override;
+	void get_inertia_tensor(ga_mat4f& tensor, float mass) override;
+	ga_vec3f get_offset_to_point(const ga_mat4f& transform, const ga_vec3f& point) const override;
+	void get_bounding_sphere(ga_vec3f& center, float& radius) const override;
+	void get_inner_sphere(ga_vec3f& center, float& radius) const override;
 };
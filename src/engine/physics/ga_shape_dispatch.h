@@ -0,0 +1,395 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_intersection.h"
+#include "ga_shape.h"
+
+/*
+** Compile-time shape dispatch.
+**
+** Every concrete shape is tied to its ga_shape_t by a ga_shape_traits and a
+** ga_shape_of specialization, and every supported test by a ga_collider or
+** ga_ray_caster specialization. Code that already knows the shape types (such as
+** the world's per type-pair collision buckets) calls the specialization directly,
+** with no function pointer in between. Pairs without a specialization are
+** dropped at compile time.
+**
+** To add a shape: add its enum value, specialize ga_shape_traits and ga_shape_of,
+** then specialize ga_collider, ga_ray_caster, ga_point_tester and ga_sphere_sweeper
+** for the tests it supports.
+*/
+
+template<typename T> struct ga_shape_traits;
+template<int Type> struct ga_shape_of;
+
+template<> struct ga_shape_traits<ga_plane> { static const ga_shape_t k_type = k_shape_plane; };
+template<> struct ga_shape_of<k_shape_plane> { typedef ga_plane type; };
+
+template<> struct ga_shape_traits<ga_oobb> { static const ga_shape_t k_type = k_shape_oobb; };
+template<> struct ga_shape_of<k_shape_oobb> { typedef ga_oobb type; };
+
+template<> struct ga_shape_traits<ga_sphere> { static const ga_shape_t k_type = k_shape_sphere; };
+template<> struct ga_shape_of<k_shape_sphere> { typedef ga_sphere type; };
+
+template<> struct ga_shape_traits<ga_capsule> { static const ga_shape_t k_type = k_shape_capsule; };
+template<> struct ga_shape_of<k_shape_capsule> { typedef ga_capsule type; };
+
+/*
+** Collision test between shapes A and B.
+** The normal in the collision info points from A towards B.
+*/
+template<typename A, typename B>
+struct ga_collider
+{
+	static const bool k_implemented = false;
+
+	static bool test(const A* a, const ga_mat4f& transform_a, const B* b, const ga_mat4f& transform_b, ga_collision_info* info)
+	{
+		return intersection_unimplemented(a, transform_a, b, transform_b, info);
+	}
+};
+
+#define GA_SHAPE_COLLIDER(shape_a_t, shape_b_t, func) \
+	template<> \
+	struct ga_collider<shape_a_t, shape_b_t> \
+	{ \
+		static const bool k_implemented = true; \
+		static bool test(const shape_a_t* a, const ga_mat4f& transform_a, const shape_b_t* b, const ga_mat4f& transform_b, ga_collision_info* info) \
+		{ \
+			return func(a, transform_a, b, transform_b, info); \
+		} \
+	};
+
+GA_SHAPE_COLLIDER(ga_oobb, ga_oobb, separating_axis_test)
+GA_SHAPE_COLLIDER(ga_plane, ga_oobb, oobb_vs_plane)
+GA_SHAPE_COLLIDER(ga_oobb, ga_plane, oobb_vs_plane)
+
+GA_SHAPE_COLLIDER(ga_plane, ga_sphere, capsule_vs_plane)
+GA_SHAPE_COLLIDER(ga_sphere, ga_plane, capsule_vs_plane)
+GA_SHAPE_COLLIDER(ga_plane, ga_capsule, capsule_vs_plane)
+GA_SHAPE_COLLIDER(ga_capsule, ga_plane, capsule_vs_plane)
+
+GA_SHAPE_COLLIDER(ga_oobb, ga_sphere, capsule_vs_oobb)
+GA_SHAPE_COLLIDER(ga_sphere, ga_oobb, capsule_vs_oobb)
+GA_SHAPE_COLLIDER(ga_oobb, ga_capsule, capsule_vs_oobb)
+GA_SHAPE_COLLIDER(ga_capsule, ga_oobb, capsule_vs_oobb)
+
+GA_SHAPE_COLLIDER(ga_sphere, ga_sphere, capsule_vs_capsule)
+GA_SHAPE_COLLIDER(ga_sphere, ga_capsule, capsule_vs_capsule)
+GA_SHAPE_COLLIDER(ga_capsule, ga_sphere, capsule_vs_capsule)
+GA_SHAPE_COLLIDER(ga_capsule, ga_capsule, capsule_vs_capsule)
+
+#undef GA_SHAPE_COLLIDER
+
+/*
+** Ray test against shape T. Dist is set to t along the ray at the hit.
+*/
+template<typename T>
+struct ga_ray_caster
+{
+	static const bool k_implemented = false;
+
+	static bool test(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir, const T* shape, const ga_mat4f& transform, float* dist)
+	{
+		return ray_intersection_unimplemented(ray_origin, ray_dir, shape, transform, dist);
+	}
+};
+
+template<>
+struct ga_ray_caster<ga_oobb>
+{
+	static const bool k_implemented = true;
+
+	static bool test(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir, const ga_oobb* shape, const ga_mat4f& transform, float* dist)
+	{
+		return ray_vs_oobb(ray_origin, ray_dir, shape, transform, dist);
+	}
+};
+
+template<>
+struct ga_ray_caster<ga_plane>
+{
+	static const bool k_implemented = true;
+
+	static bool test(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir, const ga_plane* shape, const ga_mat4f& transform, float* dist)
+	{
+		return ray_vs_plane(ray_origin, ray_dir, shape, transform, dist);
+	}
+};
+
+template<>
+struct ga_ray_caster<ga_sphere>
+{
+	static const bool k_implemented = true;
+
+	static bool test(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir, const ga_sphere* shape, const ga_mat4f& transform, float* dist)
+	{
+		return ray_vs_sphere(ray_origin, ray_dir, shape, transform, dist);
+	}
+};
+
+template<>
+struct ga_ray_caster<ga_capsule>
+{
+	static const bool k_implemented = true;
+
+	static bool test(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir, const ga_capsule* shape, const ga_mat4f& transform, float* dist)
+	{
+		return ray_vs_capsule(ray_origin, ray_dir, shape, transform, dist);
+	}
+};
+
+/*
+** Containment test of a point against shape T. Points on the surface are inside.
+*/
+template<typename T>
+struct ga_point_tester
+{
+	static const bool k_implemented = false;
+
+	static bool test(const ga_vec3f&, const T*, const ga_mat4f&)
+	{
+		return false;
+	}
+};
+
+#define GA_SHAPE_POINT_TESTER(shape_t, func) \
+	template<> \
+	struct ga_point_tester<shape_t> \
+	{ \
+		static const bool k_implemented = true; \
+		static bool test(const ga_vec3f& point, const shape_t* shape, const ga_mat4f& transform) \
+		{ \
+			return func(point, shape, transform); \
+		} \
+	};
+
+GA_SHAPE_POINT_TESTER(ga_plane, point_in_plane)
+GA_SHAPE_POINT_TESTER(ga_oobb, point_in_oobb)
+GA_SHAPE_POINT_TESTER(ga_sphere, point_in_capsule)
+GA_SHAPE_POINT_TESTER(ga_capsule, point_in_capsule)
+
+#undef GA_SHAPE_POINT_TESTER
+
+/*
+** Sweep of a sphere along a unit direction against shape T.
+** Dist is set to t along the direction at first contact, zero if already touching.
+*/
+template<typename T>
+struct ga_sphere_sweeper
+{
+	static const bool k_implemented = false;
+
+	static bool test(const ga_vec3f&, const ga_vec3f&, float, const T*, const ga_mat4f&, float*)
+	{
+		return false;
+	}
+};
+
+#define GA_SHAPE_SPHERE_SWEEPER(shape_t, func) \
+	template<> \
+	struct ga_sphere_sweeper<shape_t> \
+	{ \
+		static const bool k_implemented = true; \
+		static bool test(const ga_vec3f& origin, const ga_vec3f& dir, float radius, const shape_t* shape, const ga_mat4f& transform, float* dist) \
+		{ \
+			return func(origin, dir, radius, shape, transform, dist); \
+		} \
+	};
+
+GA_SHAPE_SPHERE_SWEEPER(ga_plane, sphere_sweep_vs_plane)
+GA_SHAPE_SPHERE_SWEEPER(ga_oobb, sphere_sweep_vs_oobb)
+GA_SHAPE_SPHERE_SWEEPER(ga_sphere, sphere_sweep_vs_capsule)
+GA_SHAPE_SPHERE_SWEEPER(ga_capsule, sphere_sweep_vs_capsule)
+
+#undef GA_SHAPE_SPHERE_SWEEPER
+
+template<int A, int B, bool InRange = (A < k_shape_count && B < k_shape_count)>
+struct ga_shape_pair_has_collider
+{
+	static const bool value = ga_collider<typename ga_shape_of<A>::type, typename ga_shape_of<B>::type>::k_implemented;
+};
+
+template<int A, int B>
+struct ga_shape_pair_has_collider<A, B, false>
+{
+	static const bool value = false;
+};
+
+/*
+** Calls func.operator()<A, B>() for every shape type pair with A <= B that has a
+** collider, with A and B the shape structs.
+*/
+template<int A = 0, int B = 0, bool Implemented = ga_shape_pair_has_collider<A, B>::value>
+struct ga_for_each_shape_pair
+{
+	template<typename Func>
+	static void run(Func& func)
+	{
+		func.template operator()<typename ga_shape_of<A>::type, typename ga_shape_of<B>::type>();
+		ga_for_each_shape_pair<A, B + 1>::run(func);
+	}
+};
+
+template<int A, int B>
+struct ga_for_each_shape_pair<A, B, false>
+{
+	template<typename Func>
+	static void run(Func& func)
+	{
+		ga_for_each_shape_pair<A, B + 1>::run(func);
+	}
+};
+
+// End of a row: move on to the next A, starting at B = A.
+template<int A>
+struct ga_for_each_shape_pair<A, k_shape_count, false>
+{
+	template<typename Func>
+	static void run(Func& func)
+	{
+		ga_for_each_shape_pair<A + 1, A + 1>::run(func);
+	}
+};
+
+template<>
+struct ga_for_each_shape_pair<k_shape_count, k_shape_count, false>
+{
+	template<typename Func>
+	static void run(Func&) {}
+};
+
+/*
+** Runtime dispatch for callers holding base shape pointers.
+** Resolves the types with a compare chain generated from the specializations above.
+*/
+template<int A = 0, int B = 0>
+struct ga_collide_dispatch
+{
+	static bool run(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
+	{
+		typedef typename ga_shape_of<A>::type shape_a_t;
+		typedef typename ga_shape_of<B>::type shape_b_t;
+		if (a->get_type() == A && b->get_type() == B)
+		{
+			return ga_collider<shape_a_t, shape_b_t>::test(
+				static_cast<const shape_a_t*>(a), transform_a, static_cast<const shape_b_t*>(b), transform_b, info);
+		}
+		return ga_collide_dispatch<A, B + 1>::run(a, transform_a, b, transform_b, info);
+	}
+};
+
+template<int A>
+struct ga_collide_dispatch<A, k_shape_count>
+{
+	static bool run(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
+	{
+		return ga_collide_dispatch<A + 1, 0>::run(a, transform_a, b, transform_b, info);
+	}
+};
+
+template<>
+struct ga_collide_dispatch<k_shape_count, 0>
+{
+	static bool run(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
+	{
+		return intersection_unimplemented(a, transform_a, b, transform_b, info);
+	}
+};
+
+template<int T = 0>
+struct ga_ray_dispatch
+{
+	static bool run(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir, const ga_shape* shape, const ga_mat4f& transform, float* dist)
+	{
+		typedef typename ga_shape_of<T>::type shape_t;
+		if (shape->get_type() == T)
+		{
+			return ga_ray_caster<shape_t>::test(ray_origin, ray_dir, static_cast<const shape_t*>(shape), transform, dist);
+		}
+		return ga_ray_dispatch<T + 1>::run(ray_origin, ray_dir, shape, transform, dist);
+	}
+};
+
+template<>
+struct ga_ray_dispatch<k_shape_count>
+{
+	static bool run(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir, const ga_shape* shape, const ga_mat4f& transform, float* dist)
+	{
+		return ray_intersection_unimplemented(ray_origin, ray_dir, shape, transform, dist);
+	}
+};
+
+template<int T = 0>
+struct ga_point_dispatch
+{
+	static bool run(const ga_vec3f& point, const ga_shape* shape, const ga_mat4f& transform)
+	{
+		typedef typename ga_shape_of<T>::type shape_t;
+		if (shape->get_type() == T)
+		{
+			return ga_point_tester<shape_t>::test(point, static_cast<const shape_t*>(shape), transform);
+		}
+		return ga_point_dispatch<T + 1>::run(point, shape, transform);
+	}
+};
+
+template<>
+struct ga_point_dispatch<k_shape_count>
+{
+	static bool run(const ga_vec3f&, const ga_shape*, const ga_mat4f&)
+	{
+		return false;
+	}
+};
+
+template<int T = 0>
+struct ga_sphere_sweep_dispatch
+{
+	static bool run(const ga_vec3f& origin, const ga_vec3f& dir, float radius, const ga_shape* shape, const ga_mat4f& transform, float* dist)
+	{
+		typedef typename ga_shape_of<T>::type shape_t;
+		if (shape->get_type() == T)
+		{
+			return ga_sphere_sweeper<shape_t>::test(origin, dir, radius, static_cast<const shape_t*>(shape), transform, dist);
+		}
+		return ga_sphere_sweep_dispatch<T + 1>::run(origin, dir, radius, shape, transform, dist);
+	}
+};
+
+template<>
+struct ga_sphere_sweep_dispatch<k_shape_count>
+{
+	static bool run(const ga_vec3f&, const ga_vec3f&, float, const ga_shape*, const ga_mat4f&, float*)
+	{
+		return false;
+	}
+};
+
+inline bool ga_collide(const ga_shape* a, const ga_mat4f& transform_a, const ga_shape* b, const ga_mat4f& transform_b, ga_collision_info* info)
+{
+	return ga_collide_dispatch<>::run(a, transform_a, b, transform_b, info);
+}
+
+inline bool ga_intersect_ray(const ga_vec3f& ray_origin, const ga_vec3f& ray_dir, const ga_shape* shape, const ga_mat4f& transform, float* dist)
+{
+	return ga_ray_dispatch<>::run(ray_origin, ray_dir, shape, transform, dist);
+}
+
+inline bool ga_point_in_shape(const ga_vec3f& point, const ga_shape* shape, const ga_mat4f& transform)
+{
+	return ga_point_dispatch<>::run(point, shape, transform);
+}
+
+inline bool ga_sweep_sphere(const ga_vec3f& origin, const ga_vec3f& dir, float radius, const ga_shape* shape, const ga_mat4f& transform, float* dist)
+{
+	return ga_sphere_sweep_dispatch<>::run(origin, dir, radius, shape, transform, dist);
+}
@@ -0,0 +1,347 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_static_geometry_optimizer.h"
+#include "ga_physics_world.h"
+#include "ga_rigid_body.h"
+#include "ga_shape.h"
+
+#include "math/ga_math.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+
+// Coordinates closer than this are treated as the same grid line.
+static const float k_coordinate_tolerance = 1.0e-4f;
+
+enum cell_state_t : uint8_t
+{
+	k_cell_empty,
+	k_cell_occupied,
+	k_cell_merged,
+};
+
+// Sorted, de-duplicated grid line coordinates along one axis.
+static void build_grid_lines(std::vector<float>& lines)
+{
+	std::sort(lines.begin(), lines.end());
+
+	int count = 0;
+	for (int i = 0; i < int(lines.size()); ++i)
+	{
+		if (count == 0 || lines[i] - lines[count - 1] > k_coordinate_tolerance)
+		{
+			lines[count++] = lines[i];
+		}
+	}
+	lines.resize(count);
+}
+
+static int find_grid_line(const std::vector<float>& lines, float value)
+{
+	return int(std::lower_bound(lines.begin(), lines.end(), value - k_coordinate_tolerance) - lines.begin());
+}
+
+// Cells are keyed by their grid coordinates packed into one integer, z highest.
+static const int k_cell_key_bits = 21;
+static const uint64_t k_cell_key_mask = (uint64_t(1) << k_cell_key_bits) - 1;
+
+static uint64_t get_cell_key(int x, int y, int z)
+{
+	return (uint64_t(z) << (2 * k_cell_key_bits)) | (uint64_t(y) << k_cell_key_bits) | uint64_t(x);
+}
+
+static int find_group(std::vector<int>& parent, int box)
+{
+	while (parent[box] != box)
+	{
+		parent[box] = parent[parent[box]];
+		box = parent[box];
+	}
+	return box;
+}
+
+ga_static_geometry_optimizer::ga_static_geometry_optimizer()
+{
+}
+
+ga_static_geometry_optimizer::~ga_static_geometry_optimizer()
+{
+}
+
+void ga_static_geometry_optimizer::add_box(const ga_oobb& box, const ga_mat4f& transform)
+{
+	// The box can be merged if each world space half vector lies along a different axis.
+	ga_vec3f half_extents = ga_vec3f::zero_vector();
+	bool axis_aligned = true;
+	int axes_used = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		ga_vec3f half_vector = transform.transform_vector(box._half_vectors[i]);
+
+		int axis = -1;
+		for (int j = 0; j < 3; ++j)
+		{
+			if (ga_absf(half_vector.axes[j]) <= k_coordinate_tolerance) continue;
+
+			axis_aligned = axis_aligned && axis < 0;
+			axis = j;
+		}
+
+		if (!axis_aligned || axis < 0 || (axes_used & (1 << axis)))
+		{
+			axis_aligned = false;
+			break;
+		}
+		axes_used |= 1 << axis;
+		half_extents.axes[axis] = ga_absf(half_vector.axes[axis]);
+	}
+
+	if (!axis_aligned)
+	{
+		ga_oobb* shape = _allocator.create_shape(box);
+		_unmergeable_shapes.push_back(shape);
+		_unmergeable_transforms.push_back(transform);
+		return;
+	}
+
+	ga_vec3f center = transform.transform_point(box._center);
+
+	queued_box queued;
+	queued._min = center - half_extents;
+	queued._max = center + half_extents;
+	_boxes.push_back(queued);
+}
+
+void ga_static_geometry_optimizer::build(ga_physics_world* world)
+{
+	_last_input_count = int(_boxes.size() + _unmergeable_shapes.size());
+	_last_output_count = 0;
+
+	for (int i = 0; i < int(_unmergeable_shapes.size()); ++i)
+	{
+		add_static_body(_unmergeable_shapes[i], _unmergeable_transforms[i], world);
+	}
+	_unmergeable_shapes.clear();
+	_unmergeable_transforms.clear();
+
+	if (_boxes.empty()) return;
+
+	// Boxes that touch or overlap join a group. Sweeping along x in order of min x
+	// only compares boxes whose x ranges meet.
+	std::vector<int> order(_boxes.size());
+	std::vector<int> parent(_boxes.size());
+	for (int i = 0; i < int(_boxes.size()); ++i)
+	{
+		order[i] = i;
+		parent[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [this](int a, int b) { return _boxes[a]._min.x < _boxes[b]._min.x; });
+
+	for (int i = 0; i < int(order.size()); ++i)
+	{
+		const queued_box& a = _boxes[order[i]];
+		for (int j = i + 1; j < int(order.size()); ++j)
+		{
+			const queued_box& b = _boxes[order[j]];
+			if (b._min.x > a._max.x + k_coordinate_tolerance) break;
+
+			if (boxes_touch(a, b))
+			{
+				int root_a = find_group(parent, order[i]);
+				int root_b = find_group(parent, order[j]);
+				parent[root_b] = root_a;
+			}
+		}
+	}
+
+	std::vector<std::vector<int>> groups;
+	std::vector<int> group_of_root(_boxes.size(), -1);
+	for (int i = 0; i < int(_boxes.size()); ++i)
+	{
+		int root = find_group(parent, i);
+		if (group_of_root[root] < 0)
+		{
+			group_of_root[root] = int(groups.size());
+			groups.emplace_back();
+		}
+		groups[group_of_root[root]].push_back(i);
+	}
+
+	std::vector<queued_box> merged;
+	for (auto& group : groups)
+	{
+		merged.clear();
+		if (group.size() > 1)
+		{
+			merge_group(group, &merged);
+		}
+
+		// Keep the boxes as given unless merging leaves fewer of them.
+		if (group.size() == 1 || merged.size() >= group.size())
+		{
+			merged.clear();
+			for (int i : group)
+			{
+				merged.push_back(_boxes[i]);
+			}
+		}
+
+		for (auto& box : merged)
+		{
+			ga_vec3f half_extents = (box._max - box._min).scale_result(0.5f);
+
+			// The box is placed by its center rather than the transform, which keeps
+			// the face coordinates exact.
+			ga_oobb shape;
+			shape._center = box._min + half_extents;
+			shape._half_vectors[0] = ga_vec3f::x_vector().scale_result(half_extents.x);
+			shape._half_vectors[1] = ga_vec3f::y_vector().scale_result(half_extents.y);
+			shape._half_vectors[2] = ga_vec3f::z_vector().scale_result(half_extents.z);
+
+			ga_mat4f identity;
+			identity.make_identity();
+			add_static_body(_allocator.create_shape(shape), identity, world);
+		}
+	}
+	_boxes.clear();
+}
+
+bool ga_static_geometry_optimizer::boxes_touch(const queued_box& a, const queued_box& b)
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (a._min.axes[axis] > b._max.axes[axis] + k_coordinate_tolerance ||
+			b._min.axes[axis] > a._max.axes[axis] + k_coordinate_tolerance)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void ga_static_geometry_optimizer::merge_group(const std::vector<int>& group, std::vector<queued_box>* merged) const
+{
+	// Every face in the group lies on a grid line, so each cell is either fully
+	// inside the geometry or fully outside it.
+	std::vector<float> lines[3];
+	for (int i : group)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			lines[axis].push_back(_boxes[i]._min.axes[axis]);
+			lines[axis].push_back(_boxes[i]._max.axes[axis]);
+		}
+	}
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		build_grid_lines(lines[axis]);
+		assert(lines[axis].size() <= k_cell_key_mask);
+	}
+
+	// Only occupied cells are stored, so memory follows how much space the group
+	// fills rather than the size of its grid.
+	std::unordered_map<uint64_t, uint8_t> cells;
+	auto find_cell = [&cells](int x, int y, int z) -> uint8_t
+	{
+		auto it = cells.find(get_cell_key(x, y, z));
+		return it != cells.end() ? it->second : uint8_t(k_cell_empty);
+	};
+
+	for (int i : group)
+	{
+		int min_x = find_grid_line(lines[0], _boxes[i]._min.x);
+		int min_y = find_grid_line(lines[1], _boxes[i]._min.y);
+		int min_z = find_grid_line(lines[2], _boxes[i]._min.z);
+		int max_x = find_grid_line(lines[0], _boxes[i]._max.x);
+		int max_y = find_grid_line(lines[1], _boxes[i]._max.y);
+		int max_z = find_grid_line(lines[2], _boxes[i]._max.z);
+
+		for (int z = min_z; z < max_z; ++z)
+			for (int y = min_y; y < max_y; ++y)
+				for (int x = min_x; x < max_x; ++x)
+					cells[get_cell_key(x, y, z)] = k_cell_occupied;
+	}
+
+	// Keys sort by z, then y, then x, the order the greedy pass visits cells in.
+	std::vector<uint64_t> keys;
+	keys.reserve(cells.size());
+	for (auto& c : cells)
+	{
+		keys.push_back(c.first);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	// Greedily grow each unmerged cell into the largest box it can: a run along x,
+	// then rows of that run along y, then slabs of those rows along z.
+	int size_x = int(lines[0].size()) - 1;
+	int size_y = int(lines[1].size()) - 1;
+	int size_z = int(lines[2].size()) - 1;
+	for (uint64_t key : keys)
+	{
+		if (cells[key] != k_cell_occupied) continue;
+
+		int x = int(key & k_cell_key_mask);
+		int y = int((key >> k_cell_key_bits) & k_cell_key_mask);
+		int z = int(key >> (2 * k_cell_key_bits));
+
+		int end_x = x + 1;
+		while (end_x < size_x && find_cell(end_x, y, z) == k_cell_occupied)
+		{
+			++end_x;
+		}
+
+		int end_y = y + 1;
+		for (; end_y < size_y; ++end_y)
+		{
+			bool row_free = true;
+			for (int i = x; i < end_x && row_free; ++i)
+			{
+				row_free = find_cell(i, end_y, z) == k_cell_occupied;
+			}
+			if (!row_free) break;
+		}
+
+		int end_z = z + 1;
+		for (; end_z < size_z; ++end_z)
+		{
+			bool slab_free = true;
+			for (int j = y; j < end_y && slab_free; ++j)
+			{
+				for (int i = x; i < end_x && slab_free; ++i)
+				{
+					slab_free = find_cell(i, j, end_z) == k_cell_occupied;
+				}
+			}
+			if (!slab_free) break;
+		}
+
+		for (int k = z; k < end_z; ++k)
+			for (int j = y; j < end_y; ++j)
+				for (int i = x; i < end_x; ++i)
+					cells[get_cell_key(i, j, k)] = k_cell_merged;
+
+		queued_box box;
+		box._min = { lines[0][x], lines[1][y], lines[2][z] };
+		box._max = { lines[0][end_x], lines[1][end_y], lines[2][end_z] };
+		merged->push_back(box);
+	}
+}
+
+void ga_static_geometry_optimizer::add_static_body(ga_oobb* shape, const ga_mat4f& transform, ga_physics_world* world)
+{
+	ga_rigid_body* body = world->create_rigid_body(shape, 1.0f);
+	body->make_static();
+	body->set_transform(transform);
+	world->add_rigid_body(body);
+
+	++_last_output_count;
+}
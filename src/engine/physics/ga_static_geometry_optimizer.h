@@ -0,0 +1,84 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_physics_pool.h"
+
+#include "math/ga_mat4f.h"
+#include "math/ga_vec3f.h"
+
+#include <vector>
+
+class ga_physics_world;
+
+/*
+** Merges static box colliders before they are added to the world.
+**
+** Level geometry built from many small cubes is collected here instead of being
+** registered body by body. Axis aligned boxes that touch or overlap form a group.
+** Each group is rasterized onto a grid built from its face coordinates, keeping
+** only the occupied cells, which are greedily grown into maximal boxes, first
+** along x, then y, then z. A group keeps its boxes as given when merging wouldn't
+** leave fewer. Boxes that aren't axis aligned are passed through unmerged.
+**
+** The merged boxes cover exactly the same space as the input, so whether a ray
+** hits and where it first hits are unchanged. Which colliders it hits, and how
+** many, do change: internal faces disappear, and one merged box stands in for the
+** boxes it replaced.
+**
+** Bodies are made in the world's pool, and the optimizer keeps their shapes in
+** its own, so the level's colliders sit together in memory. Remove the bodies
+** from the world before the optimizer is destroyed.
+*/
+class ga_static_geometry_optimizer
+{
+public:
+	ga_static_geometry_optimizer();
+	~ga_static_geometry_optimizer();
+
+	/*
+	** Queue a static box, placed by the transform.
+	*/
+	void add_box(const ga_oobb& box, const ga_mat4f& transform);
+
+	/*
+	** Merge the queued boxes and add the results to the world as static bodies.
+	** The queue is cleared, so the optimizer can be reused for more geometry.
+	*/
+	void build(ga_physics_world* world);
+
+	/*
+	** Number of boxes queued and colliders created by the last build.
+	*/
+	int get_input_count() const { return _last_input_count; }
+	int get_output_count() const { return _last_output_count; }
+
+private:
+	struct queued_box
+	{
+		ga_vec3f _min;
+		ga_vec3f _max;
+	};
+
+	// Axis aligned boxes as world space extents, and everything else as given.
+	std::vector<queued_box> _boxes;
+	std::vector<ga_oobb*> _unmergeable_shapes;
+	std::vector<ga_mat4f> _unmergeable_transforms;
+
+	ga_physics_allocator _allocator;
+
+	static bool boxes_touch(const queued_box& a, const queued_box& b);
+	void merge_group(const std::vector<int>& group, std::vector<queued_box>* merged) const;
+
+	int _last_input_count = 0;
+	int _last_output_count = 0;
+
+	void add_static_body(ga_oobb* shape, const ga_mat4f& transform, ga_physics_world* world);
+};
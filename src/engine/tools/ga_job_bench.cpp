@@ -0,0 +1,262 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+/*
+** Job system microbenchmark.
+**
+** Runs the job unit tests, then measures the cost of a fiber switch, of running
+** empty jobs through the scheduler, of parallel_for per item, and of queue
+** operations when 1 to N threads share one ga_queue versus each owning a ga_deque:
+**
+**   ga_job_bench [iteration count]
+**
+** Fails if recording with ga_job_profiler slows empty jobs by more than 1%.
+*/
+
+#include "jobs/ga_deque.h"
+#include "jobs/ga_fiber.h"
+#include "jobs/ga_job.h"
+#include "jobs/ga_job_profiler.h"
+#include "jobs/ga_job.tests.h"
+#include "jobs/ga_queue.h"
+#include "jobs/ga_task_graph.tests.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Largest slowdown of empty jobs, in percent, allowed while the profiler records.
+static const double k_max_profiler_overhead = 1.0;
+
+struct switch_bench_t
+{
+	ga_fiber* _main_fiber;
+};
+
+static void switch_bench_fiber(void* data)
+{
+	switch_bench_t* bench = static_cast<switch_bench_t*>(data);
+	for (;;)
+	{
+		ga_fiber::switch_to(*bench->_main_fiber);
+	}
+}
+
+static double bench_fiber_switch(int iteration_count)
+{
+	ga_fiber main_fiber = ga_fiber::convert_thread(0);
+
+	switch_bench_t bench;
+	bench._main_fiber = &main_fiber;
+	ga_fiber fiber(switch_bench_fiber, &bench, 64 * 1024);
+
+	// Warm up so the fiber's stack is paged in.
+	ga_fiber::switch_to(fiber);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iteration_count; ++i)
+	{
+		ga_fiber::switch_to(fiber);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	// Each iteration switches there and back.
+	return std::chrono::duration<double, std::nano>(end - start).count() / (2.0 * iteration_count);
+}
+
+static double bench_empty_jobs(int job_count)
+{
+	std::vector<ga_job_decl_t> decls(job_count);
+	for (int i = 0; i < job_count; ++i)
+	{
+		decls[i]._entry = [](void*) {};
+		decls[i]._data = 0;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	ga_job_counter_t counter;
+	ga_job::run(decls.data(), job_count, &counter);
+	ga_job::wait(&counter);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / job_count;
+}
+
+static double bench_parallel_for(int item_count)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	ga_job::parallel_for(0, item_count, 1, [](int, int, void*) {}, 0);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / item_count;
+}
+
+/*
+** Each thread pushes a burst of items and pops them back. Returns nanoseconds per
+** push and pop pair on each thread. Flat numbers mean the threads scale.
+*/
+static double bench_shared_queue(int thread_count, int iteration_count)
+{
+	const int k_burst = 16;
+	ga_queue queue(thread_count * k_burst + 1);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<std::thread> threads;
+	for (int t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&queue, iteration_count]()
+		{
+			for (int i = 0; i < iteration_count; i += k_burst)
+			{
+				for (int j = 0; j < k_burst; ++j)
+				{
+					queue.push(&queue);
+				}
+				void* data;
+				for (int j = 0; j < k_burst; ++j)
+				{
+					while (!queue.pop(&data)) {}
+				}
+			}
+		});
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / iteration_count;
+}
+
+static double bench_stealing_deques(int thread_count, int iteration_count)
+{
+	const int k_burst = 16;
+	std::vector<ga_deque*> deques;
+	for (int t = 0; t < thread_count; ++t)
+	{
+		deques.push_back(new ga_deque(k_burst));
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<std::thread> threads;
+	for (int t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&deques, t, thread_count, iteration_count]()
+		{
+			ga_deque* own = deques[t];
+			for (int i = 0; i < iteration_count; i += k_burst)
+			{
+				for (int j = 0; j < k_burst; ++j)
+				{
+					own->push(own);
+				}
+
+				// Anything a thief took is made up by stealing back from the next deque.
+				void* data;
+				for (int j = 0; j < k_burst; ++j)
+				{
+					int victim = t;
+					while (!own->pop(&data) && !deques[victim = (victim + 1) % thread_count]->steal(&data)) {}
+				}
+			}
+		});
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	for (auto& d : deques)
+	{
+		delete d;
+	}
+	return std::chrono::duration<double, std::nano>(end - start).count() / iteration_count;
+}
+
+int main(int argc, const char** argv)
+{
+	int iteration_count = argc > 1 ? std::max(atoi(argv[1]), 1) : 1000000;
+
+	const int k_queue_size = 4096;
+	ga_job::startup(0xffff, k_queue_size, 256);
+
+	ga_job_unit_tests();
+	ga_task_graph_unit_tests();
+	printf("Job unit tests passed.\n");
+
+	// The job system has converted this thread already.
+	double switch_ns = 0.0;
+	std::thread switch_thread([&]() { switch_ns = bench_fiber_switch(iteration_count); });
+	switch_thread.join();
+	printf("fiber switch: %.1f ns\n", switch_ns);
+
+	// Batches stay within the queue; the first pair is a warm up. Batches with the
+	// profiler recording alternate with those without, and the overhead is taken
+	// from each pair, so both halves of a pair see the same noise. Which half runs
+	// first alternates too, so running second doesn't count as overhead.
+	{
+		const int k_pair_count = 4001;
+		std::vector<double> job_ns[2];
+		std::vector<double> overhead;
+		for (int i = 0; i < k_pair_count; ++i)
+		{
+			double ns[2];
+			for (int half = 0; half < 2; ++half)
+			{
+				int profiled = half ^ (i & 1);
+				ga_job_profiler::set_enabled(profiled != 0);
+				ns[profiled] = bench_empty_jobs(k_queue_size / 2);
+			}
+			if (i > 0)
+			{
+				job_ns[0].push_back(ns[0]);
+				job_ns[1].push_back(ns[1]);
+				overhead.push_back(100.0 * (ns[1] / ns[0] - 1.0));
+			}
+		}
+		ga_job_profiler::set_enabled(false);
+
+		for (int profiled = 0; profiled < 2; ++profiled)
+		{
+			std::sort(job_ns[profiled].begin(), job_ns[profiled].end());
+			printf("empty job%s: p50 %.1f ns  min %.1f ns\n", profiled ? ", profiled" : "",
+				job_ns[profiled][job_ns[profiled].size() / 2], job_ns[profiled].front());
+		}
+		std::sort(overhead.begin(), overhead.end());
+		double overhead_p50 = overhead[overhead.size() / 2];
+		printf("profiler overhead: p50 %.1f%%\n", overhead_p50);
+		if (overhead_p50 > k_max_profiler_overhead)
+		{
+			printf("FAILED: profiler overhead is over %.0f%%.\n", k_max_profiler_overhead);
+			ga_job::shutdown();
+			return 1;
+		}
+	}
+
+	bench_parallel_for(iteration_count);
+	printf("parallel_for item, grain 1: %.1f ns\n", bench_parallel_for(iteration_count));
+
+	int max_thread_count = std::max(int(std::thread::hardware_concurrency()), 2);
+	printf("threads  ga_queue ns/op  ga_deque ns/op\n");
+	for (int thread_count = 1; thread_count <= max_thread_count; ++thread_count)
+	{
+		printf("%7d  %14.1f  %14.1f\n",
+			thread_count,
+			bench_shared_queue(thread_count, iteration_count),
+			bench_stealing_deques(thread_count, iteration_count));
+	}
+
+	ga_job::shutdown();
+	return 0;
+}
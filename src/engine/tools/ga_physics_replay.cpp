@@ -0,0 +1,107 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+/*
+** Headless physics replay.
+**
+** Runs a recording captured with ga --record-physics <path>, checks the final state
+** matches the recording bit for bit, and reports how long the steps took. Use it to
+** benchmark physics changes against captured scenes:
+**
+**   ga_physics_replay <recording> [repeat count]
+**
+** Each repeat replays the whole recording into a fresh world. Step times are pooled
+** across repeats before taking percentiles.
+*/
+
+#include "jobs/ga_job.h"
+#include "physics/ga_physics_recording.h"
+#include "physics/ga_physics_world.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static double percentile(const std::vector<double>& sorted, float fraction)
+{
+	size_t index = size_t(fraction * (sorted.size() - 1) + 0.5f);
+	return sorted[index];
+}
+
+int main(int argc, const char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <recording> [repeat count]\n", argv[0]);
+		return 2;
+	}
+
+	int repeat_count = argc > 2 ? std::max(atoi(argv[2]), 1) : 1;
+
+	ga_physics_recording recording;
+	if (!recording.load(argv[1]))
+	{
+		fprintf(stderr, "Failed to load recording %s\n", argv[1]);
+		return 2;
+	}
+	printf("%s: %d bodies, %d steps\n", argv[1], recording.get_body_count(), recording.get_step_count());
+
+	ga_job::startup(0xffff, 256, 256);
+
+	std::vector<double> step_ms;
+	step_ms.reserve(size_t(recording.get_step_count()) * repeat_count);
+
+	bool matched = true;
+	for (int repeat = 0; repeat < repeat_count; ++repeat)
+	{
+		ga_physics_world* world = new ga_physics_world();
+		recording.begin_replay(world);
+
+		for (int i = 0; i < recording.get_step_count(); ++i)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			recording.replay_step(world, i);
+			auto end = std::chrono::high_resolution_clock::now();
+			step_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+
+		if (!recording.verify_replay())
+		{
+			fprintf(stderr, "Replay %d diverged from the recording\n", repeat);
+			matched = false;
+		}
+
+		world->remove_all_rigid_bodies();
+		delete world;
+	}
+
+	ga_job::shutdown();
+
+	if (!step_ms.empty())
+	{
+		double total = 0.0;
+		for (size_t i = 0; i < step_ms.size(); ++i)
+		{
+			total += step_ms[i];
+		}
+
+		std::sort(step_ms.begin(), step_ms.end());
+		printf("step ms: mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+			total / step_ms.size(),
+			percentile(step_ms, 0.5f),
+			percentile(step_ms, 0.9f),
+			percentile(step_ms, 0.99f),
+			step_ms.back());
+	}
+
+	printf("%s\n", matched ? "Final state matches the recording." : "Final state DOES NOT match the recording.");
+	return matched ? 0 : 1;
+}